@@ -3,3 +3,98 @@
 #ifndef RELABSD_CONF_AXIS_CODE_SIZE
 #define RELABSD_CONF_AXIS_CODE_SIZE 2
 #endif
+
+/*
+ * Maximum number of events the virtual device buffers before writing them to
+ * uinput. Frames are normally flushed upon EV_SYN/SYN_REPORT, this is only a
+ * safety net for physical devices sending unusually large frames.
+ */
+#ifndef RELABSD_VIRTUAL_DEVICE_FRAME_SIZE
+#define RELABSD_VIRTUAL_DEVICE_FRAME_SIZE 64
+#endif
+
+/*
+ * Number of events (received and sent) each device keeps in its capture ring,
+ * when captures are enabled. Must be a power of two.
+ */
+#ifndef RELABSD_CAPTURE_RING_SIZE
+#define RELABSD_CAPTURE_RING_SIZE 65536
+#endif
+
+/*
+ * Maximum number of events read from a physical device in a single syscall.
+ */
+#ifndef RELABSD_PHYSICAL_DEVICE_READ_SIZE
+#define RELABSD_PHYSICAL_DEVICE_READ_SIZE 64
+#endif
+
+/* Maximum number of physical devices a single server can convert. */
+#ifndef RELABSD_SERVER_MAX_DEVICES
+#define RELABSD_SERVER_MAX_DEVICES 16
+#endif
+
+/* Maximum number of conversion threads a single server can use. */
+#ifndef RELABSD_SERVER_MAX_WORKERS
+#define RELABSD_SERVER_MAX_WORKERS 16
+#endif
+
+/*
+ * Maximum budget (in microseconds) for the conversion of a device's pending
+ * inputs, beyond which it is reported as a stall.
+ */
+#ifndef RELABSD_SERVER_MAX_STALL_BUDGET
+#define RELABSD_SERVER_MAX_STALL_BUDGET 10000000
+#endif
+
+/* Maximum number of clients the server handles at once. */
+#ifndef RELABSD_SERVER_MAX_CLIENTS
+#define RELABSD_SERVER_MAX_CLIENTS 16
+#endif
+
+/*
+ * Size of the buffers holding a client's commands and the server's reply. A
+ * client's commands are only handled once they have all been received.
+ */
+#ifndef RELABSD_SERVER_CLIENT_INPUT_SIZE
+#define RELABSD_SERVER_CLIENT_INPUT_SIZE 4096
+#endif
+
+#ifndef RELABSD_SERVER_CLIENT_OUTPUT_SIZE
+#define RELABSD_SERVER_CLIENT_OUTPUT_SIZE 4096
+#endif
+
+/*
+ * Maximum number of axes states waiting to be sent to a client that subscribed
+ * to them. Clients that fall behind only get the latest state once they catch
+ * up.
+ */
+#ifndef RELABSD_SERVER_SUBSCRIPTION_QUEUE_SIZE
+#define RELABSD_SERVER_SUBSCRIPTION_QUEUE_SIZE 8
+#endif
+
+/*
+ * Number of messages the server's log can hold before its writer thread
+ * catches up. Further messages are dropped (and counted). Must be a power of
+ * two.
+ */
+#ifndef RELABSD_LOG_RING_SIZE
+#define RELABSD_LOG_RING_SIZE 256
+#endif
+
+/* Longer messages are cut. */
+#ifndef RELABSD_LOG_MESSAGE_SIZE
+#define RELABSD_LOG_MESSAGE_SIZE 256
+#endif
+
+/*
+ * Number of messages (other than debug ones) each place in the code can log
+ * per second, once the log has its writer thread. Others are counted instead.
+ */
+#ifndef RELABSD_LOG_RATE_LIMIT
+#define RELABSD_LOG_RATE_LIMIT 10
+#endif
+
+/* Must be a power of two. */
+#ifndef RELABSD_LOG_CALL_SITES_COUNT
+#define RELABSD_LOG_CALL_SITES_COUNT 64
+#endif
@@ -38,6 +38,20 @@ int relabsd_parameters_argument_count_for
 
 void relabsd_parameters_print_usage (const char exec [const restrict static 1]);
 
+/*
+ * Sets 'result' up for the i-th additional device of 'parameters', as
+ * requested through the [-D | --device] option, parsing its configuration file.
+ *
+ * Returns -1 on (fatal) error,
+ *         0 on success.
+ */
+int relabsd_parameters_initialize_additional_device
+(
+   const struct relabsd_parameters parameters [const restrict static 1],
+   const int i,
+   struct relabsd_parameters result [const restrict static 1]
+);
+
 int relabsd_parameters_are_compatible_with
 (
    const struct libevdev * const restrict libevdev/*[const restrict static 1]*/,
@@ -51,12 +65,54 @@ int relabsd_parameters_parse_config_file
    struct relabsd_parameters parameters [const restrict static 1]
 );
 
-int relabsd_parameters_handle_remote_client
+void relabsd_parameters_initialize_client_input
+(
+   char commands [const static 1],
+   const size_t commands_length,
+   struct relabsd_parameters_client_input input [const restrict static 1]
+);
+
+int relabsd_parameters_has_remote_commands
 (
-   FILE socket_as_file [const static 1],
+   const struct relabsd_parameters_client_input input [const restrict static 1]
+);
+
+/*
+ * Applies the next command of 'input' to 'parameters'. No I/O is performed:
+ * 'input' must already contain all of the client's commands.
+ * On RELABSD_PARAMETERS_DEVICE_SELECTION, '*selected_device' is the (heap
+ * allocated) identifier of the selected device, which the caller has to free.
+ */
+enum relabsd_parameters_command_result relabsd_parameters_handle_remote_command
+(
+   struct relabsd_parameters_client_input input [const restrict static 1],
+   struct relabsd_parameters parameters [const restrict static 1],
+   char * selected_device [const restrict static 1]
+);
+
+/*
+ * A request's commands are applied to 'batch', a copy of 'parameters', which
+ * only replaces them (see 'relabsd_parameters_commit_batch') if all of the
+ * commands are valid. 'batch' shares the device name of 'parameters' until a
+ * command changes it.
+ */
+void relabsd_parameters_start_batch
+(
+   const struct relabsd_parameters parameters [const restrict static 1],
+   struct relabsd_parameters batch [const restrict static 1]
+);
+
+void relabsd_parameters_commit_batch
+(
+   const struct relabsd_parameters batch [const restrict static 1],
    struct relabsd_parameters parameters [const restrict static 1]
 );
 
+void relabsd_parameters_discard_batch
+(
+   struct relabsd_parameters batch [const restrict static 1]
+);
+
 /**** Accessors ***************************************************************/
 void relabsd_parameters_initialize_options
 (
@@ -83,6 +139,74 @@ const char * relabsd_parameters_get_physical_device_file_name
    const struct relabsd_parameters parameters [const restrict static 1]
 );
 
+int relabsd_parameters_get_workers_count
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+);
+
+/* NULL if the axes are not exported. */
+const char * relabsd_parameters_get_shared_memory_name
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+);
+
+/* NULL if the events are not published to output rings. */
+const char * relabsd_parameters_get_output_ring_name
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+);
+
+/* The "--output" option's value, NULL if the default (uinput) is used. */
+const char * relabsd_parameters_get_output_name
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+);
+
+/* NULL if the devices do not keep their last events. */
+const char * relabsd_parameters_get_capture_file_prefix
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+);
+
+/* In microseconds, 0 if conversion stalls are not detected. */
+int relabsd_parameters_get_stall_budget
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+);
+
+/*
+ * SCHED_FIFO or SCHED_RR if the conversion threads use that real-time policy
+ * (at the priority below), SCHED_OTHER otherwise.
+ */
+int relabsd_parameters_get_conversion_policy
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+);
+
+int relabsd_parameters_get_conversion_priority
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+);
+
+/*
+ * The CPUs the conversion threads are pinned to, as a list (e.g. "0,2-3").
+ * NULL if they are not pinned.
+ */
+const char * relabsd_parameters_get_conversion_cpus
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+);
+
+int relabsd_parameters_get_lock_memory
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+);
+
+int relabsd_parameters_get_additional_devices_count
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+);
+
 enum relabsd_parameters_run_mode relabsd_parameters_get_execution_mode
 (
    const struct relabsd_parameters parameters [const restrict static 1]
@@ -100,7 +224,7 @@ void relabsd_parameters_set_timeout
    struct relabsd_parameters parameters [const restrict static 1]
 );
 
-struct timeval relabsd_parameters_get_timeout
+struct timespec relabsd_parameters_get_timeout
 (
    const struct relabsd_parameters parameters [const restrict static 1]
 );
@@ -110,6 +234,29 @@ int relabsd_parameters_use_timeout
    const struct relabsd_parameters parameters [const restrict static 1]
 );
 
+/*
+ * 'name' is one of "replay", "drop" or "collapse".
+ *
+ * Returns -1 if 'name' is not a valid late policy (an error has been reported),
+ *         0 on success.
+ */
+int relabsd_parameters_set_late_policy_from_name
+(
+   const char name [const restrict static 1],
+   struct relabsd_parameters parameters [const restrict static 1]
+);
+
+/* As accepted by 'relabsd_parameters_set_late_policy_from_name'. */
+const char * relabsd_parameters_get_late_policy_name
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+);
+
+enum relabsd_physical_device_late_policy relabsd_parameters_get_late_policy
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+);
+
 int relabsd_parameters_device_name_is_dirty
 (
    const struct relabsd_parameters parameters [const restrict static 1]
@@ -119,3 +266,14 @@ void relabsd_parameters_clean_device_name
 (
    struct relabsd_parameters parameters [const restrict static 1]
 );
+
+/* The virtual device no longer has the right set of axes. */
+int relabsd_parameters_axes_capabilities_are_dirty
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+);
+
+void relabsd_parameters_clean_axes_capabilities
+(
+   struct relabsd_parameters parameters [const restrict static 1]
+);
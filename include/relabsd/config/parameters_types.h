@@ -1,8 +1,13 @@
 #pragma once
 
-#include <sys/time.h>
+#include <sys/types.h>
+
+#include <time.h>
+
+#include <relabsd/config.h>
 
 #include <relabsd/device/axis_types.h>
+#include <relabsd/device/physical_device_types.h>
 
 enum relabsd_parameters_run_mode
 {
@@ -11,6 +16,35 @@ enum relabsd_parameters_run_mode
    RELABSD_PARAMETERS_COMPATIBILITY_TEST_MODE
 };
 
+/* What the server has to do following a client's command. */
+enum relabsd_parameters_command_result
+{
+   /* The following commands cannot be found. */
+   RELABSD_PARAMETERS_UNKNOWN_COMMAND = -2,
+   /* The next command can still be handled. */
+   RELABSD_PARAMETERS_INVALID_COMMAND = -1,
+   /* The parameters were modified, or the server interrupted. */
+   RELABSD_PARAMETERS_COMMAND_APPLIED = 0,
+   RELABSD_PARAMETERS_DEVICE_SELECTION,
+   RELABSD_PARAMETERS_LATENCY_REQUEST,
+   RELABSD_PARAMETERS_STATE_REQUEST,
+   RELABSD_PARAMETERS_WATCH_REQUEST,
+   RELABSD_PARAMETERS_OUTPUT_RING_REQUEST,
+   RELABSD_PARAMETERS_CAPTURE_DUMP_REQUEST,
+   RELABSD_PARAMETERS_STATISTICS_REQUEST,
+   RELABSD_PARAMETERS_STATISTICS_RESET_REQUEST
+};
+
+/* Commands received from a client, one argument per line. */
+struct relabsd_parameters_client_input
+{
+   char * commands;
+   size_t commands_length;
+   /* The current argument, its '\n' having been replaced by a '\0'. */
+   char * buffer;
+   ssize_t size;
+};
+
 struct relabsd_parameters
 {
    int read_argc;
@@ -21,7 +55,28 @@ struct relabsd_parameters
    const char * physical_device_file_name;
    const char * configuration_file;
    int use_timeout;
-   struct timeval timeout;
+   struct timespec timeout;
+   enum relabsd_physical_device_late_policy late_policy;
    struct relabsd_axis axes[RELABSD_AXIS_VALID_AXES_COUNT];
    int device_name_was_modified;
+   /* An axis was enabled, disabled or now converts to another EV_ABS code. */
+   int axes_capabilities_were_modified;
+   int workers_count;
+   const char * shared_memory_name;
+   const char * output_ring_name;
+   const char * output_name;
+   const char * capture_file_prefix;
+   /* In microseconds, 0 if conversion stalls are not detected. */
+   int stall_budget;
+   /* SCHED_OTHER if the conversion threads use the default scheduling. */
+   int conversion_policy;
+   int conversion_priority;
+   /* NULL if the conversion threads can run on any CPU. */
+   const char * conversion_cpus;
+   int lock_memory;
+   int additional_devices_count;
+   const char * additional_physical_device_file_names
+      [(RELABSD_SERVER_MAX_DEVICES - 1)];
+   const char * additional_configuration_files
+      [(RELABSD_SERVER_MAX_DEVICES - 1)];
 };
@@ -2,6 +2,7 @@
 
 #include <stdio.h>
 
+#include <relabsd/util/log.h>
 #include <relabsd/util/macro.h>
 
 //#define RELABSD_USE_MACRO_DEBUG 1
@@ -34,6 +35,9 @@ void relabsd_debug_toggle_real_event (void);
 void relabsd_debug_toggle_virtual_event (void);
 #endif
 
+#ifndef RELABSD_ENABLE_INFO_OUTPUT
+#define RELABSD_ENABLE_INFO_OUTPUT                  1
+#endif
 #ifndef RELABSD_ENABLE_WARNINGS_OUTPUT
 #define RELABSD_ENABLE_WARNINGS_OUTPUT              1
 #endif
@@ -53,8 +57,18 @@ void relabsd_debug_toggle_virtual_event (void);
    #define RELABSD_LOCATION ""
 #endif
 
+/*
+ * These do not wait on stderr once the server has started its log (see
+ * 'relabsd/util/log.h'). Debug messages are not rate-limited, so that they
+ * can follow events.
+ */
 #define RELABSD_PRINT_STDERR(symbol, str, ...)\
-   fprintf(stderr, "[" symbol "]" RELABSD_LOCATION " " str "\n", __VA_ARGS__);
+   relabsd_log_print\
+   (\
+      (symbol[0] != 'D'),\
+      "[" symbol "]" RELABSD_LOCATION " " str "\n",\
+      __VA_ARGS__\
+   );
 
 /*
  * Given that we use preprocessor contants as flags, we can expect the compilers
@@ -71,6 +85,14 @@ void relabsd_debug_toggle_virtual_event (void);
       }\
    )
 
+#define RELABSD_INFO(str, ...)\
+   RELABSD_ISOLATE\
+   (\
+      if (RELABSD_ENABLE_INFO_OUTPUT)\
+      {\
+         RELABSD_PRINT_STDERR("I", str, __VA_ARGS__);\
+      }\
+   )
 
 #define RELABSD_WARNING(str, ...)\
    RELABSD_ISOLATE\
@@ -111,7 +133,11 @@ void relabsd_debug_toggle_virtual_event (void);
 /* For outputs without dynamic content (static). ******************************/
 
 #define RELABSD_PRINT_S_STDERR(symbol, str)\
-   fprintf(stderr, "[" symbol "]" RELABSD_LOCATION " " str "\n");
+   relabsd_log_print\
+   (\
+      (symbol[0] != 'D'),\
+      "[" symbol "]" RELABSD_LOCATION " " str "\n"\
+   );
 
 #define RELABSD_S_DEBUG(flag, str)\
    RELABSD_ISOLATE\
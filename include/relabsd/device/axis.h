@@ -89,10 +89,32 @@ void relabsd_axis_to_absinfo
    struct input_absinfo absinfo [const restrict static 1]
 );
 
+/*
+ * Updates the filtering counters of 'statistics', which is indexed by
+ * 'enum relabsd_axis_statistic'.
+ *
+ * Returns -1 if the event should not be transmitted,
+ *         0 if the event should be transmitted unchanged,
+ *         1 if the event should be transmitted as converted, with 'value'.
+ */
 int relabsd_axis_filter_new_value
 (
    struct relabsd_axis axis [const restrict static 1],
-   int value [const restrict static 1]
+   int value [const restrict static 1],
+   atomic_ulong statistics [const restrict static 1]
+);
+
+/*
+ * Sets 'conversion' up to convert events of EV_REL code 'rel_code' using
+ * 'axis', which is NULL if 'rel_code' does not correspond to any axis.
+ * 'conversion' keeps a pointer to 'axis', and has to be initialized again
+ * whenever the configuration of 'axis' changes.
+ */
+void relabsd_axis_initialize_conversion
+(
+   const unsigned int rel_code,
+   struct relabsd_axis axis [const],
+   struct relabsd_axis_conversion conversion [const restrict static 1]
 );
 
 void relabsd_axis_initialize
@@ -121,3 +143,13 @@ int relabsd_axis_has_flag
    const struct relabsd_axis axis [const restrict static 1],
    const enum relabsd_axis_flag flag
 );
+
+/*
+ * Returns 1 if 'a' and 'b' only differ in their state (such as their previous
+ * value), 0 otherwise.
+ */
+int relabsd_axis_has_same_configuration
+(
+   const struct relabsd_axis a [const restrict static 1],
+   const struct relabsd_axis b [const restrict static 1]
+);
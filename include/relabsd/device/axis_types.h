@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stdatomic.h>
+
 /* Number of axes that can be configured. */
 #define RELABSD_AXIS_VALID_AXES_COUNT 8
 #define RELABSD_AXIS_FLAGS_COUNT 5
@@ -31,6 +33,27 @@ enum relabsd_axis_flag
    RELABSD_INVERT
 };
 
+/*
+ * Counters of each axis, for statistics. Only the thread converting the device
+ * updates them (see 'relabsd/util/counter.h').
+ */
+enum relabsd_axis_statistic
+{
+   /* Events received for the axis. */
+   RELABSD_AXIS_RECEIVED,
+   /* Events sent to the virtual device, converted or not. */
+   RELABSD_AXIS_SENT,
+   /* Events dropped because they were within the axis' fuzz. */
+   RELABSD_AXIS_FUZZ_FILTERED,
+   /* Values set to 0 because they were within the axis' flat. */
+   RELABSD_AXIS_FLATTENED,
+   /* Events that left the converted value unchanged. */
+   RELABSD_AXIS_UNCHANGED,
+   /* Values brought back within the axis' limits. */
+   RELABSD_AXIS_CLAMPED,
+   RELABSD_AXIS_STATISTICS_COUNT
+};
+
 struct relabsd_axis
 {
    int min;
@@ -45,3 +68,22 @@ struct relabsd_axis
    int attributes_were_modified;
    enum relabsd_axis_name convert_to;
 };
+
+/*
+ * How events of a given EV_REL code are converted.
+ * 'axis' is NULL if such events are dropped. If 'filter' is NULL, the event's
+ * value is kept as is. Otherwise, 'filter' follows the same conventions as
+ * 'relabsd_axis_filter_new_value'.
+ */
+struct relabsd_axis_conversion
+{
+   struct relabsd_axis * axis;
+   int (* filter)
+   (
+      struct relabsd_axis axis [const restrict static 1],
+      int value [const restrict static 1],
+      atomic_ulong statistics [const restrict static 1]
+   );
+   unsigned int type;
+   unsigned int code;
+};
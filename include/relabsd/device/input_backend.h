@@ -0,0 +1,40 @@
+#pragma once
+
+#include <libevdev/libevdev.h>
+
+#include <relabsd/config/parameters_types.h>
+
+#include <relabsd/device/input_backend_types.h>
+
+/*
+ * Finds the backend a physical device's file name refers to:
+ * - "trace=<path>": a trace recorded by "relabsd-replay record", replayed at
+ *   the pace it was recorded,
+ * - "fast-trace=<path>": the same, as fast as it can be converted,
+ * - "pipe=<path>[,<capabilities>]": a named pipe of raw input_event structures
+ *   (such as what the "file" output writes),
+ * - "stdin[=<capabilities>]": the same, from the standard input,
+ * - anything else is the path of an evdev device node.
+ * '*argument' is set to what follows the '=', or to 'name' for evdev devices.
+ */
+const struct relabsd_input_backend * relabsd_input_backend_find
+(
+   const char name [const restrict static 1],
+   const char * argument [const restrict static 1]
+);
+
+/*
+ * Gives a description of the capabilities of the physical device 'parameters'
+ * refers to, which has to be freed with 'libevdev_free'. Traces have those of
+ * the device they were recorded from. Pipes and stdin have those they were
+ * given (see 'relabsd_input_capabilities_parse'), or else the relative axes
+ * 'parameters' converts and mouse buttons.
+ *
+ * Returns 0 on success,
+ *         -1 on (fatal) error.
+ */
+int relabsd_input_backend_describe
+(
+   const struct relabsd_parameters parameters [const restrict static 1],
+   struct libevdev * result [const restrict static 1]
+);
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdio.h>
+#include <time.h>
+
+#include <libevdev/libevdev.h>
+
+#include <relabsd/replay_types.h>
+
+struct relabsd_parameters;
+struct relabsd_physical_device;
+
+/*
+ * Where a physical device's events come from. 'argument' is whatever followed
+ * the backend's name in the physical device's file name (see
+ * 'relabsd_input_backend_find').
+ */
+struct relabsd_input_backend
+{
+   const char * name;
+
+   /*
+    * Sets up 'device->file' (a file descriptor that becomes readable when
+    * events are available) and 'device->libevdev'.
+    * Returns 0 on success, -1 on (fatal) error.
+    */
+   int (*open)
+   (
+      const char * argument,
+      const struct relabsd_parameters * parameters,
+      struct relabsd_physical_device * device
+   );
+
+   void (*close) (struct relabsd_physical_device * device);
+
+   /*
+    * Appends as many events as possible to 'device->buffer'.
+    * Returns -1 on (fatal) error or once there will never be any more events
+    *            (setting 'device->has_reached_end'),
+    *         0 if there was nothing to read,
+    *         1 if something was read.
+    */
+   int (*read_events) (struct relabsd_physical_device * device);
+
+   /*
+    * Gives a description of the device's capabilities, which has to be freed
+    * with 'libevdev_free'. Returns 0 on success, -1 on (fatal) error.
+    */
+   int (*describe)
+   (
+      const char * argument,
+      const struct relabsd_parameters * parameters,
+      struct libevdev ** result
+   );
+
+   /* libevdev can query the device's state after the kernel dropped events. */
+   int can_resynchronize;
+};
+
+/* Replay of a trace recorded by "relabsd-replay record". */
+struct relabsd_input_trace
+{
+   FILE * file;
+   /* Otherwise, events are given as fast as they can be converted. */
+   int is_paced;
+   /* The last read gave events, the next one lets other sources through. */
+   int has_yielded;
+   int has_next_event;
+   struct relabsd_replay_event next_event;
+   /* CLOCK_MONOTONIC time at which 'next_event' is due. */
+   struct timespec next_event_time;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdio.h>
+
+#include <libevdev/libevdev.h>
+
+#include <relabsd/replay_types.h>
+
+/* Describes what 'libevdev' reports having, for it to be written to a trace. */
+void relabsd_input_capabilities_from_libevdev
+(
+   const struct libevdev * const restrict libevdev/*[const restrict static 1]*/,
+   struct relabsd_replay_capabilities result [const restrict static 1]
+);
+
+/*
+ * Gives a description having the capabilities of 'capabilities', which has to
+ * be freed with 'libevdev_free'.
+ *
+ * Returns -1 on (fatal) error,
+ *         0 on success.
+ */
+int relabsd_input_capabilities_to_libevdev
+(
+   const struct relabsd_replay_capabilities capabilities [const static 1],
+   struct libevdev * result [const restrict static 1]
+);
+
+/*
+ * Gives a description named 'name', of a device that has the comma separated
+ * event codes of 'description' (e.g. "REL_X,REL_Y,BTN_LEFT"), which has to be
+ * freed with 'libevdev_free'. EV_ABS codes are followed by their range (e.g.
+ * "ABS_X:-350:350").
+ *
+ * Returns -1 on (fatal) error,
+ *         0 on success.
+ */
+int relabsd_input_capabilities_parse
+(
+   const char name [const restrict static 1],
+   const char description [const restrict static 1],
+   struct libevdev * result [const restrict static 1]
+);
+
+/*
+ * Reads the start of a trace, leaving 'trace_file' at its first event.
+ *
+ * Returns -1 on (fatal) error,
+ *         0 on success.
+ */
+int relabsd_input_capabilities_read_from_trace
+(
+   const char trace_file_name [const restrict static 1],
+   FILE trace_file [const restrict static 1],
+   struct relabsd_replay_capabilities result [const restrict static 1]
+);
+
+/*
+ * Writes the start of a trace, after which its events can be written.
+ *
+ * Returns -1 on (fatal) error,
+ *         0 on success.
+ */
+int relabsd_input_capabilities_write_to_trace
+(
+   const struct relabsd_replay_capabilities capabilities [const static 1],
+   FILE trace_file [const restrict static 1]
+);
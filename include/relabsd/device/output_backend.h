@@ -0,0 +1,22 @@
+#pragma once
+
+#include <relabsd/device/output_backend_types.h>
+
+/*
+ * Finds the backend an "--output" option value refers to: "uinput" (the
+ * default), "file=<path>" or "null". '*argument' is set to what follows the
+ * '=', if anything.
+ *
+ * Returns NULL if there is no such backend.
+ */
+const struct relabsd_output_backend * relabsd_output_backend_find
+(
+   const char option [const restrict static 1],
+   const char * argument [const restrict static 1]
+);
+
+/*
+ * Writes to a file descriptor the backend does not own (see
+ * 'relabsd_virtual_device_create_for_file'). It cannot be selected by users.
+ */
+const struct relabsd_output_backend * relabsd_output_backend_for_file (void);
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <libevdev/libevdev.h>
+
+#include <relabsd/config.h>
+
+struct relabsd_virtual_device;
+
+/*
+ * Where a virtual device sends its frames. 'open' is given the device once its
+ * 'libevdev' description is complete, along with whatever followed the
+ * backend's name in the "--output" option (NULL if nothing did).
+ */
+struct relabsd_output_backend
+{
+   const char * name;
+
+   /* Returns 0 on success, -1 on (fatal) error. */
+   int (*open)
+   (
+      const char * argument,
+      struct relabsd_virtual_device * device
+   );
+
+   void (*close) (struct relabsd_virtual_device * device);
+
+   /* Writes all the events. Returns 0 on success, -1 on error. */
+   int (*write)
+   (
+      struct relabsd_virtual_device * device,
+      const struct input_event * events,
+      size_t events_count
+   );
+
+   /*
+    * Event node of the input device the backend created, NULL if there is none
+    * (the axes of such backends can then be changed without any recreation).
+    */
+   const char * (*get_event_node)
+   (
+      const struct relabsd_virtual_device * device
+   );
+};
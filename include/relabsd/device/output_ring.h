@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <libevdev/libevdev.h>
+
+#include <relabsd/device/output_ring_types.h>
+
+/*
+ * Adds the events to the ring, then wakes up its waiting readers. Only one
+ * thread at a time can write to a given ring.
+ */
+void relabsd_output_ring_write
+(
+   struct relabsd_output_ring_writer writer [const static 1],
+   const struct input_event events [const restrict static 1],
+   const size_t events_count
+);
+
+/*
+ * Removes the eventfd of the reader slot, then closes it once the thread
+ * writing to the ring cannot be using it anymore. Only one thread at a time
+ * can add or remove readers of a given ring.
+ */
+void relabsd_output_ring_remove_reader_file
+(
+   struct relabsd_output_ring_writer writer [const static 1],
+   const int slot
+);
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdatomic.h>
+
+#include <relabsd/output_ring_types.h>
+
+/* The server's side of a device's output ring. */
+struct relabsd_output_ring_writer
+{
+   struct relabsd_output_ring * ring;
+   /*
+    * The eventfd of each reader slot, or -1 if the slot has no reader. Each
+    * reader gets its own, so that a previous reader of the slot cannot take
+    * its wakeups.
+    */
+   atomic_int files[RELABSD_OUTPUT_RING_READERS_COUNT];
+   /*
+    * Odd while the thread writing to the ring uses one of 'files', so that the
+    * thread handling readers knows when it can close the one it removed.
+    */
+   atomic_uint wakeup_sequence;
+   /* Only used by the thread handling readers. */
+   int slot_is_used[RELABSD_OUTPUT_RING_READERS_COUNT];
+};
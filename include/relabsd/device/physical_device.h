@@ -1,8 +1,15 @@
 #pragma once
 
+#include <time.h>
+
+#include <relabsd/config/parameters_types.h>
+
 #include <relabsd/device/physical_device_types.h>
 
 /*
+ * Opens the physical device 'parameters' refers to, which is not necessarily
+ * an evdev device (see 'relabsd_input_backend_find').
+ *
  * Returns -1 on (fatal) error,
  *         0  on success.
  *
@@ -12,13 +19,13 @@
  */
 int relabsd_physical_device_open
 (
-   const char filename [const restrict static 1],
+   const struct relabsd_parameters parameters [const restrict static 1],
    struct relabsd_physical_device device [const restrict static 1]
 );
 
 void relabsd_physical_device_close
 (
-   const struct relabsd_physical_device device [const restrict static 1]
+   struct relabsd_physical_device device [const restrict static 1]
 );
 
 /*
@@ -28,20 +35,69 @@ void relabsd_physical_device_close
  *
  * The 'input_*' parameters do not need to be initialized, as the function will
  * do that for you (on success).
+ * 'late_policy' indicates what to do with outdated events, if the reading has
+ * fallen behind.
  */
 int relabsd_physical_device_read
 (
    struct relabsd_physical_device device [const restrict static 1],
+   const enum relabsd_physical_device_late_policy late_policy,
    unsigned int input_type [const restrict static 1],
    unsigned int input_code [const restrict static 1],
    int input_value [const restrict static 1]
 );
 
+/*
+ * Whether the EV_REL events of type 'code' are movements, which are summed
+ * when late frames are collapsed, or positions, of which only the latest is
+ * kept. They are all considered movements when the device is opened.
+ */
+void relabsd_physical_device_set_sums_relative_values
+(
+   const unsigned int code,
+   const int sums_relative_values,
+   struct relabsd_physical_device device [const restrict static 1]
+);
+
+/*
+ * Whether the input of 'device' will never give any more events, as opposed to
+ * having failed.
+ */
+int relabsd_physical_device_has_reached_end
+(
+   const struct relabsd_physical_device device [const restrict static 1]
+);
+
 int relabsd_physical_device_is_late
 (
    const struct relabsd_physical_device device [const restrict static 1]
 );
 
+/* Number of times 'device' got late since it was opened. */
+unsigned long int relabsd_physical_device_get_late_episodes_count
+(
+   const struct relabsd_physical_device device [const restrict static 1]
+);
+
+/* Number of events 'late_policy' discarded since 'device' was opened. */
+unsigned long int relabsd_physical_device_get_discarded_late_events_count
+(
+   const struct relabsd_physical_device device [const restrict static 1],
+   const enum relabsd_physical_device_late_policy late_policy
+);
+
+/*
+ * Gives the CLOCK_MONOTONIC timestamp of the last event that was read.
+ *
+ * Returns -1 if the device does not use CLOCK_MONOTONIC timestamps,
+ *         0 on success.
+ */
+int relabsd_physical_device_get_last_event_time
+(
+   const struct relabsd_physical_device device [const restrict static 1],
+   struct timespec result [const restrict static 1]
+);
+
 int relabsd_physical_device_get_file_descriptor
 (
    const struct relabsd_physical_device device [const restrict static 1]
@@ -1,10 +1,68 @@
 #pragma once
 
+#include <stddef.h>
+
+#include <sys/time.h>
+
 #include <libevdev/libevdev.h>
 
+#include <relabsd/config.h>
+
+#include <relabsd/device/input_backend_types.h>
+
+#define RELABSD_PHYSICAL_DEVICE_LATE_POLICIES_COUNT 3
+
+/* What to do with the events that are waiting when the reading falls behind. */
+enum relabsd_physical_device_late_policy
+{
+   /* Go through all of them, in order. */
+   RELABSD_PHYSICAL_DEVICE_REPLAY_LATE_EVENTS,
+   /*
+    * Discard their relative and EV_MSC events. The others carry the device's
+    * state, so they are merged into a single frame holding it.
+    */
+   RELABSD_PHYSICAL_DEVICE_DROP_LATE_EVENTS,
+   /* Merge them into a single frame holding the latest state. */
+   RELABSD_PHYSICAL_DEVICE_COLLAPSE_LATE_EVENTS
+};
+
 struct relabsd_physical_device
 {
+   const struct relabsd_input_backend * input_backend;
    struct libevdev * libevdev;
    int file;
    int is_late;
+   /* The input will never give any more events (e.g. a replayed trace). */
+   int has_reached_end;
+   /* Event timestamps use CLOCK_MONOTONIC, instead of CLOCK_REALTIME. */
+   int has_monotonic_timestamps;
+   struct timeval last_event_time;
+
+   /*
+    * Events are read directly from 'file', in bulk, unless the device uses
+    * multitouch slots. libevdev is then only used to resynchronize after the
+    * kernel dropped events.
+    */
+   int uses_raw_reads;
+   size_t buffer_index;
+   size_t buffer_length;
+   struct input_event buffer[RELABSD_PHYSICAL_DEVICE_READ_SIZE];
+   /*
+    * Indexed by EV_REL code: whether the values of late frames are summed when
+    * they are collapsed, or only the latest is kept (e.g. for axes that report
+    * positions instead of movements).
+    */
+   int sums_relative_values[REL_CNT];
+
+   /* Only used by the "trace" and "fast-trace" backends. */
+   struct relabsd_input_trace trace;
+   /* Start of an event that was only partly read from a pipe. */
+   size_t partial_event_length;
+   char partial_event[sizeof(struct input_event)];
+
+   /* Times the kernel dropped events, making the device late. */
+   unsigned long int late_episodes_count;
+   /* Indexed by 'enum relabsd_physical_device_late_policy'. */
+   unsigned long int discarded_late_events
+      [RELABSD_PHYSICAL_DEVICE_LATE_POLICIES_COUNT];
 };
@@ -25,26 +25,78 @@ int relabsd_virtual_device_create_from
    struct relabsd_virtual_device device [const restrict static 1]
 );
 
+/*
+ * Same as 'relabsd_virtual_device_create_from', except that the replacement
+ * keeps the name of 'device' unless 'parameters' gives it a new one.
+ * 'device' is left untouched: it can be used until the replacement takes over
+ * (see 'relabsd_virtual_device_replace').
+ */
+int relabsd_virtual_device_create_replacement
+(
+   struct relabsd_parameters parameters [const restrict static 1],
+   const struct relabsd_virtual_device device [const restrict static 1],
+   struct relabsd_virtual_device replacement [const restrict static 1]
+);
+
+/*
+ * Makes 'device' use the uinput device of 'replacement' (keeping its
+ * statistics), then destroys the previous one. 'device' must be at a frame
+ * boundary. 'replacement' must not be used afterwards.
+ */
+void relabsd_virtual_device_replace
+(
+   struct relabsd_virtual_device device [const restrict static 1],
+   struct relabsd_virtual_device replacement [const restrict static 1]
+);
+
+/*
+ * Sets 'device' up to write its frames to 'file' instead of uinput, without
+ * creating any actual input device. Only the functions handling events can
+ * then be used on 'device'.
+ * 'file' is not closed when 'device' is destroyed.
+ */
+void relabsd_virtual_device_create_for_file
+(
+   const int file,
+   struct relabsd_virtual_device device [const restrict static 1]
+);
+
 void relabsd_virtual_device_destroy
 (
-   const struct relabsd_virtual_device device [const restrict static 1]
+   struct relabsd_virtual_device device [const restrict static 1]
 );
 
 /*
- * Write an event to 'device'. At this time, every event written to 'device' is
- * followed by an EV_SYN event.
+ * Adds an event to the frame being built for 'device'. The whole frame is
+ * written to uinput in a single syscall once an EV_SYN/SYN_REPORT event is
+ * added (or if the frame buffer is full).
+ * An EV_ABS or EV_REL event replaces any event of the same code already in the
+ * frame (relative values being summed). Frames without any event of interest
+ * are not written at all.
  *
- * Returns 0 if both the event and the EV_SYN were successful,
- *         -1 if either failed.
+ * Returns 0 on success,
+ *         -1 if the frame had to be written and that failed.
  */
 int relabsd_virtual_device_write_evdev_event
 (
-   const struct relabsd_virtual_device device [const restrict static 1],
+   struct relabsd_virtual_device device [const restrict static 1],
    unsigned int const type,
    unsigned int const code,
    int const value
 );
 
+/*
+ * Writes all the pending events of 'device' to its output backend, whether or
+ * not they form a complete frame. The pending events are discarded on failure.
+ *
+ * Returns 0 on success,
+ *         -1 on failure.
+ */
+int relabsd_virtual_device_flush
+(
+   struct relabsd_virtual_device device [const restrict static 1]
+);
+
 /*
  * Send an event for each enabled axis, setting it to zero.
  * An EV_SYN event is sent afterwards.
@@ -52,7 +104,38 @@ int relabsd_virtual_device_write_evdev_event
 void relabsd_virtual_device_set_axes_to_zero
 (
    struct relabsd_parameters parameters [const restrict static 1],
-   const struct relabsd_virtual_device device [const restrict static 1]
+   struct relabsd_virtual_device device [const restrict static 1]
+);
+
+/*
+ * Sends the current value ('previous_value') of each enabled axis, followed by
+ * an EV_SYN event. Used so that a new virtual device starts where the previous
+ * one was.
+ */
+void relabsd_virtual_device_restore_axes
+(
+   struct relabsd_parameters parameters [const static 1],
+   struct relabsd_virtual_device device [const restrict static 1]
+);
+
+/*
+ * Frames written to 'device' are also added to 'output_ring', unless it is
+ * NULL. Replacements of 'device' keep it.
+ */
+void relabsd_virtual_device_set_output_ring
+(
+   struct relabsd_output_ring_writer output_ring [const],
+   struct relabsd_virtual_device device [const restrict static 1]
+);
+
+/*
+ * Frames written to 'device' are also added to 'capture_ring', unless it is
+ * NULL. Replacements of 'device' keep it.
+ */
+void relabsd_virtual_device_set_capture_ring
+(
+   struct relabsd_capture_ring capture_ring [const],
+   struct relabsd_virtual_device device [const restrict static 1]
 );
 
 void relabsd_virtual_device_set_has_already_timed_out
@@ -73,6 +156,21 @@ int relabsd_virtual_device_update_axis_absinfo
    const struct relabsd_virtual_device device [const restrict static 1]
 );
 
+/*
+ * Applies the attributes (min, max, fuzz, flat, resolution) of 'axis' to the
+ * virtual device while it is in use, without recreating it.
+ *
+ * Returns 0 on success,
+ *         1 if the virtual device has to be recreated for the change to apply
+ *           (e.g. the axis is new to it).
+ */
+int relabsd_virtual_device_change_axis_absinfo
+(
+   const enum relabsd_axis_name axis_name,
+   const struct relabsd_axis axis [const restrict static 1],
+   const struct relabsd_virtual_device device [const restrict static 1]
+);
+
 int relabsd_virtual_device_rename
 (
    const struct relabsd_parameters parameters [const restrict static 1],
@@ -83,3 +181,38 @@ int relabsd_virtual_device_recreate
 (
    struct relabsd_virtual_device device [const restrict static 1]
 );
+
+/* No event is waiting for the end of its frame. */
+int relabsd_virtual_device_is_at_frame_boundary
+(
+   const struct relabsd_virtual_device device [const restrict static 1]
+);
+
+/*
+ * Number of frames (EV_SYN/SYN_REPORT events) and of write syscalls that were
+ * used to send them to uinput, since 'device' was created.
+ */
+unsigned long int relabsd_virtual_device_get_frame_count
+(
+   const struct relabsd_virtual_device device [const restrict static 1]
+);
+
+unsigned long int relabsd_virtual_device_get_write_syscall_count
+(
+   const struct relabsd_virtual_device device [const restrict static 1]
+);
+
+/*
+ * Number of frames that were not written for lack of content, and of events
+ * that were merged into a previous event of their frame, since 'device' was
+ * created.
+ */
+unsigned long int relabsd_virtual_device_get_suppressed_frame_count
+(
+   const struct relabsd_virtual_device device [const restrict static 1]
+);
+
+unsigned long int relabsd_virtual_device_get_merged_event_count
+(
+   const struct relabsd_virtual_device device [const restrict static 1]
+);
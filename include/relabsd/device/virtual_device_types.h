@@ -1,11 +1,43 @@
 #pragma once
 
+#include <stddef.h>
+
 #include <libevdev/libevdev.h>
 #include <libevdev/libevdev-uinput.h>
 
+#include <relabsd/config.h>
+
+#include <relabsd/device/output_backend_types.h>
+#include <relabsd/device/output_ring_types.h>
+
+#include <relabsd/util/capture_ring_types.h>
+
 struct relabsd_virtual_device
 {
    int already_timed_out;
    struct libevdev * libevdev;
+   const struct relabsd_output_backend * output_backend;
+   /* What followed the backend's name in the "--output" option. */
+   const char * output_argument;
+   /* Only used by the "uinput" backend. */
    struct libevdev_uinput * uinput_device;
+   /* Where the "uinput" and "file" backends write frames to. */
+   int file;
+
+   /* Events waiting for the next EV_SYN/SYN_REPORT to be written to uinput. */
+   size_t frame_length;
+   struct input_event frame[RELABSD_VIRTUAL_DEVICE_FRAME_SIZE];
+   /* The frame has an event that is worth waking its listeners up for. */
+   int frame_has_content;
+   /* Part of the frame had to be written before its EV_SYN/SYN_REPORT. */
+   int frame_was_partially_written;
+   /* Also receives the frames, if not NULL. */
+   struct relabsd_output_ring_writer * output_ring;
+   /* Also keeps the frames, if not NULL. */
+   struct relabsd_capture_ring * capture_ring;
+
+   unsigned long int frame_count;
+   unsigned long int write_syscall_count;
+   unsigned long int suppressed_frame_count;
+   unsigned long int merged_event_count;
 };
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/*
+ * Layout of the POSIX shared memory object a server publishes the converted
+ * events of its devices to (see its "--ring" option), in addition to their
+ * virtual devices. Readers get the events as they are sent to uinput,
+ * EV_SYN/SYN_REPORT included, without going through the kernel's input layer.
+ *
+ * Each device has its own ring, in the order the devices were given to the
+ * server. The server never waits on readers: those that fall more than
+ * RELABSD_OUTPUT_RING_EVENTS_COUNT events behind lose the oldest ones.
+ * 'write_index' is the number of events written to the ring so far, event 'i'
+ * being at 'events[i % RELABSD_OUTPUT_RING_EVENTS_COUNT]'. Reading event 'i'
+ * (with 'i < write_index'):
+ *
+ *    (relaxed loads of the event's fields)
+ *
+ *    atomic_thread_fence(memory_order_acquire);
+ *
+ *    if
+ *    (
+ *       (atomic_load_explicit(&(ring->write_index), memory_order_relaxed) - i)
+ *       >= RELABSD_OUTPUT_RING_EVENTS_COUNT
+ *    )
+ *    {
+ *       (the event was overwritten while being read)
+ *    }
+ *
+ * Readers that want to be woken up get a reader slot and its eventfd from the
+ * server's communication node (see the "--read-ring" client command). To wait
+ * for the events following 'i':
+ *
+ *    atomic_store(&(ring->readers[slot].is_waiting), 1);
+ *
+ *    if (atomic_load(&(ring->write_index)) == i)
+ *    {
+ *       (wait for the eventfd to be readable, then read it)
+ *    }
+ *
+ *    atomic_store(&(ring->readers[slot].is_waiting), 0);
+ *
+ * The server only writes to the eventfd of waiting readers, so wake-ups can be
+ * spurious, but never missed.
+ *
+ * Integers are in the byte order of the machine.
+ */
+#define RELABSD_OUTPUT_RING_MAGIC "relabsd\x03"
+#define RELABSD_OUTPUT_RING_MAGIC_SIZE 8
+
+/* Must be a power of two. */
+#define RELABSD_OUTPUT_RING_EVENTS_COUNT 1024
+#define RELABSD_OUTPUT_RING_READERS_COUNT 8
+
+struct relabsd_output_ring_event
+{
+   _Atomic uint16_t type;
+   _Atomic uint16_t code;
+   _Atomic int32_t value;
+};
+
+struct relabsd_output_ring_reader
+{
+   /* Each reader only writes to its own line. */
+   _Alignas(64) _Atomic uint32_t is_waiting;
+};
+
+struct relabsd_output_ring
+{
+   _Alignas(64) _Atomic uint64_t write_index;
+   struct relabsd_output_ring_reader readers[RELABSD_OUTPUT_RING_READERS_COUNT];
+   struct relabsd_output_ring_event events[RELABSD_OUTPUT_RING_EVENTS_COUNT];
+};
+
+struct relabsd_output_rings
+{
+   char magic[RELABSD_OUTPUT_RING_MAGIC_SIZE];
+   uint32_t devices_count;
+   uint32_t events_count;
+   uint32_t readers_count;
+   struct relabsd_output_ring rings[];
+};
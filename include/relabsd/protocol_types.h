@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <relabsd/device/axis_types.h>
+
+/*
+ * Clients and servers exchange frames over the communication node: a
+ * 'struct relabsd_protocol_frame_header' followed by 'length' bytes.
+ *
+ * A request holds commands, each one followed by its arguments, each of them
+ * ending with a '\n' (i.e. the client's command line options, one per line).
+ * The server replies to each request with a single frame, holding one
+ * 'struct relabsd_protocol_reply_header' per command, in order, each followed
+ * by 'length' bytes of text. The server stops handling a request at its first
+ * unknown command. The changes a request makes to the devices' parameters,
+ * and its selection of a device, only take effect if all of its commands are
+ * valid.
+ *
+ * Requests apply to the first device of the server until the client selects
+ * another one. A client can send any number of requests on the same
+ * connection, without waiting for their replies.
+ *
+ * Once a client has subscribed to a device's axes, the server also sends it
+ * frames holding a single reply, with the RELABSD_PROTOCOL_AXES_STATE status,
+ * followed by a 'struct relabsd_protocol_axes_state'.
+ *
+ * Integers are in the byte order of the machine.
+ */
+struct relabsd_protocol_frame_header
+{
+   uint32_t length;
+};
+
+struct relabsd_protocol_reply_header
+{
+   int32_t status;
+   uint32_t length;
+};
+
+enum relabsd_protocol_status
+{
+   RELABSD_PROTOCOL_OK,
+   RELABSD_PROTOCOL_UNKNOWN_COMMAND,
+   RELABSD_PROTOCOL_INVALID_ARGUMENTS,
+   RELABSD_PROTOCOL_UNKNOWN_DEVICE,
+   RELABSD_PROTOCOL_REQUEST_TOO_LARGE,
+   RELABSD_PROTOCOL_AXES_STATE,
+   /* The server was not started with what the command needs. */
+   RELABSD_PROTOCOL_UNAVAILABLE,
+   /* The server could not carry the command out (see its logs). */
+   RELABSD_PROTOCOL_FAILED
+};
+
+/*
+ * Sent after each frame of the device, unless the client is too slow to
+ * receive them all, in which case it gets the latest state as soon as it can.
+ * Axes are indexed by 'enum relabsd_axis_name'.
+ */
+struct relabsd_protocol_axes_state
+{
+   /* Number of frames the device received, and of resets of its axes. */
+   uint64_t frame;
+   /* Number of frames since the previous state that were not sent. */
+   uint32_t skipped_frames;
+   /* The last value received for each axis, before any conversion. */
+   int32_t inputs[RELABSD_AXIS_VALID_AXES_COUNT];
+   /* The last value sent for each axis by the virtual device. */
+   int32_t values[RELABSD_AXIS_VALID_AXES_COUNT];
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <relabsd/replay_types.h>
+
+/*
+ * Records the events of 'physical_device_file_name' into a trace, until
+ * interrupted.
+ */
+int relabsd_replay_record_main
+(
+   const char physical_device_file_name [const restrict static 1],
+   const char trace_file_name [const restrict static 1]
+);
+
+/*
+ * Converts the events of a trace 'repetitions' times, as fast as possible,
+ * according to 'configuration_file_name'. The resulting events are written to
+ * 'output_file_name', as 'struct input_event'.
+ */
+int relabsd_replay_run_main
+(
+   const char configuration_file_name [const restrict static 1],
+   const char trace_file_name [const restrict static 1],
+   const char output_file_name [const restrict static 1],
+   const int repetitions
+);
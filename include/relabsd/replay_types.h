@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <linux/input.h>
+
+/*
+ * Traces start with this (8 bytes long) identifier, followed by a
+ * 'struct relabsd_replay_capabilities' describing the recorded device, then by
+ * as many 'struct relabsd_replay_event' as there are recorded events, all in
+ * the machine's byte order.
+ */
+#define RELABSD_REPLAY_TRACE_MAGIC "relabsd\x02"
+#define RELABSD_REPLAY_TRACE_MAGIC_SIZE 8
+
+#define RELABSD_REPLAY_NAME_SIZE 256
+/* Enough bits for the codes of any event type. */
+#define RELABSD_REPLAY_CODES_SIZE ((KEY_CNT + 7) / 8)
+#define RELABSD_REPLAY_PROPERTIES_SIZE ((INPUT_PROP_CNT + 7) / 8)
+
+struct relabsd_replay_abs_info
+{
+   int32_t value;
+   int32_t minimum;
+   int32_t maximum;
+   int32_t fuzz;
+   int32_t flat;
+   int32_t resolution;
+};
+
+/* What the recorded device reported having, when the recording started. */
+struct relabsd_replay_capabilities
+{
+   /* '\0' terminated. */
+   char name[RELABSD_REPLAY_NAME_SIZE];
+   uint16_t bus_type;
+   uint16_t vendor;
+   uint16_t product;
+   uint16_t version;
+   /* Bit 'p' is set if the device has the input property 'p'. */
+   uint8_t properties[RELABSD_REPLAY_PROPERTIES_SIZE];
+   /* Bit 'c' of 'codes[t]' is set if the device has events 't' of code 'c'. */
+   uint8_t codes[EV_CNT][RELABSD_REPLAY_CODES_SIZE];
+   /* Only meaningful for the EV_ABS codes the device has. */
+   struct relabsd_replay_abs_info abs_info[ABS_CNT];
+};
+
+struct relabsd_replay_event
+{
+   /* Microseconds since the previous event. */
+   uint32_t delay;
+   uint16_t type;
+   uint16_t code;
+   int32_t value;
+};
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <time.h>
+
+#include <relabsd/protocol_types.h>
 #include <relabsd/server_types.h>
 
 int relabsd_server_main
@@ -16,6 +19,8 @@ void relabsd_server_interrupt (void);
 int relabsd_server_initialize_signal_handlers (void);
 void relabsd_server_finalize_signal_handlers (void);
 int relabsd_server_get_interruption_file_descriptor (void);
+int relabsd_server_get_signal_file_descriptor (void);
+void relabsd_server_handle_signals (void);
 
 int relabsd_server_create_communication_thread
 (
@@ -28,22 +33,346 @@ int relabsd_server_create_communication_node
    int socket [const restrict static 1]
 );
 
+int relabsd_server_initialize_conversion
+(
+   struct relabsd_server server [const static 1]
+);
+
+void relabsd_server_finalize_conversion
+(
+   struct relabsd_server server [const static 1]
+);
+
+/*
+ * Converts the inputs of all the server's devices, until the server is
+ * interrupted. Can be run by multiple threads at once.
+ * Returns -1 if it could no longer wait for inputs, in which case it
+ * interrupted the server, 0 otherwise.
+ */
 int relabsd_server_conversion_loop
 (
    struct relabsd_server server [const static 1]
 );
 
+int relabsd_server_create_conversion_threads
+(
+   struct relabsd_server server [const static 1]
+);
+
+int relabsd_server_join_conversion_threads
+(
+   struct relabsd_server server [const static 1]
+);
+
+/*
+ * Pins 'thread' to the CPUs and gives it the real-time policy the parameters
+ * ask for, if any.
+ */
+int relabsd_server_set_conversion_thread_scheduling
+(
+   const struct relabsd_server server [const static 1],
+   const pthread_t thread
+);
+
+/*
+ * If the conversion threads use a real-time policy, gives 'thread' a higher
+ * priority than theirs (if possible), so that a stalled conversion thread
+ * cannot keep it from running. It is not pinned to their CPUs.
+ */
+int relabsd_server_set_stall_watchdog_scheduling
+(
+   const struct relabsd_server server [const static 1],
+   const pthread_t thread
+);
+
+/* Locks all of the server's memory, if the parameters ask for it. */
+int relabsd_server_lock_memory
+(
+   const struct relabsd_server server [const static 1]
+);
+
 int relabsd_server_join_communication_thread
 (
    struct relabsd_server server [const static 1]
 );
 
-int relabsd_server_handle_client
+/*
+ * Handles the request at the start of the client's input ('request_length'
+ * being the length given by its header), and adds the reply to the client's
+ * output. Never waits on the client.
+ */
+void relabsd_server_handle_request
 (
-   const int socket,
+   const size_t request_length,
+   struct relabsd_server_client client [const static 1],
    struct relabsd_server server [const static 1]
 );
 
+/* Adds a reply made of a single 'status' to the client's output. */
+void relabsd_server_reject_request
+(
+   const enum relabsd_protocol_status status,
+   struct relabsd_server_client client [const static 1]
+);
+
+/*
+ * Makes the conversion use the device's pending parameters, starting from its
+ * next frame boundary. 'device->mutex' must be held, and
+ * 'relabsd_server_wake_up_device' called once it is released.
+ */
+void relabsd_server_publish_device_parameters
+(
+   struct relabsd_server_device device [const static 1]
+);
+
+/*
+ * To be called after each release of 'device->mutex' by a client. Wakes the
+ * thread converting the device's inputs up if it needs to apply parameters.
+ */
+void relabsd_server_wake_up_device
+(
+   struct relabsd_server_device device [const static 1]
+);
+
+/*
+ * Only to be called by the thread converting the device's inputs, at a frame
+ * boundary. Never waits for 'device->mutex'.
+ *
+ * Returns 1 if the parameters were updated,
+ *         0 otherwise.
+ */
+int relabsd_server_update_device_parameters
+(
+   struct relabsd_server_device device [const static 1]
+);
+
+/*
+ * Converts an event from the physical device, adding the result (if any) to the
+ * virtual device's current frame.
+ */
+void relabsd_server_convert_event
+(
+   struct relabsd_server_device device [const restrict static 1],
+   const unsigned int input_type,
+   const unsigned int input_code,
+   int value
+);
+
+/*
+ * Creates the virtual device that will replace the device's current one, if
+ * 'pending_parameters' requires it. 'device->mutex' must be held. The
+ * conversion switches to it once the parameters are published and it has been
+ * woken up, even if the device has no input.
+ */
+void relabsd_server_prepare_virtual_device_replacement
+(
+   struct relabsd_server_device device [const static 1]
+);
+
+/* Builds the device's conversion table according to its parameters. */
+void relabsd_server_update_conversion_table
+(
+   struct relabsd_server_device device [const static 1]
+);
+
+void relabsd_server_initialize_statistics
+(
+   struct relabsd_server_device device [const static 1]
+);
+
+/*
+ * Counts a hold of the device's mutex, which started at 'start'. Must be
+ * called before releasing the mutex.
+ */
+void relabsd_server_record_mutex_hold
+(
+   struct relabsd_server_device device [const static 1],
+   const struct timespec start [const restrict static 1]
+);
+
+/* The following four must be called while holding the device's mutex. */
+unsigned long int relabsd_server_get_statistic
+(
+   const struct relabsd_server_device device [const static 1],
+   const enum relabsd_server_statistic statistic
+);
+
+unsigned long int relabsd_server_get_axis_statistic
+(
+   const struct relabsd_server_device device [const static 1],
+   const enum relabsd_axis_name axis_name,
+   const enum relabsd_axis_statistic statistic
+);
+
+unsigned long int relabsd_server_get_stall_statistic
+(
+   const struct relabsd_server_device device [const static 1],
+   const enum relabsd_server_conversion_stage stage,
+   const enum relabsd_server_stall_statistic statistic
+);
+
+void relabsd_server_reset_statistics
+(
+   struct relabsd_server_device device [const static 1]
+);
+
+/*
+ * Stalls are only detected if 'budget' (in microseconds) is not 0. To be
+ * called before the device is first converted.
+ */
+void relabsd_server_initialize_stall_monitor
+(
+   const long int budget,
+   struct relabsd_server_device device [const static 1]
+);
+
+/*
+ * The following three are only to be called by the thread converting the
+ * device. It starts handling the device in 'stage'.
+ */
+void relabsd_server_start_stall_monitoring
+(
+   const enum relabsd_server_conversion_stage stage,
+   struct relabsd_server_device device [const static 1]
+);
+
+void relabsd_server_enter_conversion_stage
+(
+   const enum relabsd_server_conversion_stage stage,
+   struct relabsd_server_device device [const static 1]
+);
+
+/*
+ * Once done handling the device. Counts and reports a stall if it took longer
+ * than the budget, attributing it to the stage that took the most time.
+ */
+void relabsd_server_stop_stall_monitoring
+(
+   struct relabsd_server_device device [const static 1]
+);
+
+/*
+ * If stalls are detected, the watchdog reports those of the devices that are
+ * still ongoing, checking once per budget while devices are being handled. It
+ * waits for the conversion threads to wake it up otherwise.
+ */
+int relabsd_server_create_stall_watchdog
+(
+   struct relabsd_server server [const static 1]
+);
+
+/* Only once the server was interrupted. */
+int relabsd_server_join_stall_watchdog
+(
+   struct relabsd_server server [const static 1]
+);
+
+const char * relabsd_server_get_conversion_stage_name
+(
+   const enum relabsd_server_conversion_stage stage
+);
+
+int relabsd_server_initialize_subscriptions (void);
+void relabsd_server_finalize_subscriptions (void);
+int relabsd_server_get_subscriptions_file_descriptor (void);
+
+/*
+ * Only to be called by the thread converting the device's inputs, at the end
+ * of each frame and after each reset of the device's axes. Copies the axes'
+ * state for the communication thread, and notifies it if clients subscribed
+ * to the device's axes.
+ */
+void relabsd_server_publish_axes_state
+(
+   struct relabsd_server_device device [const static 1]
+);
+
+/*
+ * To be called by the communication thread before sending the axes states, so
+ * that the frames completed afterwards are notified again.
+ */
+void relabsd_server_acknowledge_subscriptions_notification (void);
+
+/* Replaces the client's previous subscription, if any. */
+void relabsd_server_subscribe
+(
+   struct relabsd_server_device device [const static 1],
+   struct relabsd_server_client client [const static 1]
+);
+
+void relabsd_server_unsubscribe
+(
+   struct relabsd_server_client client [const static 1]
+);
+
+/*
+ * Adds the latest axes state of the client's subscription to its output, if
+ * it has not already been sent. If too many of them are already waiting to be
+ * sent, this one is dropped instead, and 'client->has_missed_axes_states' is
+ * set.
+ */
+void relabsd_server_send_axes_state
+(
+   struct relabsd_server_client client [const static 1]
+);
+
+/*
+ * Creates the shared memory object the axes of the server's devices are
+ * exported to, if its parameters ask for one.
+ */
+int relabsd_server_create_shared_state
+(
+   struct relabsd_server server [const static 1]
+);
+
+void relabsd_server_destroy_shared_state
+(
+   struct relabsd_server server [const static 1]
+);
+
+/*
+ * Only to be called by the thread converting the device's inputs, if
+ * 'device->shared_state' is not NULL. Never waits on the readers.
+ */
+void relabsd_server_write_shared_state
+(
+   struct relabsd_server_device device [const static 1]
+);
+
+/*
+ * Creates the shared memory object the events of the server's devices are
+ * published to, if its parameters ask for one.
+ */
+int relabsd_server_create_output_rings
+(
+   struct relabsd_server server [const static 1]
+);
+
+/* Only once no thread converts the devices' inputs anymore. */
+void relabsd_server_destroy_output_rings
+(
+   struct relabsd_server server [const static 1]
+);
+
+/*
+ * Gives the client a reader slot of the device's output ring, replacing its
+ * previous one, if any. 'client->passed_file' is then a new eventfd, which
+ * the server closes when the client stops being the slot's reader.
+ *
+ * Returns the slot on success,
+ *         -1 if the device has no output ring or it has no free slot.
+ */
+int relabsd_server_add_output_ring_reader
+(
+   struct relabsd_server_device device [const static 1],
+   struct relabsd_server_client client [const static 1]
+);
+
+void relabsd_server_remove_output_ring_reader
+(
+   struct relabsd_server_client client [const static 1]
+);
+
 void relabsd_server_destroy_communication_node
 (
    const char socket_name [const restrict static 1],
@@ -2,18 +2,296 @@
 
 /**** POSIX *******************************************************************/
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+
+/**** LIBEVDEV ****************************************************************/
+#include <libevdev/libevdev.h>
 
 /**** RELABSD *****************************************************************/
+#include <relabsd/config.h>
+#include <relabsd/shared_state_types.h>
+
 #include <relabsd/config/parameters_types.h>
 
+#include <relabsd/device/axis_types.h>
+#include <relabsd/device/output_ring_types.h>
+
 #include <relabsd/device/physical_device_types.h>
 #include <relabsd/device/virtual_device_types.h>
 
-struct relabsd_server
+#include <relabsd/util/capture_ring_types.h>
+#include <relabsd/util/latency_histogram_types.h>
+
+enum relabsd_server_event_source_type
+{
+   RELABSD_SERVER_DEVICE_SOURCE,
+   RELABSD_SERVER_PHYSICAL_DEVICE_SOURCE,
+   RELABSD_SERVER_TIMEOUT_SOURCE,
+   RELABSD_SERVER_PARAMETERS_SOURCE,
+   RELABSD_SERVER_SIGNAL_SOURCE,
+   RELABSD_SERVER_INTERRUPTION_SOURCE
+};
+
+struct relabsd_server_device;
+
+/*
+ * The latest values of a device's axes, for the clients that subscribed to
+ * them. 'inputs' and 'values' are only used by the thread converting the
+ * device, which copies them into 'published_inputs' and 'published_values' at
+ * each frame boundary. The copies and 'frame_count' are protected by a seqlock
+ * ('sequence'), read as in 'relabsd/shared_state_types.h', so that clients
+ * never get values from different frames, and the conversion never waits on
+ * them.
+ */
+struct relabsd_server_axes_state
+{
+   int inputs[RELABSD_AXIS_VALID_AXES_COUNT];
+   int values[RELABSD_AXIS_VALID_AXES_COUNT];
+   atomic_uint sequence;
+   atomic_int published_inputs[RELABSD_AXIS_VALID_AXES_COUNT];
+   atomic_int published_values[RELABSD_AXIS_VALID_AXES_COUNT];
+   /* Frames the device received, and resets of its axes after a timeout. */
+   atomic_ulong frame_count;
+   /* Only modified by the communication thread. */
+   atomic_int subscribers_count;
+};
+
+/*
+ * Counters of a device, for the "--stats" client command. Each counter only
+ * has one thread modifying it at a time (see 'relabsd/util/counter.h').
+ */
+enum relabsd_server_statistic
+{
+   /* Events read from the physical device. */
+   RELABSD_SERVER_EVENTS_READ,
+   /* Events given to the virtual device. */
+   RELABSD_SERVER_EVENTS_SENT,
+   RELABSD_SERVER_FRAMES_READ,
+   RELABSD_SERVER_FRAMES_WRITTEN,
+   /* Frames the virtual device failed to write. */
+   RELABSD_SERVER_WRITE_ERRORS,
+   RELABSD_SERVER_TIMEOUTS,
+   /* Times the physical device's events were dropped by the kernel. */
+   RELABSD_SERVER_LATE_EPISODES,
+   RELABSD_SERVER_LATE_EVENTS_DISCARDED,
+   RELABSD_SERVER_VIRTUAL_DEVICE_RECREATIONS,
+   /* Only modified while holding the device's mutex. */
+   RELABSD_SERVER_MUTEX_HOLDS,
+   RELABSD_SERVER_MUTEX_HOLD_MICROSECONDS,
+   RELABSD_SERVER_STATISTICS_COUNT
+};
+
+/*
+ * What the conversion thread is doing with a device, to attribute its stalls.
+ */
+enum relabsd_server_conversion_stage
+{
+   /* Applying the parameters published by clients. */
+   RELABSD_SERVER_PARAMETERS_STAGE,
+   RELABSD_SERVER_READING_STAGE,
+   RELABSD_SERVER_CONVERTING_STAGE,
+   /* Ending the frame, which includes writing it to the virtual device. */
+   RELABSD_SERVER_WRITING_STAGE,
+   /* Making the axes available to the clients and shared memory readers. */
+   RELABSD_SERVER_PUBLISHING_STAGE,
+   RELABSD_SERVER_TIMER_STAGE,
+   RELABSD_SERVER_RESETTING_STAGE,
+   RELABSD_SERVER_CONVERSION_STAGES_COUNT
+};
+
+/* Counters of each conversion stage, for statistics. */
+enum relabsd_server_stall_statistic
+{
+   /* Stalls during which the stage is the one that took the most time. */
+   RELABSD_SERVER_STALLS,
+   /* The whole duration of these stalls. */
+   RELABSD_SERVER_STALL_MICROSECONDS,
+   RELABSD_SERVER_STALL_STATISTICS_COUNT
+};
+
+/*
+ * The counters only ever increase, so that resetting them does not race with
+ * the conversion thread: 'baseline' is the value they had when last reset, and
+ * is only accessed while holding the device's mutex.
+ */
+struct relabsd_server_statistics
+{
+   atomic_ulong counters[RELABSD_SERVER_STATISTICS_COUNT];
+   /* By 'enum relabsd_axis_name', then by 'enum relabsd_axis_statistic'. */
+   atomic_ulong axes
+      [RELABSD_AXIS_VALID_AXES_COUNT][RELABSD_AXIS_STATISTICS_COUNT];
+   /*
+    * By 'enum relabsd_server_conversion_stage', then by
+    * 'enum relabsd_server_stall_statistic'.
+    */
+   atomic_ulong stalls
+      [RELABSD_SERVER_CONVERSION_STAGES_COUNT]
+      [RELABSD_SERVER_STALL_STATISTICS_COUNT];
+   /* Only accessed while holding the device's mutex, and reset to 0. */
+   unsigned long int longest_mutex_hold_microseconds;
+   unsigned long int baseline[RELABSD_SERVER_STATISTICS_COUNT];
+   unsigned long int axes_baseline
+      [RELABSD_AXIS_VALID_AXES_COUNT][RELABSD_AXIS_STATISTICS_COUNT];
+   unsigned long int stalls_baseline
+      [RELABSD_SERVER_CONVERSION_STAGES_COUNT]
+      [RELABSD_SERVER_STALL_STATISTICS_COUNT];
+};
+
+/*
+ * Times what a conversion thread does with a device each time it handles it,
+ * and reports the times it took longer than 'budget' as stalls. Only used by
+ * the thread converting the device, except for the 'ongoing_*' fields.
+ */
+struct relabsd_server_stall_monitor
+{
+   /* In microseconds, 0 if stalls are not detected. */
+   long int budget;
+   enum relabsd_server_conversion_stage stage;
+   struct timespec handling_start;
+   struct timespec stage_start;
+   /* Time spent in each stage since 'handling_start'. */
+   long int stage_nanoseconds[RELABSD_SERVER_CONVERSION_STAGES_COUNT];
+   /*
+    * For the stall watchdog, which reports stalls before they end:
+    * 'handling_start' in nanoseconds, 0 while the device is not handled, and
+    * 'stage'.
+    */
+   atomic_llong ongoing_handling_start;
+   atomic_int ongoing_stage;
+   /* Number of times the device was handled. */
+   atomic_ulong handlings_count;
+   /* Only used by the stall watchdog. */
+   long long int reported_handling_start;
+   unsigned long int watched_handlings_count;
+};
+
+/* What the conversion loop's epoll reports on. */
+struct relabsd_server_event_source
+{
+   enum relabsd_server_event_source_type type;
+   int file;
+   struct relabsd_server_device * device;
+};
+
+/*
+ * A physical device, the virtual device it feeds, and their parameters.
+ *
+ * Only one conversion thread at a time handles a given device, and it is the
+ * only one to use 'parameters', 'physical_device' and 'virtual_device'.
+ * Clients modify 'pending_parameters' instead, while holding 'mutex', and then
+ * publish them by increasing 'parameters_generation'. The conversion thread
+ * copies them into 'parameters' at the next frame boundary. It is woken up
+ * through 'wakeup' (an eventfd) when the device has no input, and also when it
+ * could not get 'mutex' to copy them: it then sets 'wakeup_is_needed', which
+ * the client checks once it has released 'mutex'.
+ * 'conversions' is indexed by EV_REL code, and is built from 'parameters'.
+ *
+ * A client's request is applied to 'batch_parameters', which only replace
+ * 'pending_parameters' if all of its commands are valid. 'mutex' is held from
+ * the first command of the request that applies to the device to the end of
+ * the request ('is_in_batch'). These fields are only used by the thread
+ * handling clients.
+ *
+ * Changes that need a new virtual device have it created by the client, from
+ * 'pending_parameters', while the current one keeps being used. The conversion
+ * thread switches to it when applying the parameters. Both the replacement and
+ * the description of 'virtual_device' are only accessed while holding 'mutex'.
+ */
+struct relabsd_server_device
 {
    pthread_mutex_t mutex;
-   pthread_t communication_thread;
+   atomic_uint parameters_generation;
+   unsigned int applied_parameters_generation;
+   atomic_int wakeup_is_needed;
+   int wakeup;
+   struct relabsd_parameters pending_parameters;
+   struct relabsd_parameters batch_parameters;
+   int is_in_batch;
+   int batch_has_changes;
+   struct timespec batch_lock_time;
+   /*
+    * Position of the reply to the request's capture dump, which is only done
+    * once 'mutex' has been released, or 0.
+    */
+   size_t capture_dump_reply_position;
+   int has_replacement_virtual_device;
+   /* In microseconds. */
+   long int replacement_virtual_device_creation_time;
+   struct relabsd_virtual_device replacement_virtual_device;
+
+   int epoll;
+   int timer;
+   int timer_is_armed;
+   struct relabsd_server_event_source device_source;
+   struct relabsd_server_event_source input_source;
+   struct relabsd_server_event_source timeout_source;
+   struct relabsd_server_event_source parameters_source;
    struct relabsd_parameters parameters;
+   struct relabsd_axis_conversion conversions[REL_CNT];
    struct relabsd_physical_device physical_device;
    struct relabsd_virtual_device virtual_device;
+   /* From the physical device's timestamp to the write to uinput. */
+   struct relabsd_latency_histogram latency_histogram;
+   struct relabsd_server_axes_state axes_state;
+   /* NULL if the server does not export its axes. */
+   struct relabsd_shared_device_state * shared_state;
+   /* Its ring is NULL if the server does not publish its events. */
+   struct relabsd_output_ring_writer output_ring;
+   /* NULL if the server does not keep the device's last events. */
+   struct relabsd_capture_ring * capture_ring;
+   struct relabsd_server_statistics statistics;
+   struct relabsd_server_stall_monitor stall_monitor;
+};
+
+/*
+ * A connection to the server's communication node (see
+ * 'relabsd/protocol_types.h'). Requests are only handled once they have been
+ * fully received, and only while no reply is waiting to be sent.
+ */
+struct relabsd_server_client
+{
+   int socket;
+   /* What the epoll currently waits for on 'socket'. */
+   uint32_t epoll_events;
+   /* The client will not send anything else. */
+   int has_ended;
+   /* Where the client's commands apply. */
+   struct relabsd_server_device * device;
+   /* The device whose axes are sent to the client, if any. */
+   struct relabsd_server_device * subscription;
+   unsigned long int last_sent_frame;
+   /* Axes states were dropped because the client was too slow. */
+   int has_missed_axes_states;
+   /* The output ring the client reads from, if any. */
+   struct relabsd_server_device * output_ring_device;
+   int output_ring_slot;
+   /* A file descriptor to send along with the output, or -1. */
+   int passed_file;
+   size_t input_length;
+   char input[RELABSD_SERVER_CLIENT_INPUT_SIZE];
+   size_t output_length;
+   size_t output_index;
+   char output[RELABSD_SERVER_CLIENT_OUTPUT_SIZE];
+};
+
+struct relabsd_server
+{
+   pthread_t communication_thread;
+   pthread_t stall_watchdog;
+   pthread_t conversion_threads[RELABSD_SERVER_MAX_WORKERS];
+   int conversion_thread_count;
+   int conversion_epoll;
+   struct relabsd_server_event_source signal_source;
+   struct relabsd_server_event_source interruption_source;
+   struct relabsd_parameters parameters;
+   int devices_count;
+   /* Devices whose input reached its end, and that are thus no longer read. */
+   atomic_int ended_devices_count;
+   struct relabsd_server_device * devices;
+   struct relabsd_shared_state * shared_state;
+   size_t shared_state_size;
+   struct relabsd_output_rings * output_rings;
+   size_t output_rings_size;
 };
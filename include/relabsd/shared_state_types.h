@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include <relabsd/device/axis_types.h>
+
+/*
+ * Layout of the POSIX shared memory object a server exports its axes to (see
+ * its "--export" option), for readers that only need their current values.
+ * Readers can map it read-only and poll it at any rate, without syscalls.
+ *
+ * Each device is protected by a seqlock: its 'sequence' is odd while the
+ * device is being written to. Readers copy the device, then start over if
+ * 'sequence' was odd or has changed:
+ *
+ *    do
+ *    {
+ *       before =
+ *          atomic_load_explicit(&(device->sequence), memory_order_acquire);
+ *
+ *       (relaxed loads of the other fields)
+ *
+ *       atomic_thread_fence(memory_order_acquire);
+ *
+ *       after =
+ *          atomic_load_explicit(&(device->sequence), memory_order_relaxed);
+ *    }
+ *    while (((before & 1) != 0) || (before != after));
+ *
+ * Devices are in the order they were given to the server. Axes are indexed by
+ * 'enum relabsd_axis_name'. Integers are in the byte order of the machine.
+ */
+#define RELABSD_SHARED_STATE_MAGIC "relabsd\x02"
+#define RELABSD_SHARED_STATE_MAGIC_SIZE 8
+
+struct relabsd_shared_device_state
+{
+   /* Devices are written by different threads, so they do not share lines. */
+   _Alignas(64) _Atomic uint32_t sequence;
+   /* Number of frames the device received, and of resets of its axes. */
+   _Atomic uint64_t frame;
+   /* The last value received for each axis, before any conversion. */
+   _Atomic int32_t inputs[RELABSD_AXIS_VALID_AXES_COUNT];
+   /* The last value sent for each axis by the virtual device. */
+   _Atomic int32_t values[RELABSD_AXIS_VALID_AXES_COUNT];
+   /* What the filters of each axis currently base themselves on. */
+   _Atomic int32_t previous_values[RELABSD_AXIS_VALID_AXES_COUNT];
+};
+
+struct relabsd_shared_state
+{
+   char magic[RELABSD_SHARED_STATE_MAGIC_SIZE];
+   uint32_t devices_count;
+   struct relabsd_shared_device_state devices[];
+};
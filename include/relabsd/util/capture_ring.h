@@ -0,0 +1,41 @@
+#pragma once
+
+#include <time.h>
+
+#include <relabsd/util/capture_ring_types.h>
+
+/* Returns NULL on (fatal) error. */
+struct relabsd_capture_ring * relabsd_capture_ring_create (void);
+
+void relabsd_capture_ring_destroy
+(
+   struct relabsd_capture_ring * const ring
+);
+
+/*
+ * 'type' includes RELABSD_CAPTURE_RING_OUTPUT for events sent by the virtual
+ * device. Only one thread at a time can add events to a given ring.
+ */
+void relabsd_capture_ring_add
+(
+   struct relabsd_capture_ring ring [const static 1],
+   const struct timespec time [const restrict static 1],
+   const unsigned int type,
+   const unsigned int code,
+   const int value
+);
+
+/*
+ * Writes the events the ring currently holds to two traces (in the format of
+ * "relabsd-replay"): the events received to 'inputs_file_name', and those sent
+ * to 'outputs_file_name'. Events can keep being added in the meantime.
+ *
+ * Returns 0 on success,
+ *         -1 on error.
+ */
+int relabsd_capture_ring_dump
+(
+   const struct relabsd_capture_ring ring [const static 1],
+   const char inputs_file_name [const restrict static 1],
+   const char outputs_file_name [const restrict static 1]
+);
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include <relabsd/config.h>
+
+/* Added to the type of the events that were sent by the virtual device. */
+#define RELABSD_CAPTURE_RING_OUTPUT 0x8000
+
+struct relabsd_capture_ring_event
+{
+   /* CLOCK_MONOTONIC, in nanoseconds. */
+   _Atomic uint64_t time;
+   _Atomic uint16_t type;
+   _Atomic uint16_t code;
+   _Atomic int32_t value;
+};
+
+/*
+ * The last events a device received and sent. Only its conversion thread adds
+ * events, which never waits: other threads copy them while they are being
+ * overwritten, and discard those that were.
+ * Event 'i' is at 'events[i % RELABSD_CAPTURE_RING_SIZE]'.
+ */
+struct relabsd_capture_ring
+{
+   _Atomic uint64_t write_index;
+   struct relabsd_capture_ring_event events[RELABSD_CAPTURE_RING_SIZE];
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdatomic.h>
+
+/*
+ * Adds to an 'atomic_ulong' that only one thread modifies at a time, but that
+ * others can read at any time. This avoids the cost of an atomic
+ * read-modify-write.
+ */
+#define RELABSD_COUNTER_ADD(counter, amount)\
+   atomic_store_explicit\
+   (\
+      (counter),\
+      (atomic_load_explicit((counter), memory_order_relaxed) + (amount)),\
+      memory_order_relaxed\
+   )
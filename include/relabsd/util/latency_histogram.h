@@ -0,0 +1,36 @@
+#pragma once
+
+#include <relabsd/util/latency_histogram_types.h>
+
+void relabsd_latency_histogram_initialize
+(
+   struct relabsd_latency_histogram histogram [const restrict static 1]
+);
+
+/* Only one thread may add values to a given histogram. */
+void relabsd_latency_histogram_add
+(
+   struct relabsd_latency_histogram histogram [const restrict static 1],
+   const unsigned long int microseconds
+);
+
+unsigned long int relabsd_latency_histogram_get_count
+(
+   const struct relabsd_latency_histogram histogram [const restrict static 1]
+);
+
+unsigned long int relabsd_latency_histogram_get_max
+(
+   const struct relabsd_latency_histogram histogram [const restrict static 1]
+);
+
+/*
+ * Returns the value under which 'permille' thousandths of the latencies are,
+ * rounded up to the upper limit of its bucket.
+ * Returns 0 if the histogram is empty.
+ */
+unsigned long int relabsd_latency_histogram_get_percentile
+(
+   const struct relabsd_latency_histogram histogram [const restrict static 1],
+   const unsigned int permille
+);
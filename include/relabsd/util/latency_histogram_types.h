@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdatomic.h>
+
+/*
+ * Latencies are counted in microseconds. Each power of two is split into
+ * (1 << RELABSD_LATENCY_HISTOGRAM_PRECISION) buckets, up to
+ * (1 << RELABSD_LATENCY_HISTOGRAM_RANGE) microseconds. Anything above that
+ * goes into the last bucket.
+ */
+#define RELABSD_LATENCY_HISTOGRAM_PRECISION 3
+#define RELABSD_LATENCY_HISTOGRAM_RANGE 24
+#define RELABSD_LATENCY_HISTOGRAM_BUCKETS_COUNT \
+   ( \
+      ( \
+         ( \
+            RELABSD_LATENCY_HISTOGRAM_RANGE \
+            - RELABSD_LATENCY_HISTOGRAM_PRECISION \
+         ) \
+         + 1 \
+      ) \
+      << RELABSD_LATENCY_HISTOGRAM_PRECISION \
+   )
+
+/*
+ * Only a single thread adds values, but any can read them, hence the use of
+ * atomics (which are never incremented atomically).
+ */
+struct relabsd_latency_histogram
+{
+   atomic_ulong buckets[RELABSD_LATENCY_HISTOGRAM_BUCKETS_COUNT];
+   atomic_ulong count;
+   atomic_ulong max;
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+/*
+ * Until 'relabsd_log_start' is called (and once 'relabsd_log_stop' has been),
+ * messages are written to stderr right away. In between, they are queued for
+ * a writer thread, so that threads logging never wait on stderr. The writer
+ * thread merges identical consecutive messages, and reports those that were
+ * dropped because the queue was full or because the same place in the code
+ * logged too often (see RELABSD_LOG_RATE_LIMIT).
+ *
+ * Use the macros of 'relabsd/debug.h' instead of this directly.
+ */
+void relabsd_log_print
+(
+   const int is_rate_limited,
+   const char format [const restrict static 1],
+   ...
+);
+
+/*
+ * Must be called before creating any other thread (or after joining them).
+ * Returns 0 on success,
+ *         -1 on error, in which case messages keep being written right away.
+ */
+int relabsd_log_start (void);
+
+/* Writes all the messages that were queued. */
+void relabsd_log_stop (void);
@@ -0,0 +1,36 @@
+#pragma once
+
+/*
+ * USDT probes of the "relabsd" provider, for tracers such as perf or bpftrace
+ * (e.g. "bpftrace -e 'usdt:./relabsd:relabsd:axis_filter { ... }'"). Each
+ * probe is a single nop until a tracer attaches to it, but its arguments are
+ * still computed, so they should stay trivial.
+ *
+ * Probes are only compiled in with RELABSD_ENABLE_PROBES (CMake option of the
+ * same name), which requires <sys/sdt.h> (systemtap's SDT header).
+ *
+ * physical_read(type, code, value): an event was read from the physical
+ *    device.
+ * axis_filter(rel_code, input, output, result): an axis' filter returned
+ *    'result' (-1: dropped, 0: passed as is, 1: converted).
+ * virtual_write(events_count, result): a frame was written by the virtual
+ *    device's output backend ('result' < 0 on error).
+ * reset_axes(physical_device_file_name): the axes were reset after the
+ *    physical device went idle.
+ * parameters_commit(physical_device_file_name, generation): client commands
+ *    changed the device's parameters.
+ */
+#ifdef RELABSD_ENABLE_PROBES
+   #include <sys/sdt.h>
+
+   #define RELABSD_PROBE1(name, a) DTRACE_PROBE1(relabsd, name, a)
+   #define RELABSD_PROBE2(name, a, b) DTRACE_PROBE2(relabsd, name, a, b)
+   #define RELABSD_PROBE3(name, a, b, c) DTRACE_PROBE3(relabsd, name, a, b, c)
+   #define RELABSD_PROBE4(name, a, b, c, d)\
+      DTRACE_PROBE4(relabsd, name, a, b, c, d)
+#else
+   #define RELABSD_PROBE1(name, a)
+   #define RELABSD_PROBE2(name, a, b)
+   #define RELABSD_PROBE3(name, a, b, c)
+   #define RELABSD_PROBE4(name, a, b, c, d)
+#endif
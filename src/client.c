@@ -1,27 +1,46 @@
 /**** POSIX *******************************************************************/
 #include <errno.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/un.h>
 
+#include <fcntl.h>
+#include <poll.h>
+#include <stdatomic.h>
+
+/**** LIBEVDEV ****************************************************************/
+#include <libevdev/libevdev.h>
+
 /**** RELABSD *****************************************************************/
 #include <relabsd/client.h>
 #include <relabsd/config.h>
 #include <relabsd/debug.h>
+#include <relabsd/output_ring_types.h>
+#include <relabsd/protocol_types.h>
 
 #include <relabsd/config/parameters.h>
 
+#include <relabsd/device/axis.h>
+
+#include <relabsd/util/string.h>
+
 /******************************************************************************/
 /**** LOCAL FUNCTIONS *********************************************************/
 /******************************************************************************/
+/* The last file descriptor the server sent along with its replies, or -1. */
+static int RELABSD_CLIENT_RECEIVED_FILE = -1;
+
 static int open_socket
 (
    const char socket_name [const restrict static 1],
-   FILE * s [const restrict static 1]
+   int socket_file [const restrict static 1]
 )
 {
    const int old_errno = errno;
@@ -68,43 +87,215 @@ static int open_socket
       return -1;
    }
 
-   errno = 0;
+   errno = old_errno;
 
-   *s = fdopen(fd, "w+");
+   *socket_file = fd;
 
-   if (*s == ((FILE *) NULL))
+   RELABSD_S_DEBUG(RELABSD_DEBUG_PROGRAM_FLOW, "Opened socket to server.");
+
+   return 0;
+}
+
+static int append_argument
+(
+   const char argument [const restrict static 1],
+   char request [const restrict static RELABSD_SERVER_CLIENT_INPUT_SIZE],
+   size_t request_length [const restrict static 1]
+)
+{
+   size_t argument_length;
+
+   argument_length = strlen(argument);
+
+   /* +1: the '\n'. */
+   if
+   (
+      (argument_length + 1)
+      > (RELABSD_SERVER_CLIENT_INPUT_SIZE - *request_length)
+   )
    {
-      RELABSD_FATAL
+      RELABSD_S_FATAL("Too many commands for a single request.");
+
+      return -1;
+   }
+
+   (void) memcpy
+   (
+      (void *) (request + *request_length),
+      (const void *) argument,
+      argument_length
+   );
+
+   *request_length += argument_length;
+
+   request[*request_length] = '\n';
+   *request_length += 1;
+
+   return 0;
+}
+
+static int write_all
+(
+   const int socket_file,
+   const char data [const restrict static 1],
+   const size_t length
+)
+{
+   size_t written;
+   ssize_t result;
+
+   for (written = 0; written < length; written += (size_t) result)
+   {
+      errno = 0;
+
+      result =
+         write
+         (
+            socket_file,
+            (const void *) (data + written),
+            (length - written)
+         );
+
+      if (result == -1)
+      {
+         if (errno == EINTR)
+         {
+            result = 0;
+
+            continue;
+         }
+
+         RELABSD_FATAL("Unable to send the request: %s.", strerror(errno));
+
+         return -1;
+      }
+   }
+
+   return 0;
+}
+
+static void keep_received_file (struct msghdr message [const static 1])
+{
+   struct cmsghdr * control_header;
+
+   for
+   (
+      control_header = CMSG_FIRSTHDR(message);
+      (control_header != (struct cmsghdr *) NULL);
+      control_header = CMSG_NXTHDR(message, control_header)
+   )
+   {
+      if
       (
-         "Unable to open socket as a file: %s.",
-         strerror(errno)
+         (control_header->cmsg_level != SOL_SOCKET)
+         || (control_header->cmsg_type != SCM_RIGHTS)
+         || (control_header->cmsg_len != CMSG_LEN(sizeof(int)))
+      )
+      {
+         continue;
+      }
+
+      if (RELABSD_CLIENT_RECEIVED_FILE != -1)
+      {
+         (void) close(RELABSD_CLIENT_RECEIVED_FILE);
+      }
+
+      (void) memcpy
+      (
+         (void *) &RELABSD_CLIENT_RECEIVED_FILE,
+         (const void *) CMSG_DATA(control_header),
+         sizeof(int)
       );
+   }
+}
 
-      errno = old_errno;
+/* The file descriptors the server sends are kept (see 'keep_received_file'). */
+static int read_all
+(
+   const int socket_file,
+   char data [const restrict static 1],
+   const size_t length
+)
+{
+   union
+   {
+      struct cmsghdr header;
+      char buffer[CMSG_SPACE(sizeof(int))];
+   } control;
+   struct msghdr message;
+   struct iovec buffer;
+   size_t received;
+   ssize_t result;
+
+   for (received = 0; received < length; received += (size_t) result)
+   {
+      (void) memset((void *) &message, 0, sizeof(struct msghdr));
 
-      close(fd);
+      buffer.iov_base = (void *) (data + received);
+      buffer.iov_len = (length - received);
 
-      return -1;
-   }
+      message.msg_iov = &buffer;
+      message.msg_iovlen = 1;
+      message.msg_control = (void *) control.buffer;
+      message.msg_controllen = sizeof(control.buffer);
 
-   errno = old_errno;
+      errno = 0;
 
-   RELABSD_S_DEBUG(RELABSD_DEBUG_PROGRAM_FLOW, "Opened socket to server.");
+      result = recvmsg(socket_file, &message, MSG_CMSG_CLOEXEC);
+
+      if (result > 0)
+      {
+         keep_received_file(&message);
+      }
+
+      if (result == -1)
+      {
+         if (errno == EINTR)
+         {
+            result = 0;
+
+            continue;
+         }
+
+         RELABSD_FATAL("Unable to receive the reply: %s.", strerror(errno));
+
+         return -1;
+      }
+
+      if (result == 0)
+      {
+         RELABSD_S_FATAL("The server closed the connection.");
+
+         return -1;
+      }
+   }
 
    return 0;
 }
 
+/*
+ * Sends all the commands as a single request. 'commands' is set to the index
+ * (in 'argv') of each command, for the reply to refer to them.
+ */
 static int send_commands
 (
    const int argc,
    const char * const argv [const restrict static argc],
-   FILE socket [const restrict static 1]
+   const int socket_file,
+   int commands [const restrict static argc],
+   int commands_count [const restrict static 1]
 )
 {
+   char request[RELABSD_SERVER_CLIENT_INPUT_SIZE];
+   struct relabsd_protocol_frame_header header;
+   size_t request_length;
    int i, j;
 
    RELABSD_S_DEBUG(RELABSD_DEBUG_PROGRAM_FLOW, "Sending commands to server...");
 
+   request_length = sizeof(header);
+   *commands_count = 0;
+
    for (i = 3; i < argc;)
    {
       if (relabsd_parameters_argument_count_for(argv[i], &j) < 0)
@@ -115,14 +306,12 @@ static int send_commands
          return -1;
       }
 
-      if (fputs(argv[i], socket) == EOF)
-      {
-         // TODO: error
-      }
+      commands[*commands_count] = i;
+      *commands_count += 1;
 
-      if (fputc('\n', socket) == EOF)
+      if (append_argument(argv[i], request, &request_length) < 0)
       {
-         // TODO: error
+         return -1;
       }
 
       for
@@ -132,20 +321,20 @@ static int send_commands
          j--, i++
       )
       {
-         if (fputs(argv[i], socket) == EOF)
+         if (append_argument(argv[i], request, &request_length) < 0)
          {
-            // TODO: error
-         }
-
-         if (fputc('\n', socket) == EOF)
-         {
-            // TODO: error
+            return -1;
          }
       }
    }
 
-   if (fputc('\n', socket) == EOF)
+   header.length = (uint32_t) (request_length - sizeof(header));
+
+   (void) memcpy((void *) request, (const void *) &header, sizeof(header));
+
+   if (write_all(socket_file, request, request_length) < 0)
    {
+      return -1;
    }
 
    RELABSD_S_DEBUG(RELABSD_DEBUG_PROGRAM_FLOW, "Sent commands to server.");
@@ -153,13 +342,585 @@ static int send_commands
    return 0;
 }
 
+static const char * get_status_description
+(
+   const enum relabsd_protocol_status status
+)
+{
+   switch (status)
+   {
+      case RELABSD_PROTOCOL_OK:
+         return "success";
+
+      case RELABSD_PROTOCOL_UNKNOWN_COMMAND:
+         return "unknown command";
+
+      case RELABSD_PROTOCOL_INVALID_ARGUMENTS:
+         return "invalid arguments";
+
+      case RELABSD_PROTOCOL_UNKNOWN_DEVICE:
+         return "unknown device";
+
+      case RELABSD_PROTOCOL_REQUEST_TOO_LARGE:
+         return "request too large";
+
+      case RELABSD_PROTOCOL_UNAVAILABLE:
+         return "not available on this server";
+
+      case RELABSD_PROTOCOL_FAILED:
+         return "failed on the server";
+
+      default:
+         return "unknown status";
+   }
+}
+
+static int is_watch_command (const char command [const restrict static 1])
+{
+   return
+      (
+         RELABSD_STRING_EQUALS("-W", command)
+         || RELABSD_STRING_EQUALS("--watch", command)
+      );
+}
+
+static int is_read_ring_command
+(
+   const char command [const restrict static 1]
+)
+{
+   return
+      (
+         RELABSD_STRING_EQUALS("-R", command)
+         || RELABSD_STRING_EQUALS("--read-ring", command)
+      );
+}
+
+/*
+ * Prints the text of each reply, and reports the commands that failed. The
+ * text of the reply to a successful "--read-ring" is also copied into
+ * 'ring_description' (which is otherwise empty).
+ *
+ * Returns 0 if all commands succeeded,
+ *         -1 otherwise.
+ */
 static int receive_reply
 (
-   FILE socket [const restrict static 1]
+   const char * const argv [const restrict static 1],
+   const int socket_file,
+   const int commands [const restrict static 1],
+   const int commands_count,
+   char ring_description
+      [const restrict static RELABSD_SERVER_CLIENT_OUTPUT_SIZE]
+)
+{
+   char reply[RELABSD_SERVER_CLIENT_OUTPUT_SIZE];
+   struct relabsd_protocol_frame_header header;
+   struct relabsd_protocol_reply_header reply_header;
+   size_t i;
+   int command, result;
+
+   RELABSD_S_DEBUG(RELABSD_DEBUG_PROGRAM_FLOW, "Receiving server's reply...");
+
+   ring_description[0] = '\0';
+
+   if (read_all(socket_file, (char *) &header, sizeof(header)) < 0)
+   {
+      return -1;
+   }
+
+   if (header.length > sizeof(reply))
+   {
+      RELABSD_S_FATAL("The server's reply is too large.");
+
+      return -1;
+   }
+
+   if (read_all(socket_file, reply, (size_t) header.length) < 0)
+   {
+      return -1;
+   }
+
+   result = 0;
+   command = 0;
+
+   for
+   (
+      i = 0;
+      (i + sizeof(reply_header)) <= ((size_t) header.length);
+      i += reply_header.length
+   )
+   {
+      (void) memcpy
+      (
+         (void *) &reply_header,
+         (const void *) (reply + i),
+         sizeof(reply_header)
+      );
+
+      i += sizeof(reply_header);
+
+      if (reply_header.length > (header.length - i))
+      {
+         RELABSD_S_FATAL("The server's reply is malformed.");
+
+         return -1;
+      }
+
+      (void) fwrite
+      (
+         (const void *) (reply + i),
+         sizeof(char),
+         (size_t) reply_header.length,
+         stdout
+      );
+
+      if (reply_header.status != RELABSD_PROTOCOL_OK)
+      {
+         RELABSD_ERROR
+         (
+            "Command '%s' failed: %s.",
+            (
+               (command < commands_count) ?
+               argv[commands[command]]
+               : "?"
+            ),
+            get_status_description
+            (
+               (enum relabsd_protocol_status) reply_header.status
+            )
+         );
+
+         result = -1;
+      }
+      else if
+      (
+         (command < commands_count)
+         && is_read_ring_command(argv[commands[command]])
+      )
+      {
+         /* The reply is always shorter than the buffer it was read into. */
+         (void) memcpy
+         (
+            (void *) ring_description,
+            (const void *) (reply + i),
+            (size_t) reply_header.length
+         );
+
+         ring_description[reply_header.length] = '\0';
+      }
+
+      ++command;
+   }
+
+   if (command < commands_count)
+   {
+      RELABSD_ERROR
+      (
+         "The server did not handle the commands starting from '%s'.",
+         argv[commands[command]]
+      );
+
+      result = -1;
+   }
+
+   RELABSD_S_DEBUG(RELABSD_DEBUG_PROGRAM_FLOW, "Received server's reply.");
+
+   return result;
+}
+
+static void print_axes_state
+(
+   const struct relabsd_protocol_axes_state state [const restrict static 1]
 )
 {
-   /* TODO: implement. */
-   (void) fclose(socket);
+   int i;
+
+   printf
+   (
+      "frame %llu skipped %lu",
+      (unsigned long long int) state->frame,
+      (unsigned long int) state->skipped_frames
+   );
+
+   for (i = 0; i < RELABSD_AXIS_VALID_AXES_COUNT; ++i)
+   {
+      printf
+      (
+         " %s %ld %ld",
+         relabsd_axis_name_to_string((enum relabsd_axis_name) i),
+         (long int) state->inputs[i],
+         (long int) state->values[i]
+      );
+   }
+
+   printf("\n");
+
+   /* Whatever reads this wants it as soon as possible. */
+   (void) fflush(stdout);
+}
+
+/*
+ * Prints the axes states sent by the server, one per line, until the
+ * connection is closed.
+ */
+static int watch_axes (const int socket_file)
+{
+   char reply[RELABSD_SERVER_CLIENT_OUTPUT_SIZE];
+   struct relabsd_protocol_frame_header header;
+   struct relabsd_protocol_reply_header reply_header;
+   struct relabsd_protocol_axes_state state;
+
+   for (;;)
+   {
+      if (read_all(socket_file, (char *) &header, sizeof(header)) < 0)
+      {
+         return -1;
+      }
+
+      if (header.length > sizeof(reply))
+      {
+         RELABSD_S_FATAL("The server's reply is too large.");
+
+         return -1;
+      }
+
+      if (read_all(socket_file, reply, (size_t) header.length) < 0)
+      {
+         return -1;
+      }
+
+      if (header.length != (sizeof(reply_header) + sizeof(state)))
+      {
+         continue;
+      }
+
+      (void) memcpy
+      (
+         (void *) &reply_header,
+         (const void *) reply,
+         sizeof(reply_header)
+      );
+
+      if (reply_header.status != RELABSD_PROTOCOL_AXES_STATE)
+      {
+         continue;
+      }
+
+      (void) memcpy
+      (
+         (void *) &state,
+         (const void *) (reply + sizeof(reply_header)),
+         sizeof(state)
+      );
+
+      print_axes_state(&state);
+   }
+}
+
+static int map_output_ring
+(
+   const char name [const restrict static 1],
+   const struct relabsd_output_rings * rings [const restrict static 1],
+   size_t size [const restrict static 1]
+)
+{
+   struct stat file_stat;
+   void * region;
+   int file;
+
+   errno = 0;
+
+   /* Writable, to tell the server when this waits. */
+   file = shm_open(name, (O_RDWR | O_CLOEXEC), 0);
+
+   if (file == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to open the shared memory object \"%s\": %s.",
+         name,
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   errno = 0;
+
+   if (fstat(file, &file_stat) == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to get the size of the shared memory object \"%s\": %s.",
+         name,
+         strerror(errno)
+      );
+
+      (void) close(file);
+
+      return -1;
+   }
+
+   *size = (size_t) file_stat.st_size;
+
+   errno = 0;
+
+   region =
+      mmap(NULL, *size, (PROT_READ | PROT_WRITE), MAP_SHARED, file, 0);
+
+   (void) close(file);
+
+   if (region == MAP_FAILED)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to map the shared memory object \"%s\": %s.",
+         name,
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   *rings = (const struct relabsd_output_rings *) region;
+
+   if
+   (
+      (*size < sizeof(struct relabsd_output_rings))
+      ||
+      (
+         memcmp
+         (
+            (const void *) (*rings)->magic,
+            (const void *) RELABSD_OUTPUT_RING_MAGIC,
+            RELABSD_OUTPUT_RING_MAGIC_SIZE
+         )
+         != 0
+      )
+      || ((*rings)->events_count != RELABSD_OUTPUT_RING_EVENTS_COUNT)
+      || ((*rings)->readers_count != RELABSD_OUTPUT_RING_READERS_COUNT)
+   )
+   {
+      RELABSD_FATAL("\"%s\" does not hold relabsd output rings.", name);
+
+      (void) munmap(region, *size);
+
+      return -1;
+   }
+
+   return 0;
+}
+
+/*
+ * Waits for the ring to have events after 'index', or for the server to close
+ * the connection.
+ *
+ * Returns 0 when there might be new events,
+ *         -1 if the server closed the connection.
+ */
+static int wait_for_events
+(
+   const int socket_file,
+   const int ring_file,
+   const uint64_t index,
+   struct relabsd_output_ring ring [const static 1],
+   const int slot
+)
+{
+   struct pollfd files[2];
+   char data;
+   uint64_t counter;
+
+   atomic_store(&(ring->readers[slot].is_waiting), 1);
+
+   if (atomic_load(&(ring->write_index)) == index)
+   {
+      files[0].fd = ring_file;
+      files[0].events = POLLIN;
+      files[1].fd = socket_file;
+      files[1].events = POLLIN;
+
+      (void) poll(files, 2, -1);
+
+      if (files[0].revents & POLLIN)
+      {
+         (void) read(ring_file, (void *) &counter, sizeof(uint64_t));
+      }
+
+      if
+      (
+         (files[1].revents & (POLLIN | POLLHUP))
+         && (recv(socket_file, (void *) &data, 1, MSG_DONTWAIT) == 0)
+      )
+      {
+         return -1;
+      }
+   }
+
+   atomic_store(&(ring->readers[slot].is_waiting), 0);
+
+   return 0;
+}
+
+/*
+ * Prints the events the server publishes to the ring, one per line, until the
+ * connection is closed. 'description' is the reply to "--read-ring".
+ */
+static int read_ring
+(
+   const int socket_file,
+   const char description [const restrict static 1]
+)
+{
+   char name[RELABSD_SERVER_CLIENT_OUTPUT_SIZE];
+   const struct relabsd_output_rings * rings;
+   struct relabsd_output_ring * ring;
+   struct relabsd_output_ring_event * event;
+   size_t size;
+   uint64_t index, lost_events;
+   unsigned int type, code;
+   int device, slot, value;
+
+   if
+   (
+      (sscanf(description, "%4095s %d %d", name, &device, &slot) != 3)
+      || (RELABSD_CLIENT_RECEIVED_FILE == -1)
+   )
+   {
+      RELABSD_S_FATAL("The server did not give access to its output ring.");
+
+      return -1;
+   }
+
+   if (map_output_ring(name, &rings, &size) < 0)
+   {
+      return -1;
+   }
+
+   if
+   (
+      (device < 0)
+      || (((uint32_t) device) >= rings->devices_count)
+      || (size < (sizeof(*rings) + (((size_t) device + 1) * sizeof(*ring))))
+      || (slot < 0)
+      || (slot >= RELABSD_OUTPUT_RING_READERS_COUNT)
+   )
+   {
+      RELABSD_S_FATAL("The server's output ring description is invalid.");
+
+      (void) munmap((void *) rings, size);
+
+      return -1;
+   }
+
+   ring = (struct relabsd_output_ring *) (rings->rings + device);
+
+   /* Only the events that follow are of interest. */
+   index = atomic_load(&(ring->write_index));
+
+   for (;;)
+   {
+      if (atomic_load(&(ring->write_index)) == index)
+      {
+         (void) fflush(stdout);
+
+         if
+         (
+            wait_for_events
+            (
+               socket_file,
+               RELABSD_CLIENT_RECEIVED_FILE,
+               index,
+               ring,
+               slot
+            )
+            < 0
+         )
+         {
+            break;
+         }
+
+         continue;
+      }
+
+      lost_events = 0;
+
+      if
+      (
+         (atomic_load(&(ring->write_index)) - index)
+         > RELABSD_OUTPUT_RING_EVENTS_COUNT
+      )
+      {
+         lost_events =
+            (
+               atomic_load(&(ring->write_index))
+               - index
+               - RELABSD_OUTPUT_RING_EVENTS_COUNT
+            );
+
+         index += lost_events;
+      }
+
+      event =
+         (ring->events + (index & (RELABSD_OUTPUT_RING_EVENTS_COUNT - 1)));
+
+      type =
+         (unsigned int) atomic_load_explicit
+         (
+            &(event->type),
+            memory_order_relaxed
+         );
+
+      code =
+         (unsigned int) atomic_load_explicit
+         (
+            &(event->code),
+            memory_order_relaxed
+         );
+
+      value =
+         (int) atomic_load_explicit(&(event->value), memory_order_relaxed);
+
+      atomic_thread_fence(memory_order_acquire);
+
+      if
+      (
+         (
+            atomic_load_explicit(&(ring->write_index), memory_order_relaxed)
+            - index
+         )
+         >= RELABSD_OUTPUT_RING_EVENTS_COUNT
+      )
+      {
+         /* Overwritten while being read, it is lost too. */
+         lost_events += 1;
+         index += 1;
+      }
+      else
+      {
+         index += 1;
+
+         if (lost_events > 0)
+         {
+            printf("lost %llu\n", (unsigned long long int) lost_events);
+         }
+
+         printf
+         (
+            "%s %s %d\n",
+            libevdev_event_type_get_name(type),
+            libevdev_event_code_get_name(type, code),
+            value
+         );
+
+         continue;
+      }
+
+      printf("lost %llu\n", (unsigned long long int) lost_events);
+   }
+
+   (void) munmap((void *) rings, size);
 
    return 0;
 }
@@ -174,7 +935,11 @@ int relabsd_client_main
    struct relabsd_parameters parameters [const restrict static 1]
 )
 {
-   FILE * socket;
+   char ring_description[RELABSD_SERVER_CLIENT_OUTPUT_SIZE];
+   int commands[argc];
+   int socket_file;
+   int commands_count;
+   int i, result;
 
    RELABSD_S_DEBUG(RELABSD_DEBUG_PROGRAM_FLOW, "Started client mode.");
 
@@ -183,7 +948,7 @@ int relabsd_client_main
       open_socket
       (
          relabsd_parameters_get_communication_node_name(parameters),
-         &socket
+         &socket_file
       )
       < 0
    )
@@ -191,16 +956,63 @@ int relabsd_client_main
       return -1;
    }
 
-   if (send_commands(argc, argv, socket) < 0)
+   if
+   (
+      send_commands(argc, argv, socket_file, commands, &commands_count) < 0
+   )
    {
+      (void) close(socket_file);
+
       return -2;
    }
 
-   if (receive_reply(socket) < 0)
+   result =
+      receive_reply
+      (
+         argv,
+         socket_file,
+         commands,
+         commands_count,
+         ring_description
+      );
+
+   if (result < 0)
    {
+      (void) close(socket_file);
+
       return -3;
    }
 
+   for (i = 0; i < commands_count; ++i)
+   {
+      if (is_read_ring_command(argv[commands[i]]))
+      {
+         result = read_ring(socket_file, ring_description);
+
+         break;
+      }
+      else if (is_watch_command(argv[commands[i]]))
+      {
+         result = watch_axes(socket_file);
+
+         break;
+      }
+   }
+
+   if (RELABSD_CLIENT_RECEIVED_FILE != -1)
+   {
+      (void) close(RELABSD_CLIENT_RECEIVED_FILE);
+
+      RELABSD_CLIENT_RECEIVED_FILE = -1;
+   }
+
+   (void) close(socket_file);
+
+   if (result < 0)
+   {
+      return -4;
+   }
+
    RELABSD_S_DEBUG(RELABSD_DEBUG_PROGRAM_FLOW, "Completed client mode.");
 
    return 0;
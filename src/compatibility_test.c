@@ -65,15 +65,7 @@ int relabsd_compatibility_test_main
       return -1;
    }
 
-   if
-   (
-      relabsd_physical_device_open
-      (
-         relabsd_parameters_get_physical_device_file_name(parameters),
-         &device
-      )
-      < 0
-   )
+   if (relabsd_physical_device_open(parameters, &device) < 0)
    {
       return -1;
    }
@@ -1,13 +1,6 @@
 /**** POSIX *******************************************************************/
-/*
- * To get the POSIX 'getline' function.
- * We don't know what POSIX version is set by default.
- */
-#define _POSIX_C_SOURCE 200809L
-
 #include <errno.h>
 #include <limits.h>
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -19,17 +12,6 @@
 
 #include <relabsd/config/parameters.h>
 
-/******************************************************************************/
-/**** TYPES *******************************************************************/
-/******************************************************************************/
-struct relabsd_parameters_client_input
-{
-   FILE * socket_as_file;
-   ssize_t size;
-   char * buffer;
-   size_t buffer_size;
-};
-
 /******************************************************************************/
 /**** LOCAL FUNCTIONS *********************************************************/
 /******************************************************************************/
@@ -38,56 +20,33 @@ static int get_next_argument
    struct relabsd_parameters_client_input input [const restrict static 1]
 )
 {
-   errno = 0;
-   input->size =
-      getline
+   char * end_of_line;
+
+   end_of_line =
+      (char *) memchr
       (
-         &(input->buffer),
-         &(input->buffer_size),
-         input->socket_as_file
+         (const void *) input->commands,
+         '\n',
+         input->commands_length
       );
 
-   if (input->size < 1)
+   if (end_of_line == (char *) NULL)
    {
-      RELABSD_ERROR
-      (
-         "Unable to read line from client socket: %s.",
-         strerror(errno)
-      );
+      RELABSD_S_ERROR("Client commands ended unexpectedly.");
 
       return -1;
    }
 
-   /*
-    * size is "not including the terminating null byte", so it's the '\n'
-    * character.
-    */
-   input->buffer[(input->size - 1)] = '\0';
-
-   return 0;
-}
+   *end_of_line = '\0';
 
-static void initialize_client_input
-(
-   FILE socket_as_file [const static 1],
-   struct relabsd_parameters_client_input input [const restrict static 1]
-)
-{
-   input->socket_as_file = socket_as_file;
-   input->size = 0;
-   input->buffer = (char *) NULL;
-   input->buffer_size = 0;
-}
+   input->buffer = input->commands;
+   /* Includes the '\0'. */
+   input->size = (ssize_t) ((end_of_line - input->commands) + 1);
 
-static void finalize_client_input
-(
-   struct relabsd_parameters_client_input input [const restrict static 1]
-)
-{
-   free((void *) input->buffer);
+   input->commands += input->size;
+   input->commands_length -= (size_t) input->size;
 
-   input->buffer = (char *) NULL;
-   input->buffer_size = 0;
+   return 0;
 }
 
 static int handle_timeout_change
@@ -117,6 +76,23 @@ static int handle_timeout_change
    return 0;
 }
 
+static int handle_late_policy_change
+(
+   struct relabsd_parameters_client_input input [const restrict static 1],
+   struct relabsd_parameters parameters [const restrict static 1]
+)
+{
+   if (get_next_argument(input) < 0)
+   {
+      RELABSD_S_ERROR("Could not get late policy value from client.");
+
+      return -1;
+   }
+
+   return
+      relabsd_parameters_set_late_policy_from_name(input->buffer, parameters);
+}
+
 static int handle_name_change
 (
    struct relabsd_parameters_client_input input [const restrict static 1],
@@ -132,8 +108,8 @@ static int handle_name_change
       return -1;
    }
 
-   device_name =
-      (const char *) calloc((size_t) (input->size - 1), sizeof(char));
+   /* 'input->size' includes the '\0'. */
+   device_name = (const char *) calloc((size_t) input->size, sizeof(char));
 
    if (device_name == (const char *) NULL)
    {
@@ -150,7 +126,7 @@ static int handle_name_change
    (
       (void *) device_name,
       (const void *) input->buffer,
-      (size_t) (input->size - 1)
+      (size_t) input->size
    );
 
    if (parameters->device_name_was_modified)
@@ -373,10 +349,12 @@ static int handle_option_toggle
    else if (RELABSD_STRING_EQUALS("not_abs", input->buffer))
    {
       parameters->axes[axis_name].flags[RELABSD_NOT_ABS] ^= 1;
+      parameters->axes_capabilities_were_modified = 1;
    }
    else if (RELABSD_STRING_EQUALS("enable", input->buffer))
    {
       parameters->axes[axis_name].is_enabled ^= 1;
+      parameters->axes_capabilities_were_modified = 1;
    }
    else if (RELABSD_IS_PREFIX("convert_to=", input->buffer))
    {
@@ -386,6 +364,8 @@ static int handle_option_toggle
          relabsd_axis_name_to_string(axis_name),
          (parameters->axes + axis_name)
       );
+
+      parameters->axes_capabilities_were_modified = 1;
    }
    else
    {
@@ -403,102 +383,323 @@ static int handle_option_toggle
    return 0;
 }
 
-static int handle_inputs
+static enum relabsd_parameters_command_result handle_device_selection
 (
    struct relabsd_parameters_client_input input [const restrict static 1],
-   struct relabsd_parameters parameters [const restrict static 1]
+   char * selected_device [const restrict static 1]
 )
 {
-   for (;;)
+   if (get_next_argument(input) < 0)
    {
-      if (get_next_argument(input) < 0)
-      {
-         RELABSD_S_ERROR("Could not get next client command.");
+      RELABSD_S_ERROR("Could not get the device selected by the client.");
 
-         return -1;
-      }
+      return RELABSD_PARAMETERS_INVALID_COMMAND;
+   }
 
-      if ((input->buffer[0] == '\n') || (input->buffer[0] == '\0'))
-      {
-         return 0;
-      }
-      else if
+   *selected_device = (char *) calloc((size_t) input->size, sizeof(char));
+
+   if (*selected_device == (char *) NULL)
+   {
+      RELABSD_S_ERROR
       (
-         RELABSD_STRING_EQUALS("-q", input->buffer)
-         || RELABSD_STRING_EQUALS("--quit", input->buffer)
-      )
+         "Could not allocate memory to store the device selected by the"
+         " client."
+      );
+
+      return RELABSD_PARAMETERS_INVALID_COMMAND;
+   }
+
+   (void) memcpy
+   (
+      (void *) *selected_device,
+      (const void *) input->buffer,
+      (size_t) input->size
+   );
+
+   return RELABSD_PARAMETERS_DEVICE_SELECTION;
+}
+
+/* 'input->buffer' holds the command, and its arguments are available. */
+static enum relabsd_parameters_command_result handle_command
+(
+   struct relabsd_parameters_client_input input [const restrict static 1],
+   struct relabsd_parameters parameters [const restrict static 1],
+   char * selected_device [const restrict static 1]
+)
+{
+   if
+   (
+      RELABSD_STRING_EQUALS("-q", input->buffer)
+      || RELABSD_STRING_EQUALS("--quit", input->buffer)
+   )
+   {
+      relabsd_server_interrupt();
+   }
+   else if
+   (
+      RELABSD_STRING_EQUALS("-D", input->buffer)
+      || RELABSD_STRING_EQUALS("--device", input->buffer)
+   )
+   {
+      return handle_device_selection(input, selected_device);
+   }
+   else if
+   (
+      RELABSD_STRING_EQUALS("-L", input->buffer)
+      || RELABSD_STRING_EQUALS("--latency", input->buffer)
+   )
+   {
+      return RELABSD_PARAMETERS_LATENCY_REQUEST;
+   }
+   else if
+   (
+      RELABSD_STRING_EQUALS("-S", input->buffer)
+      || RELABSD_STRING_EQUALS("--state", input->buffer)
+   )
+   {
+      return RELABSD_PARAMETERS_STATE_REQUEST;
+   }
+   else if
+   (
+      RELABSD_STRING_EQUALS("-W", input->buffer)
+      || RELABSD_STRING_EQUALS("--watch", input->buffer)
+   )
+   {
+      return RELABSD_PARAMETERS_WATCH_REQUEST;
+   }
+   else if
+   (
+      RELABSD_STRING_EQUALS("-R", input->buffer)
+      || RELABSD_STRING_EQUALS("--read-ring", input->buffer)
+   )
+   {
+      return RELABSD_PARAMETERS_OUTPUT_RING_REQUEST;
+   }
+   else if
+   (
+      RELABSD_STRING_EQUALS("-X", input->buffer)
+      || RELABSD_STRING_EQUALS("--dump-capture", input->buffer)
+   )
+   {
+      return RELABSD_PARAMETERS_CAPTURE_DUMP_REQUEST;
+   }
+   else if
+   (
+      RELABSD_STRING_EQUALS("-T", input->buffer)
+      || RELABSD_STRING_EQUALS("--stats", input->buffer)
+   )
+   {
+      return RELABSD_PARAMETERS_STATISTICS_REQUEST;
+   }
+   else if
+   (
+      RELABSD_STRING_EQUALS("-Z", input->buffer)
+      || RELABSD_STRING_EQUALS("--reset-stats", input->buffer)
+   )
+   {
+      return RELABSD_PARAMETERS_STATISTICS_RESET_REQUEST;
+   }
+   else if
+   (
+      RELABSD_STRING_EQUALS("-t", input->buffer)
+      || RELABSD_STRING_EQUALS("--timeout", input->buffer)
+   )
+   {
+      if (handle_timeout_change(input, parameters) < 0)
       {
-         relabsd_server_interrupt();
+         return RELABSD_PARAMETERS_INVALID_COMMAND;
       }
-      else if
-      (
-         RELABSD_STRING_EQUALS("-t", input->buffer)
-         || RELABSD_STRING_EQUALS("--timeout", input->buffer)
-      )
+   }
+   else if
+   (
+      RELABSD_STRING_EQUALS("-l", input->buffer)
+      || RELABSD_STRING_EQUALS("--late-policy", input->buffer)
+   )
+   {
+      if (handle_late_policy_change(input, parameters) < 0)
       {
-         if (handle_timeout_change(input, parameters) < 0)
-         {
-            return -1;
-         }
+         return RELABSD_PARAMETERS_INVALID_COMMAND;
       }
-      else if
-      (
-         RELABSD_STRING_EQUALS("-n", input->buffer)
-         || RELABSD_STRING_EQUALS("--name", input->buffer)
-      )
+   }
+   else if
+   (
+      RELABSD_STRING_EQUALS("-n", input->buffer)
+      || RELABSD_STRING_EQUALS("--name", input->buffer)
+   )
+   {
+      if (handle_name_change(input, parameters) < 0)
       {
-         if (handle_name_change(input, parameters) < 0)
-         {
-            return -1;
-         }
+         return RELABSD_PARAMETERS_INVALID_COMMAND;
       }
-      else if
-      (
-         RELABSD_STRING_EQUALS("-m", input->buffer)
-         || RELABSD_STRING_EQUALS("--mod-axis", input->buffer)
-      )
+   }
+   else if
+   (
+      RELABSD_STRING_EQUALS("-m", input->buffer)
+      || RELABSD_STRING_EQUALS("--mod-axis", input->buffer)
+   )
+   {
+      if (handle_axis_mod(input, parameters) < 0)
       {
-         if (handle_axis_mod(input, parameters) < 0)
-         {
-            return -1;
-         }
+         return RELABSD_PARAMETERS_INVALID_COMMAND;
       }
-      else if
-      (
-         RELABSD_STRING_EQUALS("-o", input->buffer)
-         || RELABSD_STRING_EQUALS("--toggle-option", input->buffer)
-      )
+   }
+   else if
+   (
+      RELABSD_STRING_EQUALS("-o", input->buffer)
+      || RELABSD_STRING_EQUALS("--toggle-option", input->buffer)
+   )
+   {
+      if (handle_option_toggle(input, parameters) < 0)
       {
-         if (handle_option_toggle(input, parameters) < 0)
-         {
-            return -1;
-         }
+         return RELABSD_PARAMETERS_INVALID_COMMAND;
       }
-      else
-      {
-         RELABSD_ERROR("Unknown client command \"%s\"", input->buffer);
+   }
+   else
+   {
+      RELABSD_ERROR("Unknown client command \"%s\".", input->buffer);
 
-         return -1;
-      }
+      return RELABSD_PARAMETERS_UNKNOWN_COMMAND;
    }
+
+   return RELABSD_PARAMETERS_COMMAND_APPLIED;
 }
 
 /******************************************************************************/
 /**** EXPORTED FUNCTIONS ******************************************************/
 /******************************************************************************/
-int relabsd_parameters_handle_remote_client
+void relabsd_parameters_initialize_client_input
+(
+   char commands [const static 1],
+   const size_t commands_length,
+   struct relabsd_parameters_client_input input [const restrict static 1]
+)
+{
+   input->commands = commands;
+   input->commands_length = commands_length;
+   input->buffer = (char *) NULL;
+   input->size = 0;
+}
+
+int relabsd_parameters_has_remote_commands
+(
+   const struct relabsd_parameters_client_input input [const restrict static 1]
+)
+{
+   return (input->commands_length > 0);
+}
+
+enum relabsd_parameters_command_result relabsd_parameters_handle_remote_command
 (
-   FILE socket_as_file [const static 1],
+   struct relabsd_parameters_client_input input [const restrict static 1],
+   struct relabsd_parameters parameters [const restrict static 1],
+   char * selected_device [const restrict static 1]
+)
+{
+   char * end_of_command;
+   const char * end_of_line;
+   enum relabsd_parameters_command_result result;
+   size_t remaining_length;
+   int arguments_count;
+
+   if (get_next_argument(input) < 0)
+   {
+      return RELABSD_PARAMETERS_UNKNOWN_COMMAND;
+   }
+
+   if
+   (
+      relabsd_parameters_argument_count_for(input->buffer, &arguments_count)
+      < 0
+   )
+   {
+      RELABSD_ERROR("Unknown client command \"%s\".", input->buffer);
+
+      return RELABSD_PARAMETERS_UNKNOWN_COMMAND;
+   }
+
+   /* Where the next command starts, whether or not this one succeeds. */
+   end_of_command = input->commands;
+   remaining_length = input->commands_length;
+
+   for (; arguments_count > 0; --arguments_count)
+   {
+      end_of_line =
+         (const char *) memchr
+         (
+            (const void *) end_of_command,
+            '\n',
+            remaining_length
+         );
+
+      if (end_of_line == (const char *) NULL)
+      {
+         RELABSD_ERROR
+         (
+            "Missing arguments for client command \"%s\".",
+            input->buffer
+         );
+
+         input->commands_length = 0;
+
+         return RELABSD_PARAMETERS_INVALID_COMMAND;
+      }
+
+      remaining_length -= (size_t) ((end_of_line - end_of_command) + 1);
+      end_of_command += ((end_of_line - end_of_command) + 1);
+   }
+
+   result = handle_command(input, parameters, selected_device);
+
+   input->commands = end_of_command;
+   input->commands_length = remaining_length;
+
+   return result;
+}
+
+void relabsd_parameters_start_batch
+(
+   const struct relabsd_parameters parameters [const restrict static 1],
+   struct relabsd_parameters batch [const restrict static 1]
+)
+{
+   *batch = *parameters;
+
+   /* Its name belongs to 'parameters', so a new one must not free it. */
+   batch->device_name_was_modified = 0;
+}
+
+void relabsd_parameters_commit_batch
+(
+   const struct relabsd_parameters batch [const restrict static 1],
    struct relabsd_parameters parameters [const restrict static 1]
 )
 {
-   struct relabsd_parameters_client_input input;
+   const char * device_name;
+   int device_name_was_modified;
+
+   if (batch->device_name_was_modified)
+   {
+      relabsd_parameters_clean_device_name(parameters);
 
-   initialize_client_input(socket_as_file, &input);
+      *parameters = *batch;
 
-   (void) handle_inputs(&input, parameters);
+      return;
+   }
 
-   finalize_client_input(&input);
+   device_name = parameters->device_name;
+   device_name_was_modified = parameters->device_name_was_modified;
 
-   return 0;
+   *parameters = *batch;
+
+   parameters->device_name = device_name;
+   parameters->device_name_was_modified = device_name_was_modified;
+}
+
+void relabsd_parameters_discard_batch
+(
+   struct relabsd_parameters batch [const restrict static 1]
+)
+{
+   /* Only frees the name if one of the batch's commands gave it. */
+   relabsd_parameters_clean_device_name(batch);
 }
@@ -1,11 +1,13 @@
 /**** POSIX *******************************************************************/
 #include <limits.h>
+#include <sched.h>
 
 /**** RELABSD *****************************************************************/
 #include <relabsd/config.h>
 #include <relabsd/debug.h>
 
 #include <relabsd/device/axis.h>
+#include <relabsd/device/output_backend.h>
 
 #include <relabsd/util/string.h>
 
@@ -84,6 +86,62 @@ static int parse_axis
    return 0;
 }
 
+/* 'policy_name' is one of "fifo" or "rr". */
+static int parse_priority
+(
+   const char policy_name [const restrict static 1],
+   const char priority [const restrict static 1],
+   struct relabsd_parameters parameters [const restrict static 1]
+)
+{
+   int policy, min, max;
+
+   if (RELABSD_STRING_EQUALS("fifo", policy_name))
+   {
+      policy = SCHED_FIFO;
+   }
+   else if (RELABSD_STRING_EQUALS("rr", policy_name))
+   {
+      policy = SCHED_RR;
+   }
+   else
+   {
+      RELABSD_FATAL("Unknown scheduling policy \"%s\".", policy_name);
+
+      return -1;
+   }
+
+   min = sched_get_priority_min(policy);
+   max = sched_get_priority_max(policy);
+
+   if
+   (
+      relabsd_util_parse_int
+      (
+         priority,
+         min,
+         max,
+         &(parameters->conversion_priority)
+      )
+      < 0
+   )
+   {
+      RELABSD_FATAL
+      (
+         "Invalid priority for the \"%s\" policy (valid range is [%d, %d]).",
+         policy_name,
+         min,
+         max
+      );
+
+      return -1;
+   }
+
+   parameters->conversion_policy = policy;
+
+   return 0;
+}
+
 /******************************************************************************/
 /**** EXPORTED FUNCTIONS ******************************************************/
 /******************************************************************************/
@@ -292,6 +350,33 @@ int relabsd_parameters_parse_options
          relabsd_parameters_set_timeout(timeout, parameters);
       }
       else if
+      (
+         RELABSD_STRING_EQUALS("-l", argv[i])
+         || RELABSD_STRING_EQUALS("--late-policy", argv[i])
+      )
+      {
+         if ((i + 1) >= argc)
+         {
+            RELABSD_FATAL("Missing value for \"%s\" <OPTION>.", argv[i]);
+            relabsd_parameters_print_usage(argv[0]);
+
+            return -1;
+         }
+
+         ++i;
+
+         if
+         (
+            relabsd_parameters_set_late_policy_from_name(argv[i], parameters)
+            < 0
+         )
+         {
+            relabsd_parameters_print_usage(argv[0]);
+
+            return -1;
+         }
+      }
+      else if
       (
          RELABSD_STRING_EQUALS("-a", argv[i])
          || RELABSD_STRING_EQUALS("--axis", argv[i])
@@ -336,6 +421,272 @@ int relabsd_parameters_parse_options
          }
       }
       else if
+      (
+         RELABSD_STRING_EQUALS("-D", argv[i])
+         || RELABSD_STRING_EQUALS("--device", argv[i])
+      )
+      {
+         if ((i + 2) >= argc)
+         {
+            RELABSD_FATAL("Missing values for \"%s\" <OPTION>.", argv[i]);
+            relabsd_parameters_print_usage(argv[0]);
+
+            return -1;
+         }
+
+         if
+         (
+            parameters->additional_devices_count
+            == (RELABSD_SERVER_MAX_DEVICES - 1)
+         )
+         {
+            RELABSD_FATAL
+            (
+               "A server cannot handle more than %d devices.",
+               RELABSD_SERVER_MAX_DEVICES
+            );
+
+            return -1;
+         }
+
+         parameters->additional_physical_device_file_names
+         [
+            parameters->additional_devices_count
+         ] = argv[i + 1];
+
+         parameters->additional_configuration_files
+         [
+            parameters->additional_devices_count
+         ] = argv[i + 2];
+
+         parameters->additional_devices_count += 1;
+
+         i += 2;
+      }
+      else if
+      (
+         RELABSD_STRING_EQUALS("-w", argv[i])
+         || RELABSD_STRING_EQUALS("--workers", argv[i])
+      )
+      {
+         if ((i + 1) >= argc)
+         {
+            RELABSD_FATAL("Missing value for \"%s\" <OPTION>.", argv[i]);
+            relabsd_parameters_print_usage(argv[0]);
+
+            return -1;
+         }
+
+         ++i;
+
+         if
+         (
+            relabsd_util_parse_int
+            (
+               argv[i],
+               1,
+               RELABSD_SERVER_MAX_WORKERS,
+               &(parameters->workers_count)
+            )
+            < 0
+         )
+         {
+            RELABSD_FATAL
+            (
+               "Invalid value for \"%s\" <OPTION> (valid range is [%d, %d]).",
+               argv[i - 1],
+               1,
+               RELABSD_SERVER_MAX_WORKERS
+            );
+
+            relabsd_parameters_print_usage(argv[0]);
+
+            return -1;
+         }
+      }
+      else if
+      (
+         RELABSD_STRING_EQUALS("-e", argv[i])
+         || RELABSD_STRING_EQUALS("--export", argv[i])
+      )
+      {
+         if ((i + 1) >= argc)
+         {
+            RELABSD_FATAL("Missing value for \"%s\" <OPTION>.", argv[i]);
+            relabsd_parameters_print_usage(argv[0]);
+
+            return -1;
+         }
+
+         ++i;
+
+         parameters->shared_memory_name = argv[i];
+      }
+      else if
+      (
+         RELABSD_STRING_EQUALS("-r", argv[i])
+         || RELABSD_STRING_EQUALS("--ring", argv[i])
+      )
+      {
+         if ((i + 1) >= argc)
+         {
+            RELABSD_FATAL("Missing value for \"%s\" <OPTION>.", argv[i]);
+            relabsd_parameters_print_usage(argv[0]);
+
+            return -1;
+         }
+
+         ++i;
+
+         parameters->output_ring_name = argv[i];
+      }
+      else if
+      (
+         RELABSD_STRING_EQUALS("-O", argv[i])
+         || RELABSD_STRING_EQUALS("--output", argv[i])
+      )
+      {
+         const char * argument;
+
+         if ((i + 1) >= argc)
+         {
+            RELABSD_FATAL("Missing value for \"%s\" <OPTION>.", argv[i]);
+            relabsd_parameters_print_usage(argv[0]);
+
+            return -1;
+         }
+
+         ++i;
+
+         if
+         (
+            relabsd_output_backend_find(argv[i], &argument)
+            == (const struct relabsd_output_backend *) NULL
+         )
+         {
+            RELABSD_FATAL
+            (
+               "Invalid value for \"%s\" <OPTION>: unknown output \"%s\".",
+               argv[i - 1],
+               argv[i]
+            );
+
+            relabsd_parameters_print_usage(argv[0]);
+
+            return -1;
+         }
+
+         parameters->output_name = argv[i];
+      }
+      else if
+      (
+         RELABSD_STRING_EQUALS("-C", argv[i])
+         || RELABSD_STRING_EQUALS("--capture", argv[i])
+      )
+      {
+         if ((i + 1) >= argc)
+         {
+            RELABSD_FATAL("Missing value for \"%s\" <OPTION>.", argv[i]);
+            relabsd_parameters_print_usage(argv[0]);
+
+            return -1;
+         }
+
+         ++i;
+
+         parameters->capture_file_prefix = argv[i];
+      }
+      else if
+      (
+         RELABSD_STRING_EQUALS("-b", argv[i])
+         || RELABSD_STRING_EQUALS("--stall-budget", argv[i])
+      )
+      {
+         if ((i + 1) >= argc)
+         {
+            RELABSD_FATAL("Missing value for \"%s\" <OPTION>.", argv[i]);
+            relabsd_parameters_print_usage(argv[0]);
+
+            return -1;
+         }
+
+         ++i;
+
+         if
+         (
+            relabsd_util_parse_int
+            (
+               argv[i],
+               0,
+               RELABSD_SERVER_MAX_STALL_BUDGET,
+               &(parameters->stall_budget)
+            )
+            < 0
+         )
+         {
+            RELABSD_FATAL
+            (
+               "Invalid value for \"%s\" <OPTION> (valid range is [%d, %d]).",
+               argv[i - 1],
+               0,
+               RELABSD_SERVER_MAX_STALL_BUDGET
+            );
+
+            relabsd_parameters_print_usage(argv[0]);
+
+            return -1;
+         }
+      }
+      else if
+      (
+         RELABSD_STRING_EQUALS("-p", argv[i])
+         || RELABSD_STRING_EQUALS("--priority", argv[i])
+      )
+      {
+         if ((i + 2) >= argc)
+         {
+            RELABSD_FATAL("Missing values for \"%s\" <OPTION>.", argv[i]);
+            relabsd_parameters_print_usage(argv[0]);
+
+            return -1;
+         }
+
+         if (parse_priority(argv[i + 1], argv[i + 2], parameters) < 0)
+         {
+            relabsd_parameters_print_usage(argv[0]);
+
+            return -1;
+         }
+
+         i += 2;
+      }
+      else if
+      (
+         RELABSD_STRING_EQUALS("-A", argv[i])
+         || RELABSD_STRING_EQUALS("--cpus", argv[i])
+      )
+      {
+         if ((i + 1) >= argc)
+         {
+            RELABSD_FATAL("Missing value for \"%s\" <OPTION>.", argv[i]);
+            relabsd_parameters_print_usage(argv[0]);
+
+            return -1;
+         }
+
+         ++i;
+
+         parameters->conversion_cpus = argv[i];
+      }
+      else if
+      (
+         RELABSD_STRING_EQUALS("-M", argv[i])
+         || RELABSD_STRING_EQUALS("--lock-memory", argv[i])
+      )
+      {
+         parameters->lock_memory = 1;
+      }
+      else if
       (
          RELABSD_STRING_EQUALS("-m", argv[i])
          || RELABSD_STRING_EQUALS("--mod-axis", argv[i])
@@ -343,6 +694,20 @@ int relabsd_parameters_parse_options
          || RELABSD_STRING_EQUALS("--toggle-option", argv[i])
          ||RELABSD_STRING_EQUALS("-q", argv[i])
          || RELABSD_STRING_EQUALS("--quit", argv[i])
+         || RELABSD_STRING_EQUALS("-L", argv[i])
+         || RELABSD_STRING_EQUALS("--latency", argv[i])
+         || RELABSD_STRING_EQUALS("-S", argv[i])
+         || RELABSD_STRING_EQUALS("--state", argv[i])
+         || RELABSD_STRING_EQUALS("-W", argv[i])
+         || RELABSD_STRING_EQUALS("--watch", argv[i])
+         || RELABSD_STRING_EQUALS("-R", argv[i])
+         || RELABSD_STRING_EQUALS("--read-ring", argv[i])
+         || RELABSD_STRING_EQUALS("-X", argv[i])
+         || RELABSD_STRING_EQUALS("--dump-capture", argv[i])
+         || RELABSD_STRING_EQUALS("-T", argv[i])
+         || RELABSD_STRING_EQUALS("--stats", argv[i])
+         || RELABSD_STRING_EQUALS("-Z", argv[i])
+         || RELABSD_STRING_EQUALS("--reset-stats", argv[i])
       )
       {
          RELABSD_FATAL("\"%s\" is not available in this mode.", argv[i]);
@@ -374,6 +739,20 @@ int relabsd_parameters_argument_count_for
    (
       RELABSD_STRING_EQUALS("-q", option)
       || RELABSD_STRING_EQUALS("--quit", option)
+      || RELABSD_STRING_EQUALS("-L", option)
+      || RELABSD_STRING_EQUALS("--latency", option)
+      || RELABSD_STRING_EQUALS("-S", option)
+      || RELABSD_STRING_EQUALS("--state", option)
+      || RELABSD_STRING_EQUALS("-W", option)
+      || RELABSD_STRING_EQUALS("--watch", option)
+      || RELABSD_STRING_EQUALS("-R", option)
+      || RELABSD_STRING_EQUALS("--read-ring", option)
+      || RELABSD_STRING_EQUALS("-X", option)
+      || RELABSD_STRING_EQUALS("--dump-capture", option)
+      || RELABSD_STRING_EQUALS("-T", option)
+      || RELABSD_STRING_EQUALS("--stats", option)
+      || RELABSD_STRING_EQUALS("-Z", option)
+      || RELABSD_STRING_EQUALS("--reset-stats", option)
    )
    {
       *result = 0;
@@ -411,6 +790,14 @@ int relabsd_parameters_argument_count_for
       *result = 1;
    }
    else if
+   (
+      RELABSD_STRING_EQUALS("-l", option)
+      || RELABSD_STRING_EQUALS("--late-policy", option)
+   )
+   {
+      *result = 1;
+   }
+   else if
    (
       RELABSD_STRING_EQUALS("-m", option)
       || RELABSD_STRING_EQUALS("--mod-axis", option)
@@ -427,9 +814,35 @@ int relabsd_parameters_argument_count_for
       *result = 2;
    }
    else if
+   (
+      RELABSD_STRING_EQUALS("-D", option)
+      || RELABSD_STRING_EQUALS("--device", option)
+   )
+   {
+      *result = 1;
+   }
+   else if
    (
       RELABSD_STRING_EQUALS("-d", option)
       || RELABSD_STRING_EQUALS("--daemon", option)
+      || RELABSD_STRING_EQUALS("-w", option)
+      || RELABSD_STRING_EQUALS("--workers", option)
+      || RELABSD_STRING_EQUALS("-e", option)
+      || RELABSD_STRING_EQUALS("--export", option)
+      || RELABSD_STRING_EQUALS("-r", option)
+      || RELABSD_STRING_EQUALS("--ring", option)
+      || RELABSD_STRING_EQUALS("-O", option)
+      || RELABSD_STRING_EQUALS("--output", option)
+      || RELABSD_STRING_EQUALS("-C", option)
+      || RELABSD_STRING_EQUALS("--capture", option)
+      || RELABSD_STRING_EQUALS("-b", option)
+      || RELABSD_STRING_EQUALS("--stall-budget", option)
+      || RELABSD_STRING_EQUALS("-p", option)
+      || RELABSD_STRING_EQUALS("--priority", option)
+      || RELABSD_STRING_EQUALS("-A", option)
+      || RELABSD_STRING_EQUALS("--cpus", option)
+      || RELABSD_STRING_EQUALS("-M", option)
+      || RELABSD_STRING_EQUALS("--lock-memory", option)
       || RELABSD_STRING_EQUALS("-f", option)
       || RELABSD_STRING_EQUALS("--config", option)
       || RELABSD_STRING_EQUALS("-a", option)
@@ -471,6 +884,28 @@ void relabsd_parameters_print_usage (const char exec [const restrict static 1])
          " [(<SERVER_OPTION>|<CONF_OPTION>)+]\n"
             "\t\tCreates an unnamed server instance.\n\n"
 
+      "<physical_device_file>:\n"
+      "\t<evdev_device_file> | trace=<trace_file> | fast-trace=<trace_file> |"
+      "\n\tstdin[=<capabilities>] | pipe=<named_pipe>[,<capabilities>]\n"
+         "\t\tTraces (from relabsd-replay) are replayed at their own pace, or"
+         " as fast as\n\t\tpossible, as the device they were recorded from."
+         " Pipes and stdin give raw\n\t\tinput_event structures, from a"
+         " device with the given <capabilities> (e.g.\n\t\t"
+         "\"REL_X,REL_Y,BTN_LEFT,ABS_X:<min>:<max>\"), or else with the"
+         " converted\n\t\trelative axes and mouse buttons. Inputs that reach"
+         " their end stop being\n\t\tconverted, and the server stops once"
+         " all of them did.\n\n",
+      exec,
+      exec,
+      exec,
+      exec,
+      exec,
+      exec
+   );
+
+   /* Split, as C compilers need only support strings of up to 4095 bytes. */
+   printf
+   (
       "<GLOBAL_CONF_OPTION>:\n"
       "\t[-n | --name] <relabsd_device_name>\n"
          "\t\tNames the virtual device.\n\n"
@@ -478,6 +913,9 @@ void relabsd_parameters_print_usage (const char exec [const restrict static 1])
       "\t[-t | --timeout] <timeout_in_ms>\n"
          "\t\tSets a zeroing timeout (0 to disable).\n\n"
 
+      "\t[-l | --late-policy] [replay|drop|collapse]\n"
+         "\t\tWhat to do with outdated inputs when falling behind.\n\n"
+
       "\t[-v | --verbose]\n"
          "\t\tPrint incoming and outgoing events to stdout.\n\n"
 
@@ -498,22 +936,115 @@ void relabsd_parameters_print_usage (const char exec [const restrict static 1])
       "\t[-d | --daemon]\n"
          "\t\tRuns server instance in the background.\n\n"
 
+      "\t[-D | --device] <physical_device_file> <config_file>\n"
+         "\t\tAlso converts <physical_device_file>, using <config_file>.\n\n"
+
+      "\t[-w | --workers] <count>\n"
+         "\t\tNumber of threads converting the devices' inputs.\n\n"
+
+      "\t[-e | --export] <shared_memory_name>\n"
+         "\t\tKeeps the current state of the axes in that POSIX shared memory"
+         " object\n\t\t(e.g. \"/relabsd\").\n\n"
+
+      "\t[-r | --ring] <shared_memory_name>\n"
+         "\t\tAlso publishes the converted events to rings in that POSIX shared"
+         " memory\n\t\tobject, which their readers must be able to write"
+         " to.\n\n"
+
+      "\t[-O | --output] [uinput|file=<path>|null]\n"
+         "\t\tWhere the converted events go: a uinput device (default), the"
+         " end of a\n\t\tfile or pipe (as raw input_event structures, all"
+         " devices sharing it),\n\t\tor nowhere (they are only counted, to"
+         " measure the conversion).\n\n"
+
+      "\t[-C | --capture] <file_prefix>\n"
+         "\t\tKeeps the last events each device received and sent, for"
+         " \"--dump-capture\"\n\t\tto save them to <file_prefix><device"
+         " index>.input and .output.\n\n"
+
+      "\t[-b | --stall-budget] <budget_in_us>\n"
+         "\t\tReports the times a device's inputs took longer than that to"
+         " handle, and\n\t\twhat took the most time (0 to disable).\n\n"
+
+      "\t[-p | --priority] [fifo|rr] <priority>\n"
+         "\t\tRuns the conversion threads with that real-time scheduling"
+         " policy.\n\n"
+
+      "\t[-A | --cpus] <cpu_list>\n"
+         "\t\tPins the conversion threads to these CPUs (e.g. \"0,2-3\").\n\n"
+
+      "\t[-M | --lock-memory]\n"
+         "\t\tLocks the server's memory once initialized, so that it is"
+         " never paged out.\n\n"
+
       "<CLIENT_OPTION>:\n"
       "\t[-q | --quit]\n"
          "\t\tTerminates the targeted server instance.\n\n"
 
+      "\t[-D | --device] <physical_device_file>\n"
+         "\t\tApplies the following options to that device of the server.\n\n"
+
+      "\t[-L | --latency]\n"
+         "\t\tPrints the latency (in microseconds) of the selected device.\n\n"
+
+      "\t[-S | --state]\n"
+         "\t\tPrints the parameters of the selected device.\n\n"
+
+      "\t[-W | --watch]\n"
+         "\t\tPrints the axes of the selected device after each of its frames,"
+         " until interrupted.\n\n"
+
+      "\t[-R | --read-ring]\n"
+         "\t\tPrints the events the selected device publishes to its output"
+         " ring, until\n\t\tinterrupted.\n\n"
+
+      "\t[-X | --dump-capture]\n"
+         "\t\tSaves the last events of the selected device as traces that"
+         " relabsd-replay\n\t\tcan use (see the server's \"--capture\""
+         " option).\n\n"
+
+      "\t[-T | --stats]\n"
+         "\t\tPrints the counters of the selected device and of its axes,"
+         " since it was\n\t\tcreated or since they were last reset.\n\n"
+
+      "\t[-Z | --reset-stats]\n"
+         "\t\tResets the counters of the selected device.\n\n"
+
       "\t[-m | --mod-axis] <axis_name> "
          "[min|max|fuzz|flat|resolution] [+|-|=]<value>\n"
          "\t\tModifies an axis.\n\n"
 
       "\t[-o | --toggle-option] <axis_name> "
          "[direct|real_fuzz|framed|enable|invert|not_abs|convert_to=<axis_name>]\n"
-         "\t\tToggles or sets an axis option.\n",
-      exec,
-      exec,
-      exec,
-      exec,
-      exec,
-      exec
+         "\t\tToggles or sets an axis option.\n"
    );
 }
+
+int relabsd_parameters_initialize_additional_device
+(
+   const struct relabsd_parameters parameters [const restrict static 1],
+   const int i,
+   struct relabsd_parameters result [const restrict static 1]
+)
+{
+   relabsd_parameters_initialize_options(result);
+
+   result->mode = parameters->mode;
+   result->read_argc = parameters->read_argc;
+   result->run_as_daemon = parameters->run_as_daemon;
+   result->communication_node_name = parameters->communication_node_name;
+   result->workers_count = parameters->workers_count;
+   result->output_name = parameters->output_name;
+   result->capture_file_prefix = parameters->capture_file_prefix;
+   result->stall_budget = parameters->stall_budget;
+   result->conversion_policy = parameters->conversion_policy;
+   result->conversion_priority = parameters->conversion_priority;
+   result->conversion_cpus = parameters->conversion_cpus;
+   result->lock_memory = parameters->lock_memory;
+   result->physical_device_file_name =
+      parameters->additional_physical_device_file_names[i];
+   result->configuration_file = parameters->additional_configuration_files[i];
+
+   return
+      relabsd_parameters_parse_config_file(result->configuration_file, result);
+}
@@ -1,12 +1,17 @@
 /**** POSIXS ******************************************************************/
+#include <sched.h>
 #include <stdlib.h>
 #include <string.h>
 
 /**** RELABSD *****************************************************************/
+#include <relabsd/debug.h>
+
 #include <relabsd/config/parameters.h>
 
 #include <relabsd/device/axis.h>
 
+#include <relabsd/util/string.h>
+
 /******************************************************************************/
 /**** LOCAL FUNCTIONS *********************************************************/
 /******************************************************************************/
@@ -26,7 +31,21 @@ void relabsd_parameters_initialize_options
    parameters->device_name = (const char *) NULL;
    parameters->physical_device_file_name = (const char *) NULL;
    parameters->configuration_file = (const char *) NULL;
+   parameters->use_timeout = 0;
+   parameters->late_policy = RELABSD_PHYSICAL_DEVICE_REPLAY_LATE_EVENTS;
    parameters->device_name_was_modified = 0;
+   parameters->axes_capabilities_were_modified = 0;
+   parameters->workers_count = 1;
+   parameters->shared_memory_name = (const char *) NULL;
+   parameters->output_ring_name = (const char *) NULL;
+   parameters->output_name = (const char *) NULL;
+   parameters->capture_file_prefix = (const char *) NULL;
+   parameters->stall_budget = 0;
+   parameters->conversion_policy = SCHED_OTHER;
+   parameters->conversion_priority = 0;
+   parameters->conversion_cpus = (const char *) NULL;
+   parameters->lock_memory = 0;
+   parameters->additional_devices_count = 0;
 
    for (i = 0; i < RELABSD_AXIS_VALID_AXES_COUNT; ++i)
    {
@@ -66,6 +85,94 @@ const char * relabsd_parameters_get_physical_device_file_name
    return parameters->physical_device_file_name;
 }
 
+int relabsd_parameters_get_workers_count
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+)
+{
+   return parameters->workers_count;
+}
+
+const char * relabsd_parameters_get_shared_memory_name
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+)
+{
+   return parameters->shared_memory_name;
+}
+
+const char * relabsd_parameters_get_output_ring_name
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+)
+{
+   return parameters->output_ring_name;
+}
+
+const char * relabsd_parameters_get_output_name
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+)
+{
+   return parameters->output_name;
+}
+
+const char * relabsd_parameters_get_capture_file_prefix
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+)
+{
+   return parameters->capture_file_prefix;
+}
+
+int relabsd_parameters_get_stall_budget
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+)
+{
+   return parameters->stall_budget;
+}
+
+int relabsd_parameters_get_conversion_policy
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+)
+{
+   return parameters->conversion_policy;
+}
+
+int relabsd_parameters_get_conversion_priority
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+)
+{
+   return parameters->conversion_priority;
+}
+
+const char * relabsd_parameters_get_conversion_cpus
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+)
+{
+   return parameters->conversion_cpus;
+}
+
+int relabsd_parameters_get_lock_memory
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+)
+{
+   return parameters->lock_memory;
+}
+
+int relabsd_parameters_get_additional_devices_count
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+)
+{
+   return parameters->additional_devices_count;
+}
+
 enum relabsd_parameters_run_mode relabsd_parameters_get_execution_mode
 (
    const struct relabsd_parameters parameters [const restrict static 1]
@@ -98,14 +205,13 @@ void relabsd_parameters_set_timeout
 
    parameters->use_timeout = 1;
 
-   (void) memset((void *) &(parameters->timeout), 0, sizeof(struct timeval));
+   (void) memset((void *) &(parameters->timeout), 0, sizeof(struct timespec));
 
-   /* FIXME: Not sure that's correct. */
    parameters->timeout.tv_sec = (time_t) (timeout_msec / 1000);
-   parameters->timeout.tv_usec =
+   parameters->timeout.tv_nsec =
       (
-         ((suseconds_t) timeout_msec)
-         * ((suseconds_t) 1000)
+         ((long int) (timeout_msec % 1000))
+         * ((long int) 1000000)
       );
 
    return;
@@ -119,7 +225,7 @@ int relabsd_parameters_use_timeout
    return parameters->use_timeout;
 }
 
-struct timeval relabsd_parameters_get_timeout
+struct timespec relabsd_parameters_get_timeout
 (
    const struct relabsd_parameters parameters [const restrict static 1]
 )
@@ -127,6 +233,65 @@ struct timeval relabsd_parameters_get_timeout
    return parameters->timeout;
 }
 
+int relabsd_parameters_set_late_policy_from_name
+(
+   const char name [const restrict static 1],
+   struct relabsd_parameters parameters [const restrict static 1]
+)
+{
+   if (RELABSD_STRING_EQUALS("replay", name))
+   {
+      parameters->late_policy = RELABSD_PHYSICAL_DEVICE_REPLAY_LATE_EVENTS;
+   }
+   else if (RELABSD_STRING_EQUALS("drop", name))
+   {
+      parameters->late_policy = RELABSD_PHYSICAL_DEVICE_DROP_LATE_EVENTS;
+   }
+   else if (RELABSD_STRING_EQUALS("collapse", name))
+   {
+      parameters->late_policy = RELABSD_PHYSICAL_DEVICE_COLLAPSE_LATE_EVENTS;
+   }
+   else
+   {
+      RELABSD_ERROR
+      (
+         "Unknown late policy \"%s\" (valid ones are \"replay\", \"drop\""
+         " and \"collapse\").",
+         name
+      );
+
+      return -1;
+   }
+
+   return 0;
+}
+
+const char * relabsd_parameters_get_late_policy_name
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+)
+{
+   switch (parameters->late_policy)
+   {
+      case RELABSD_PHYSICAL_DEVICE_DROP_LATE_EVENTS:
+         return "drop";
+
+      case RELABSD_PHYSICAL_DEVICE_COLLAPSE_LATE_EVENTS:
+         return "collapse";
+
+      default:
+         return "replay";
+   }
+}
+
+enum relabsd_physical_device_late_policy relabsd_parameters_get_late_policy
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+)
+{
+   return parameters->late_policy;
+}
+
 int relabsd_parameters_device_name_is_dirty
 (
    const struct relabsd_parameters parameters [const restrict static 1]
@@ -135,6 +300,22 @@ int relabsd_parameters_device_name_is_dirty
    return parameters->device_name_was_modified;
 }
 
+int relabsd_parameters_axes_capabilities_are_dirty
+(
+   const struct relabsd_parameters parameters [const restrict static 1]
+)
+{
+   return parameters->axes_capabilities_were_modified;
+}
+
+void relabsd_parameters_clean_axes_capabilities
+(
+   struct relabsd_parameters parameters [const restrict static 1]
+)
+{
+   parameters->axes_capabilities_were_modified = 0;
+}
+
 void relabsd_parameters_clean_device_name
 (
    struct relabsd_parameters parameters [const restrict static 1]
@@ -185,6 +185,63 @@ static int parse_timeout_configuration_line
    return 1;
 }
 
+static int parse_late_policy_configuration_line
+(
+   FILE file [const restrict static 1],
+   struct relabsd_parameters parameters [const static 1]
+)
+{
+   char policy[(RELABSD_OPTION_MAX_SIZE + 1)];
+   int read_count;
+
+   policy[RELABSD_OPTION_MAX_SIZE] = '\0';
+
+   errno = 0;
+
+   read_count =
+      fscanf(file, "%" RELABSD_TO_STRING(RELABSD_OPTION_MAX_SIZE) "s", policy);
+
+   if (read_count == EOF)
+   {
+      if (errno == 0)
+      {
+         RELABSD_S_FATAL
+         (
+            "Unexpected end of file while reading the late policy parameter in"
+            " the configuration file."
+         );
+      }
+      else
+      {
+         RELABSD_FATAL
+         (
+            "An error occured while reading the late policy parameter in the"
+            " configuration file: %s.",
+            strerror(errno)
+         );
+      }
+
+      return -1;
+   }
+   else if (read_count < 1)
+   {
+      RELABSD_S_FATAL
+      (
+         "Invalid parameter count for the late policy option in the"
+         " configuration file."
+      );
+
+      return -1;
+   }
+
+   if (relabsd_parameters_set_late_policy_from_name(policy, parameters) < 0)
+   {
+      return -1;
+   }
+
+   return 1;
+}
+
 /*
  * Returns -1 on (fatal) error,
  *          0 on succes.
@@ -212,6 +269,14 @@ static int parse_axis_configuration_line
       {
          return parse_timeout_configuration_line(file, parameters);
       }
+      else if
+      (
+         RELABSD_IS_PREFIX("LP", axis_name)
+         || RELABSD_IS_PREFIX("lp", axis_name)
+      )
+      {
+         return parse_late_policy_configuration_line(file, parameters);
+      }
 
       RELABSD_FATAL("Unknown axis '%s' in the configuration file.", axis_name);
 
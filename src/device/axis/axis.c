@@ -87,3 +87,36 @@ enum relabsd_axis_name relabsd_axis_get_convert_to
 {
    return axis->convert_to;
 }
+
+int relabsd_axis_has_same_configuration
+(
+   const struct relabsd_axis a [const restrict static 1],
+   const struct relabsd_axis b [const restrict static 1]
+)
+{
+   int i;
+
+   if
+   (
+      (a->min != b->min)
+      || (a->max != b->max)
+      || (a->fuzz != b->fuzz)
+      || (a->flat != b->flat)
+      || (a->resolution != b->resolution)
+      || (a->is_enabled != b->is_enabled)
+      || (a->convert_to != b->convert_to)
+   )
+   {
+      return 0;
+   }
+
+   for (i = 0; i < RELABSD_AXIS_FLAGS_COUNT; ++i)
+   {
+      if (a->flags[i] != b->flags[i])
+      {
+         return 0;
+      }
+   }
+
+   return 1;
+}
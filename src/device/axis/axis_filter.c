@@ -5,13 +5,16 @@
 /**** RELABSD *****************************************************************/
 #include <relabsd/device/axis.h>
 
+#include <relabsd/util/counter.h>
+
 /******************************************************************************/
 /**** LOCAL FUNCTIONS *********************************************************/
 /******************************************************************************/
 static int direct_filter
 (
    struct relabsd_axis axis [const restrict static 1],
-   int value [const restrict static 1]
+   int value [const restrict static 1],
+   atomic_ulong statistics [const restrict static 1]
 )
 {
    if (abs(*value - axis->previous_value) <= axis->fuzz)
@@ -21,24 +24,34 @@ static int direct_filter
          axis->previous_value = *value;
       }
 
+      RELABSD_COUNTER_ADD(statistics + RELABSD_AXIS_FUZZ_FILTERED, 1);
+
       return -1;
    }
 
    if (*value < axis->min)
    {
       *value = axis->min;
+
+      RELABSD_COUNTER_ADD(statistics + RELABSD_AXIS_CLAMPED, 1);
    }
    else if (*value > axis->max)
    {
       *value = axis->max;
+
+      RELABSD_COUNTER_ADD(statistics + RELABSD_AXIS_CLAMPED, 1);
    }
    else if (abs(*value) <= axis->flat)
    {
       *value = 0;
+
+      RELABSD_COUNTER_ADD(statistics + RELABSD_AXIS_FLATTENED, 1);
    }
 
    if (*value == axis->previous_value)
    {
+      RELABSD_COUNTER_ADD(statistics + RELABSD_AXIS_UNCHANGED, 1);
+
       return -1;
    }
 
@@ -50,7 +63,8 @@ static int direct_filter
 static int rel_to_abs_filter
 (
    struct relabsd_axis axis [const restrict static 1],
-   int value [const restrict static 1]
+   int value [const restrict static 1],
+   atomic_ulong statistics [const restrict static 1]
 )
 {
    long int guard;
@@ -73,14 +87,20 @@ static int rel_to_abs_filter
       if (*value < axis->min)
       {
          *value = axis->min;
+
+         RELABSD_COUNTER_ADD(statistics + RELABSD_AXIS_CLAMPED, 1);
       }
       else if (*value > axis->max)
       {
          *value = axis->max;
+
+         RELABSD_COUNTER_ADD(statistics + RELABSD_AXIS_CLAMPED, 1);
       }
 
       if (*value == axis->previous_value)
       {
+         RELABSD_COUNTER_ADD(statistics + RELABSD_AXIS_UNCHANGED, 1);
+
          return 0;
       }
 
@@ -92,6 +112,8 @@ static int rel_to_abs_filter
    {
       if (*value == axis->previous_value)
       {
+         RELABSD_COUNTER_ADD(statistics + RELABSD_AXIS_UNCHANGED, 1);
+
          return 0;
       }
 
@@ -108,13 +130,71 @@ static int rel_to_abs_filter
    }
 }
 
+/*
+ * The following are used by conversions, which select them according to the
+ * axis' configuration beforehand.
+ */
+static int disabled_filter
+(
+   struct relabsd_axis axis [const restrict static 1],
+   int value [const restrict static 1],
+   atomic_ulong statistics [const restrict static 1]
+)
+{
+   (void) axis;
+   (void) value;
+   (void) statistics;
+
+   return 0;
+}
+
+static int invert_filter
+(
+   struct relabsd_axis axis [const restrict static 1],
+   int value [const restrict static 1],
+   atomic_ulong statistics [const restrict static 1]
+)
+{
+   (void) axis;
+   (void) statistics;
+
+   *value = -(*value);
+
+   return 1;
+}
+
+static int inverted_direct_filter
+(
+   struct relabsd_axis axis [const restrict static 1],
+   int value [const restrict static 1],
+   atomic_ulong statistics [const restrict static 1]
+)
+{
+   *value = -(*value);
+
+   return direct_filter(axis, value, statistics);
+}
+
+static int inverted_rel_to_abs_filter
+(
+   struct relabsd_axis axis [const restrict static 1],
+   int value [const restrict static 1],
+   atomic_ulong statistics [const restrict static 1]
+)
+{
+   *value = -(*value);
+
+   return rel_to_abs_filter(axis, value, statistics);
+}
+
 /******************************************************************************/
 /**** EXPORTED FUNCTIONS ******************************************************/
 /******************************************************************************/
 int relabsd_axis_filter_new_value
 (
    struct relabsd_axis axis [const restrict static 1],
-   int value [const restrict static 1]
+   int value [const restrict static 1],
+   atomic_ulong statistics [const restrict static 1]
 )
 {
    if (!(axis->is_enabled))
@@ -134,10 +214,92 @@ int relabsd_axis_filter_new_value
 
    if (axis->flags[RELABSD_DIRECT])
    {
-      return direct_filter(axis, value);
+      return direct_filter(axis, value, statistics);
    }
    else
    {
-      return rel_to_abs_filter(axis, value);
+      return rel_to_abs_filter(axis, value, statistics);
+   }
+}
+
+void relabsd_axis_initialize_conversion
+(
+   const unsigned int rel_code,
+   struct relabsd_axis axis [const],
+   struct relabsd_axis_conversion conversion [const restrict static 1]
+)
+{
+   enum relabsd_axis_name convert_to;
+
+   conversion->axis = axis;
+   conversion->filter = NULL;
+   conversion->type = EV_REL;
+   conversion->code = rel_code;
+
+   if (axis == ((struct relabsd_axis *) NULL))
+   {
+      return;
+   }
+
+   if (!(axis->is_enabled))
+   {
+      conversion->filter = disabled_filter;
+
+      return;
+   }
+
+   convert_to = relabsd_axis_get_convert_to(axis);
+
+   if (axis->flags[RELABSD_NOT_ABS])
+   {
+      if (convert_to != RELABSD_UNKNOWN)
+      {
+         conversion->code = relabsd_axis_name_to_evdev_rel(convert_to);
+      }
+
+      if (axis->flags[RELABSD_INVERT])
+      {
+         conversion->filter = invert_filter;
+      }
+
+      return;
+   }
+
+   conversion->type = EV_ABS;
+
+   if (convert_to == RELABSD_UNKNOWN)
+   {
+      (void) relabsd_axis_name_and_evdev_abs_from_evdev_rel
+      (
+         rel_code,
+         &(conversion->code)
+      );
+   }
+   else
+   {
+      conversion->code = relabsd_axis_name_to_evdev_abs(convert_to);
+   }
+
+   if (axis->flags[RELABSD_DIRECT])
+   {
+      if (axis->flags[RELABSD_INVERT])
+      {
+         conversion->filter = inverted_direct_filter;
+      }
+      else
+      {
+         conversion->filter = direct_filter;
+      }
+   }
+   else
+   {
+      if (axis->flags[RELABSD_INVERT])
+      {
+         conversion->filter = inverted_rel_to_abs_filter;
+      }
+      else
+      {
+         conversion->filter = rel_to_abs_filter;
+      }
    }
 }
@@ -0,0 +1,1079 @@
+/**** POSIX *******************************************************************/
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**** LIBEVDEV ****************************************************************/
+#include <libevdev/libevdev.h>
+
+/**** RELABSD *****************************************************************/
+#include <relabsd/debug.h>
+#include <relabsd/replay_types.h>
+
+#include <relabsd/config/parameters.h>
+
+#include <relabsd/device/axis.h>
+#include <relabsd/device/input_backend.h>
+#include <relabsd/device/input_capabilities.h>
+#include <relabsd/device/physical_device.h>
+
+/******************************************************************************/
+/**** LOCAL FUNCTIONS *********************************************************/
+/******************************************************************************/
+/*
+ * For streams that were not given their capabilities: the relative axes that
+ * 'parameters' converts, and mouse buttons.
+ */
+static int describe_from_parameters
+(
+   const char * argument,
+   const struct relabsd_parameters parameters [const static 1],
+   struct libevdev * result [const static 1]
+)
+{
+   unsigned int code;
+   int i;
+
+   (void) argument;
+
+   *result = libevdev_new();
+
+   if (*result == (struct libevdev *) NULL)
+   {
+      RELABSD_S_FATAL("Unable to allocate a description of the input.");
+
+      return -1;
+   }
+
+   libevdev_set_name
+   (
+      *result,
+      relabsd_parameters_get_physical_device_file_name(parameters)
+   );
+
+   (void) libevdev_enable_event_type(*result, EV_SYN);
+   (void) libevdev_enable_event_type(*result, EV_REL);
+   (void) libevdev_enable_event_type(*result, EV_KEY);
+
+   for (i = 0; i < RELABSD_AXIS_VALID_AXES_COUNT; ++i)
+   {
+      if (relabsd_axis_is_enabled(parameters->axes + i))
+      {
+         (void) libevdev_enable_event_code
+         (
+            *result,
+            EV_REL,
+            relabsd_axis_name_to_evdev_rel((enum relabsd_axis_name) i),
+            NULL
+         );
+      }
+   }
+
+   for (code = BTN_LEFT; code <= BTN_TASK; ++code)
+   {
+      (void) libevdev_enable_event_code(*result, EV_KEY, code, NULL);
+   }
+
+   return 0;
+}
+
+/**** EVDEV *******************************************************************/
+static int describe_evdev
+(
+   const char * argument,
+   const struct relabsd_parameters parameters [const static 1],
+   struct libevdev * result [const static 1]
+)
+{
+   int file, err;
+
+   (void) parameters;
+
+   errno = 0;
+   file = open(argument, (O_RDONLY | O_CLOEXEC));
+
+   if (file == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Could not open physical device '%s' in read only mode: %s.",
+         argument,
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   err = libevdev_new_from_fd(file, result);
+
+   if (err != 0)
+   {
+      RELABSD_FATAL
+      (
+         "libevdev could not open physical device '%s': %s.",
+         argument,
+         strerror(-err)
+      );
+
+      (void) close(file);
+
+      return -1;
+   }
+
+   /* Only the (now copied) profile of the device was needed. */
+   errno = 0;
+
+   if (close(file) == -1)
+   {
+      RELABSD_ERROR("Could not close physical device: %s", strerror(errno));
+   }
+
+   return 0;
+}
+
+static int open_evdev
+(
+   const char * argument,
+   const struct relabsd_parameters parameters [const static 1],
+   struct relabsd_physical_device device [const static 1]
+)
+{
+   int err;
+
+   (void) parameters;
+
+   errno = 0;
+   device->file = open(argument, (O_RDONLY | O_NONBLOCK));
+
+   if (device->file == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Could not open physical device '%s' in read only mode: %s.",
+         argument,
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   err = libevdev_new_from_fd(device->file, &(device->libevdev));
+
+   if (err != 0)
+   {
+      RELABSD_FATAL
+      (
+         "libevdev could not open physical device '%s': %s.",
+         argument,
+         strerror(-err)
+      );
+
+      (void) close(device->file);
+
+      return -1;
+   }
+
+   /* Makes the timestamps comparable with the time at which they're handled. */
+   err = libevdev_set_clock_id(device->libevdev, CLOCK_MONOTONIC);
+
+   device->has_monotonic_timestamps = (err == 0);
+
+   if (err != 0)
+   {
+      RELABSD_WARNING
+      (
+         "Could not make the physical device use monotonic timestamps, latency"
+         " will not be measured: %s.",
+         strerror(-err)
+      );
+   }
+
+   /*
+    * libevdev's multitouch state cannot be kept up to date from the outside,
+    * so such devices are entirely read through libevdev.
+    */
+   device->uses_raw_reads =
+      !libevdev_has_event_code(device->libevdev, EV_ABS, ABS_MT_SLOT);
+
+   return 0;
+}
+
+static void close_evdev
+(
+   struct relabsd_physical_device device [const static 1]
+)
+{
+   libevdev_free(device->libevdev);
+
+   errno = 0;
+
+   if (close(device->file) == -1)
+   {
+      RELABSD_ERROR
+      (
+         "Could not properly close the input device: %s.",
+         strerror(errno)
+      );
+   }
+}
+
+static int read_evdev_events
+(
+   struct relabsd_physical_device device [const static 1]
+)
+{
+   ssize_t bytes_read;
+
+   do
+   {
+      errno = 0;
+
+      bytes_read =
+         read
+         (
+            device->file,
+            (void *) (device->buffer + device->buffer_length),
+            (
+               (RELABSD_PHYSICAL_DEVICE_READ_SIZE - device->buffer_length)
+               * sizeof(struct input_event)
+            )
+         );
+   }
+   while ((bytes_read == -1) && (errno == EINTR));
+
+   if (bytes_read == -1)
+   {
+      if (errno == EAGAIN)
+      {
+         return 0;
+      }
+
+      RELABSD_FATAL
+      (
+         "Unable to read from the physical device: %s.",
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   /* evdev only ever returns whole events. */
+   device->buffer_length +=
+      (((size_t) bytes_read) / sizeof(struct input_event));
+
+   return (bytes_read > 0);
+}
+
+/**** PIPE & STDIN ************************************************************/
+/* 'capabilities' is NULL if none were given. */
+static int describe_stream
+(
+   const char * capabilities,
+   const struct relabsd_parameters parameters [const static 1],
+   struct libevdev * result [const static 1]
+)
+{
+   if (capabilities == (const char *) NULL)
+   {
+      return describe_from_parameters(capabilities, parameters, result);
+   }
+
+   return
+      relabsd_input_capabilities_parse
+      (
+         relabsd_parameters_get_physical_device_file_name(parameters),
+         capabilities,
+         result
+      );
+}
+
+/* The argument is "<path>[,<capabilities>]". */
+static int describe_pipe
+(
+   const char * argument,
+   const struct relabsd_parameters parameters [const static 1],
+   struct libevdev * result [const static 1]
+)
+{
+   const char * separator;
+
+   separator =
+      (
+         (argument == (const char *) NULL) ?
+         (const char *) NULL
+         : strchr(argument, ',')
+      );
+
+   return
+      describe_stream
+      (
+         (
+            (separator == (const char *) NULL) ?
+            (const char *) NULL
+            : (separator + 1)
+         ),
+         parameters,
+         result
+      );
+}
+
+/* The argument is "[<capabilities>]". */
+static int describe_stdin
+(
+   const char * argument,
+   const struct relabsd_parameters parameters [const static 1],
+   struct libevdev * result [const static 1]
+)
+{
+   return describe_stream(argument, parameters, result);
+}
+
+/* The file has to work with epoll, which regular files do not. */
+static int check_stream
+(
+   const char name [const restrict static 1],
+   const int file
+)
+{
+   struct stat file_stat;
+
+   errno = 0;
+
+   if (fstat(file, &file_stat) == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to get information on the input \"%s\": %s.",
+         name,
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   if (S_ISREG(file_stat.st_mode) || S_ISDIR(file_stat.st_mode))
+   {
+      RELABSD_FATAL
+      (
+         "The input \"%s\" is not a stream (\"trace=<path>\" replays files).",
+         name
+      );
+
+      return -1;
+   }
+
+   return 0;
+}
+
+static int open_pipe
+(
+   const char * argument,
+   const struct relabsd_parameters parameters [const static 1],
+   struct relabsd_physical_device device [const static 1]
+)
+{
+   char path[PATH_MAX];
+   const char * separator;
+   size_t path_length;
+
+   if ((argument == (const char *) NULL) || (argument[0] == '\0'))
+   {
+      RELABSD_S_FATAL("The \"pipe\" input needs a path (\"pipe=<path>\").");
+
+      return -1;
+   }
+
+   separator = strchr(argument, ',');
+
+   path_length =
+      (
+         (separator == (const char *) NULL) ?
+         strlen(argument)
+         : ((size_t) (separator - argument))
+      );
+
+   if (path_length >= sizeof(path))
+   {
+      RELABSD_S_FATAL("The path of the input pipe is too long.");
+
+      return -1;
+   }
+
+   (void) memcpy((void *) path, (const void *) argument, path_length);
+   path[path_length] = '\0';
+
+   errno = 0;
+
+   /*
+    * Also opened for writing, so that the pipe never reaches its end when its
+    * writers come and go.
+    */
+   device->file = open(path, (O_RDWR | O_NONBLOCK | O_CLOEXEC));
+
+   if (device->file == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Could not open the input pipe '%s': %s.",
+         path,
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   if
+   (
+      (check_stream(path, device->file) < 0)
+      || (describe_pipe(argument, parameters, &(device->libevdev)) < 0)
+   )
+   {
+      (void) close(device->file);
+
+      return -1;
+   }
+
+   return 0;
+}
+
+static void close_pipe
+(
+   struct relabsd_physical_device device [const static 1]
+)
+{
+   libevdev_free(device->libevdev);
+
+   (void) close(device->file);
+}
+
+static int open_stdin
+(
+   const char * argument,
+   const struct relabsd_parameters parameters [const static 1],
+   struct relabsd_physical_device device [const static 1]
+)
+{
+   int flags;
+
+   device->file = STDIN_FILENO;
+
+   if (check_stream("stdin", device->file) < 0)
+   {
+      return -1;
+   }
+
+   flags = fcntl(device->file, F_GETFL);
+
+   errno = 0;
+
+   if
+   (
+      (flags == -1)
+      || (fcntl(device->file, F_SETFL, (flags | O_NONBLOCK)) == -1)
+   )
+   {
+      RELABSD_FATAL
+      (
+         "Unable to make the standard input non-blocking: %s.",
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   return describe_stdin(argument, parameters, &(device->libevdev));
+}
+
+static void close_stdin
+(
+   struct relabsd_physical_device device [const static 1]
+)
+{
+   libevdev_free(device->libevdev);
+}
+
+static int read_stream_events
+(
+   struct relabsd_physical_device device [const static 1]
+)
+{
+   char * const destination = (char *) (device->buffer + device->buffer_length);
+   const size_t capacity =
+      (
+         (RELABSD_PHYSICAL_DEVICE_READ_SIZE - device->buffer_length)
+         * sizeof(struct input_event)
+      );
+   size_t total_length, events_count;
+   ssize_t bytes_read;
+
+   (void) memcpy
+   (
+      (void *) destination,
+      (const void *) device->partial_event,
+      device->partial_event_length
+   );
+
+   do
+   {
+      errno = 0;
+
+      bytes_read =
+         read
+         (
+            device->file,
+            (void *) (destination + device->partial_event_length),
+            (capacity - device->partial_event_length)
+         );
+   }
+   while ((bytes_read == -1) && (errno == EINTR));
+
+   if (bytes_read == -1)
+   {
+      if (errno == EAGAIN)
+      {
+         return 0;
+      }
+
+      RELABSD_FATAL("Unable to read from the input: %s.", strerror(errno));
+
+      return -1;
+   }
+
+   if (bytes_read == 0)
+   {
+      RELABSD_S_WARNING("The input has reached its end.");
+
+      device->has_reached_end = 1;
+
+      return -1;
+   }
+
+   /* Unlike evdev, pipes can give parts of events. */
+   total_length = (device->partial_event_length + ((size_t) bytes_read));
+   events_count = (total_length / sizeof(struct input_event));
+
+   device->buffer_length += events_count;
+   device->partial_event_length = (total_length % sizeof(struct input_event));
+
+   (void) memcpy
+   (
+      (void *) device->partial_event,
+      (const void *)
+      (
+         destination
+         + (total_length - device->partial_event_length)
+      ),
+      device->partial_event_length
+   );
+
+   return (events_count > 0);
+}
+
+/**** TRACE *******************************************************************/
+/*
+ * Returns -1 on (fatal) error,
+ *         0 on success (which includes reaching the end of the trace).
+ */
+static int read_next_trace_event
+(
+   struct relabsd_input_trace trace [const static 1]
+)
+{
+   if
+   (
+      fread
+      (
+         (void *) &(trace->next_event),
+         sizeof(struct relabsd_replay_event),
+         1,
+         trace->file
+      )
+      != 1
+   )
+   {
+      trace->has_next_event = 0;
+
+      if (ferror(trace->file))
+      {
+         RELABSD_S_FATAL("Unable to read the trace.");
+
+         return -1;
+      }
+
+      return 0;
+   }
+
+   trace->has_next_event = 1;
+
+   trace->next_event_time.tv_sec +=
+      (time_t) (trace->next_event.delay / 1000000);
+   trace->next_event_time.tv_nsec +=
+      (long int) ((trace->next_event.delay % 1000000) * 1000);
+
+   if (trace->next_event_time.tv_nsec >= 1000000000L)
+   {
+      trace->next_event_time.tv_sec += 1;
+      trace->next_event_time.tv_nsec -= 1000000000L;
+   }
+
+   return 0;
+}
+
+/*
+ * Makes the timer expire when the next event is due, or right away if there
+ * is none, so that the end of the trace gets noticed.
+ */
+static void arm_trace_timer
+(
+   struct relabsd_physical_device device [const static 1]
+)
+{
+   struct itimerspec timer;
+
+   (void) memset((void *) &timer, 0, sizeof(struct itimerspec));
+
+   if (device->trace.has_next_event)
+   {
+      timer.it_value = device->trace.next_event_time;
+   }
+   else
+   {
+      /* An all-zero value would disarm the timer instead. */
+      timer.it_value.tv_nsec = 1;
+   }
+
+   errno = 0;
+
+   if
+   (
+      timerfd_settime
+      (
+         device->file,
+         TFD_TIMER_ABSTIME,
+         &timer,
+         (struct itimerspec *) NULL
+      )
+      == -1
+   )
+   {
+      RELABSD_ERROR("Unable to arm the trace's timer: %s.", strerror(errno));
+   }
+}
+
+/* Described as the device it was recorded from. */
+static int describe_trace
+(
+   const char * argument,
+   const struct relabsd_parameters parameters [const static 1],
+   struct libevdev * result [const static 1]
+)
+{
+   struct relabsd_replay_capabilities capabilities;
+   FILE * trace_file;
+   int returned_code;
+
+   (void) parameters;
+
+   if ((argument == (const char *) NULL) || (argument[0] == '\0'))
+   {
+      RELABSD_S_FATAL("Trace inputs need a path (\"trace=<path>\").");
+
+      return -1;
+   }
+
+   errno = 0;
+   trace_file = fopen(argument, "rbe");
+
+   if (trace_file == (FILE *) NULL)
+   {
+      RELABSD_FATAL
+      (
+         "Could not open trace file \"%s\" in read mode: %s.",
+         argument,
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   returned_code =
+      relabsd_input_capabilities_read_from_trace
+      (
+         argument,
+         trace_file,
+         &capabilities
+      );
+
+   (void) fclose(trace_file);
+
+   if (returned_code < 0)
+   {
+      return -1;
+   }
+
+   return relabsd_input_capabilities_to_libevdev(&capabilities, result);
+}
+
+static int open_trace_file
+(
+   const char * argument,
+   const int is_paced,
+   const struct relabsd_parameters parameters [const static 1],
+   struct relabsd_physical_device device [const static 1]
+)
+{
+   struct relabsd_input_trace * const trace = &(device->trace);
+   struct relabsd_replay_capabilities capabilities;
+
+   (void) parameters;
+
+   if ((argument == (const char *) NULL) || (argument[0] == '\0'))
+   {
+      RELABSD_S_FATAL("Trace inputs need a path (\"trace=<path>\").");
+
+      return -1;
+   }
+
+   errno = 0;
+   trace->file = fopen(argument, "rbe");
+
+   if (trace->file == (FILE *) NULL)
+   {
+      RELABSD_FATAL
+      (
+         "Could not open trace file \"%s\" in read mode: %s.",
+         argument,
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   if
+   (
+      relabsd_input_capabilities_read_from_trace
+      (
+         argument,
+         trace->file,
+         &capabilities
+      )
+      < 0
+   )
+   {
+      (void) fclose(trace->file);
+
+      return -1;
+   }
+
+   trace->is_paced = is_paced;
+   trace->has_yielded = 0;
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &(trace->next_event_time));
+
+   if (read_next_trace_event(trace) < 0)
+   {
+      (void) fclose(trace->file);
+
+      return -1;
+   }
+
+   errno = 0;
+
+   if (is_paced)
+   {
+      device->file =
+         timerfd_create(CLOCK_MONOTONIC, (TFD_NONBLOCK | TFD_CLOEXEC));
+   }
+   else
+   {
+      /* Never read, so that it is always readable. */
+      device->file = eventfd(1, (EFD_NONBLOCK | EFD_CLOEXEC));
+   }
+
+   if (device->file == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to create a file descriptor to wait for the trace's events:"
+         " %s.",
+         strerror(errno)
+      );
+
+      (void) fclose(trace->file);
+
+      return -1;
+   }
+
+   if
+   (
+      relabsd_input_capabilities_to_libevdev
+      (
+         &capabilities,
+         &(device->libevdev)
+      )
+      < 0
+   )
+   {
+      (void) close(device->file);
+      (void) fclose(trace->file);
+
+      return -1;
+   }
+
+   /* The events are timestamped with the time at which they are given. */
+   device->has_monotonic_timestamps = 1;
+
+   if (is_paced)
+   {
+      arm_trace_timer(device);
+   }
+
+   return 0;
+}
+
+static int open_trace
+(
+   const char * argument,
+   const struct relabsd_parameters parameters [const static 1],
+   struct relabsd_physical_device device [const static 1]
+)
+{
+   return open_trace_file(argument, 1, parameters, device);
+}
+
+static int open_fast_trace
+(
+   const char * argument,
+   const struct relabsd_parameters parameters [const static 1],
+   struct relabsd_physical_device device [const static 1]
+)
+{
+   return open_trace_file(argument, 0, parameters, device);
+}
+
+static void close_trace
+(
+   struct relabsd_physical_device device [const static 1]
+)
+{
+   libevdev_free(device->libevdev);
+
+   (void) close(device->file);
+   (void) fclose(device->trace.file);
+}
+
+static int read_trace_events
+(
+   struct relabsd_physical_device device [const static 1]
+)
+{
+   struct relabsd_input_trace * const trace = &(device->trace);
+   struct input_event * event;
+   struct timespec current_time;
+   uint64_t expirations;
+   size_t events_count;
+
+   if (trace->is_paced)
+   {
+      (void) read(device->file, (void *) &expirations, sizeof(uint64_t));
+   }
+   else if (trace->has_yielded)
+   {
+      /* Otherwise, the conversion thread would not handle anything else. */
+      trace->has_yielded = 0;
+
+      return 0;
+   }
+
+   if (!trace->has_next_event)
+   {
+      RELABSD_S_WARNING("The trace has been entirely replayed.");
+
+      device->has_reached_end = 1;
+
+      return -1;
+   }
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &current_time);
+
+   events_count = 0;
+
+   while
+   (
+      trace->has_next_event
+      && (device->buffer_length < RELABSD_PHYSICAL_DEVICE_READ_SIZE)
+      &&
+      (
+         !trace->is_paced
+         || (trace->next_event_time.tv_sec < current_time.tv_sec)
+         ||
+         (
+            (trace->next_event_time.tv_sec == current_time.tv_sec)
+            && (trace->next_event_time.tv_nsec <= current_time.tv_nsec)
+         )
+      )
+   )
+   {
+      event = (device->buffer + device->buffer_length);
+
+      if (trace->is_paced)
+      {
+         event->time.tv_sec = trace->next_event_time.tv_sec;
+         event->time.tv_usec = (trace->next_event_time.tv_nsec / 1000L);
+      }
+      else
+      {
+         event->time.tv_sec = current_time.tv_sec;
+         event->time.tv_usec = (current_time.tv_nsec / 1000L);
+      }
+
+      event->type = (__u16) trace->next_event.type;
+      event->code = (__u16) trace->next_event.code;
+      event->value = (__s32) trace->next_event.value;
+
+      device->buffer_length += 1;
+      events_count += 1;
+
+      if (read_next_trace_event(trace) < 0)
+      {
+         return -1;
+      }
+   }
+
+   if (trace->is_paced)
+   {
+      arm_trace_timer(device);
+   }
+   else
+   {
+      trace->has_yielded = 1;
+   }
+
+   return (events_count > 0);
+}
+
+static const struct relabsd_input_backend RELABSD_INPUT_BACKENDS[] =
+{
+   {
+      "trace",
+      open_trace,
+      close_trace,
+      read_trace_events,
+      describe_trace,
+      0
+   },
+   {
+      "fast-trace",
+      open_fast_trace,
+      close_trace,
+      read_trace_events,
+      describe_trace,
+      0
+   },
+   {
+      "pipe",
+      open_pipe,
+      close_pipe,
+      read_stream_events,
+      describe_pipe,
+      0
+   },
+   {
+      "stdin",
+      open_stdin,
+      close_stdin,
+      read_stream_events,
+      describe_stdin,
+      0
+   }
+};
+
+#define RELABSD_INPUT_BACKENDS_COUNT \
+   (sizeof(RELABSD_INPUT_BACKENDS) / sizeof(RELABSD_INPUT_BACKENDS[0]))
+
+static const struct relabsd_input_backend RELABSD_INPUT_BACKEND_EVDEV =
+{
+   "evdev",
+   open_evdev,
+   close_evdev,
+   read_evdev_events,
+   describe_evdev,
+   1
+};
+
+/******************************************************************************/
+/**** EXPORTED FUNCTIONS ******************************************************/
+/******************************************************************************/
+const struct relabsd_input_backend * relabsd_input_backend_find
+(
+   const char name [const restrict static 1],
+   const char * argument [const restrict static 1]
+)
+{
+   const char * separator;
+   size_t name_length, i;
+
+   separator = strchr(name, '=');
+
+   if (separator == (const char *) NULL)
+   {
+      name_length = strlen(name);
+   }
+   else
+   {
+      name_length = (size_t) (separator - name);
+   }
+
+   for (i = 0; i < RELABSD_INPUT_BACKENDS_COUNT; ++i)
+   {
+      if
+      (
+         (strlen(RELABSD_INPUT_BACKENDS[i].name) == name_length)
+         && (strncmp(RELABSD_INPUT_BACKENDS[i].name, name, name_length) == 0)
+      )
+      {
+         if (separator == (const char *) NULL)
+         {
+            *argument = (const char *) NULL;
+         }
+         else
+         {
+            *argument = (separator + 1);
+         }
+
+         return (RELABSD_INPUT_BACKENDS + i);
+      }
+   }
+
+   *argument = name;
+
+   return &RELABSD_INPUT_BACKEND_EVDEV;
+}
+
+int relabsd_input_backend_describe
+(
+   const struct relabsd_parameters parameters [const restrict static 1],
+   struct libevdev * result [const restrict static 1]
+)
+{
+   const struct relabsd_input_backend * backend;
+   const char * argument;
+
+   backend =
+      relabsd_input_backend_find
+      (
+         relabsd_parameters_get_physical_device_file_name(parameters),
+         &argument
+      );
+
+   return backend->describe(argument, parameters, result);
+}
@@ -0,0 +1,520 @@
+/**** POSIX *******************************************************************/
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**** LIBEVDEV ****************************************************************/
+#include <libevdev/libevdev.h>
+
+/**** RELABSD *****************************************************************/
+#include <relabsd/debug.h>
+#include <relabsd/replay_types.h>
+
+#include <relabsd/device/input_capabilities.h>
+
+#include <relabsd/util/string.h>
+
+/* Longest event code name that can be given, including its range. */
+#define RELABSD_INPUT_CAPABILITIES_TOKEN_SIZE 64
+
+/******************************************************************************/
+/**** LOCAL FUNCTIONS *********************************************************/
+/******************************************************************************/
+static int has_bit
+(
+   const uint8_t bits [const restrict static 1],
+   const unsigned int index
+)
+{
+   return ((bits[index / 8] & (1 << (index % 8))) != 0);
+}
+
+static void set_bit
+(
+   uint8_t bits [const restrict static 1],
+   const unsigned int index
+)
+{
+   bits[index / 8] |= (uint8_t) (1 << (index % 8));
+}
+
+static int allocate_description
+(
+   const char name [const restrict static 1],
+   struct libevdev * result [const restrict static 1]
+)
+{
+   *result = libevdev_new();
+
+   if (*result == (struct libevdev *) NULL)
+   {
+      RELABSD_S_FATAL("Unable to allocate a description of the input.");
+
+      return -1;
+   }
+
+   libevdev_set_name(*result, name);
+
+   (void) libevdev_enable_event_type(*result, EV_SYN);
+
+   return 0;
+}
+
+/*
+ * 'token' is an event code name, followed by ":<min>:<max>" for EV_ABS ones.
+ * It is modified.
+ */
+static int enable_token
+(
+   char token [const restrict static 1],
+   struct libevdev * const restrict result/*[const restrict static 1]*/
+)
+{
+   struct input_absinfo abs_info;
+   char * minimum;
+   char * maximum;
+   int type, code;
+
+   minimum = strchr(token, ':');
+
+   if (minimum != (char *) NULL)
+   {
+      *minimum = '\0';
+      minimum += 1;
+   }
+
+   for (type = 0; type < EV_CNT; ++type)
+   {
+      code = libevdev_event_code_from_name((unsigned int) type, token);
+
+      if (code >= 0)
+      {
+         break;
+      }
+   }
+
+   /* EV_REP codes also need values, which cannot be given. */
+   if ((type >= EV_CNT) || (type == EV_SYN) || (type == EV_REP))
+   {
+      RELABSD_FATAL
+      (
+         "Unsupported event code \"%s\" in the input's capabilities.",
+         token
+      );
+
+      return -1;
+   }
+
+   if (type != EV_ABS)
+   {
+      if (minimum != (char *) NULL)
+      {
+         RELABSD_FATAL
+         (
+            "Only EV_ABS event codes have a range, not \"%s\".",
+            token
+         );
+
+         return -1;
+      }
+
+      (void) libevdev_enable_event_type(result, (unsigned int) type);
+      (void) libevdev_enable_event_code
+      (
+         result,
+         (unsigned int) type,
+         (unsigned int) code,
+         NULL
+      );
+
+      return 0;
+   }
+
+   maximum =
+      (
+         (minimum == (char *) NULL) ?
+         (char *) NULL
+         : strchr(minimum, ':')
+      );
+
+   if (maximum == (char *) NULL)
+   {
+      RELABSD_FATAL
+      (
+         "EV_ABS event code \"%s\" needs a range (\"%s:<min>:<max>\").",
+         token,
+         token
+      );
+
+      return -1;
+   }
+
+   *maximum = '\0';
+   maximum += 1;
+
+   (void) memset((void *) &abs_info, 0, sizeof(struct input_absinfo));
+
+   if
+   (
+      (
+         relabsd_util_parse_int
+         (
+            minimum,
+            INT_MIN,
+            INT_MAX,
+            &(abs_info.minimum)
+         )
+         < 0
+      )
+      ||
+      (
+         relabsd_util_parse_int
+         (
+            maximum,
+            INT_MIN,
+            INT_MAX,
+            &(abs_info.maximum)
+         )
+         < 0
+      )
+      || (abs_info.minimum > abs_info.maximum)
+   )
+   {
+      RELABSD_FATAL("Invalid range for EV_ABS event code \"%s\".", token);
+
+      return -1;
+   }
+
+   (void) libevdev_enable_event_type(result, EV_ABS);
+   (void) libevdev_enable_event_code
+   (
+      result,
+      EV_ABS,
+      (unsigned int) code,
+      (const void *) &abs_info
+   );
+
+   return 0;
+}
+
+/******************************************************************************/
+/**** EXPORTED FUNCTIONS ******************************************************/
+/******************************************************************************/
+void relabsd_input_capabilities_from_libevdev
+(
+   const struct libevdev * const restrict libevdev/*[const restrict static 1]*/,
+   struct relabsd_replay_capabilities result [const restrict static 1]
+)
+{
+   const struct input_absinfo * abs_info;
+   unsigned int type, code;
+   int max_code;
+
+   (void) memset
+   (
+      (void *) result,
+      0,
+      sizeof(struct relabsd_replay_capabilities)
+   );
+
+   (void) strncpy
+   (
+      result->name,
+      libevdev_get_name(libevdev),
+      (RELABSD_REPLAY_NAME_SIZE - 1)
+   );
+
+   result->bus_type = (uint16_t) libevdev_get_id_bustype(libevdev);
+   result->vendor = (uint16_t) libevdev_get_id_vendor(libevdev);
+   result->product = (uint16_t) libevdev_get_id_product(libevdev);
+   result->version = (uint16_t) libevdev_get_id_version(libevdev);
+
+   for (code = 0; code < INPUT_PROP_CNT; ++code)
+   {
+      if (libevdev_has_property(libevdev, code))
+      {
+         set_bit(result->properties, code);
+      }
+   }
+
+   for (type = 0; type < EV_CNT; ++type)
+   {
+      max_code = libevdev_event_type_get_max(type);
+
+      for (code = 0; ((int) code) <= max_code; ++code)
+      {
+         if (!libevdev_has_event_code(libevdev, type, code))
+         {
+            continue;
+         }
+
+         set_bit(result->codes[type], code);
+
+         if (type != EV_ABS)
+         {
+            continue;
+         }
+
+         abs_info = libevdev_get_abs_info(libevdev, code);
+
+         if (abs_info == (const struct input_absinfo *) NULL)
+         {
+            continue;
+         }
+
+         result->abs_info[code].value = (int32_t) abs_info->value;
+         result->abs_info[code].minimum = (int32_t) abs_info->minimum;
+         result->abs_info[code].maximum = (int32_t) abs_info->maximum;
+         result->abs_info[code].fuzz = (int32_t) abs_info->fuzz;
+         result->abs_info[code].flat = (int32_t) abs_info->flat;
+         result->abs_info[code].resolution = (int32_t) abs_info->resolution;
+      }
+   }
+}
+
+int relabsd_input_capabilities_to_libevdev
+(
+   const struct relabsd_replay_capabilities capabilities [const static 1],
+   struct libevdev * result [const restrict static 1]
+)
+{
+   char name[RELABSD_REPLAY_NAME_SIZE];
+   struct input_absinfo abs_info;
+   unsigned int type, code;
+   int max_code;
+
+   /* The trace may not be '\0' terminated. */
+   (void) memcpy
+   (
+      (void *) name,
+      (const void *) capabilities->name,
+      sizeof(name)
+   );
+   name[RELABSD_REPLAY_NAME_SIZE - 1] = '\0';
+
+   if (allocate_description(name, result) < 0)
+   {
+      return -1;
+   }
+
+   libevdev_set_id_bustype(*result, (int) capabilities->bus_type);
+   libevdev_set_id_vendor(*result, (int) capabilities->vendor);
+   libevdev_set_id_product(*result, (int) capabilities->product);
+   libevdev_set_id_version(*result, (int) capabilities->version);
+
+   for (code = 0; code < INPUT_PROP_CNT; ++code)
+   {
+      if (has_bit(capabilities->properties, code))
+      {
+         (void) libevdev_enable_property(*result, code);
+      }
+   }
+
+   /* EV_REP codes also need values, which are left to the kernel. */
+   for (type = (EV_SYN + 1); type < EV_CNT; ++type)
+   {
+      max_code = libevdev_event_type_get_max(type);
+
+      if ((type == EV_REP) || (max_code < 0))
+      {
+         continue;
+      }
+
+      for (code = 0; ((int) code) <= max_code; ++code)
+      {
+         if (!has_bit(capabilities->codes[type], code))
+         {
+            continue;
+         }
+
+         (void) libevdev_enable_event_type(*result, type);
+
+         if (type != EV_ABS)
+         {
+            (void) libevdev_enable_event_code(*result, type, code, NULL);
+
+            continue;
+         }
+
+         (void) memset((void *) &abs_info, 0, sizeof(struct input_absinfo));
+
+         abs_info.value = (__s32) capabilities->abs_info[code].value;
+         abs_info.minimum = (__s32) capabilities->abs_info[code].minimum;
+         abs_info.maximum = (__s32) capabilities->abs_info[code].maximum;
+         abs_info.fuzz = (__s32) capabilities->abs_info[code].fuzz;
+         abs_info.flat = (__s32) capabilities->abs_info[code].flat;
+         abs_info.resolution =
+            (__s32) capabilities->abs_info[code].resolution;
+
+         (void) libevdev_enable_event_code
+         (
+            *result,
+            EV_ABS,
+            code,
+            (const void *) &abs_info
+         );
+      }
+   }
+
+   return 0;
+}
+
+int relabsd_input_capabilities_parse
+(
+   const char name [const restrict static 1],
+   const char description [const restrict static 1],
+   struct libevdev * result [const restrict static 1]
+)
+{
+   char token[RELABSD_INPUT_CAPABILITIES_TOKEN_SIZE];
+   const char * token_start;
+   const char * token_end;
+   size_t token_length;
+
+   if (allocate_description(name, result) < 0)
+   {
+      return -1;
+   }
+
+   token_start = description;
+
+   for (;;)
+   {
+      token_end = strchr(token_start, ',');
+
+      token_length =
+         (
+            (token_end == (const char *) NULL) ?
+            strlen(token_start)
+            : ((size_t) (token_end - token_start))
+         );
+
+      if ((token_length == 0) || (token_length >= sizeof(token)))
+      {
+         RELABSD_FATAL
+         (
+            "Invalid event code in the input's capabilities \"%s\".",
+            description
+         );
+
+         libevdev_free(*result);
+
+         return -1;
+      }
+
+      (void) memcpy((void *) token, (const void *) token_start, token_length);
+      token[token_length] = '\0';
+
+      if (enable_token(token, *result) < 0)
+      {
+         libevdev_free(*result);
+
+         return -1;
+      }
+
+      if (token_end == (const char *) NULL)
+      {
+         return 0;
+      }
+
+      token_start = (token_end + 1);
+   }
+}
+
+int relabsd_input_capabilities_read_from_trace
+(
+   const char trace_file_name [const restrict static 1],
+   FILE trace_file [const restrict static 1],
+   struct relabsd_replay_capabilities result [const restrict static 1]
+)
+{
+   char magic[RELABSD_REPLAY_TRACE_MAGIC_SIZE];
+
+   if
+   (
+      (fread((void *) magic, sizeof(magic), 1, trace_file) != 1)
+      ||
+      (
+         memcmp
+         (
+            (const void *) magic,
+            (const void *) RELABSD_REPLAY_TRACE_MAGIC,
+            RELABSD_REPLAY_TRACE_MAGIC_SIZE
+         )
+         != 0
+      )
+   )
+   {
+      RELABSD_FATAL
+      (
+         "\"%s\" is not a relabsd trace, or was recorded by an older version"
+         " of relabsd-replay.",
+         trace_file_name
+      );
+
+      return -1;
+   }
+
+   if
+   (
+      fread
+      (
+         (void *) result,
+         sizeof(struct relabsd_replay_capabilities),
+         1,
+         trace_file
+      )
+      != 1
+   )
+   {
+      RELABSD_FATAL
+      (
+         "Unable to read the capabilities recorded in trace \"%s\".",
+         trace_file_name
+      );
+
+      return -1;
+   }
+
+   return 0;
+}
+
+int relabsd_input_capabilities_write_to_trace
+(
+   const struct relabsd_replay_capabilities capabilities [const static 1],
+   FILE trace_file [const restrict static 1]
+)
+{
+   if
+   (
+      (
+         fwrite
+         (
+            (const void *) RELABSD_REPLAY_TRACE_MAGIC,
+            RELABSD_REPLAY_TRACE_MAGIC_SIZE,
+            1,
+            trace_file
+         )
+         != 1
+      )
+      ||
+      (
+         fwrite
+         (
+            (const void *) capabilities,
+            sizeof(struct relabsd_replay_capabilities),
+            1,
+            trace_file
+         )
+         != 1
+      )
+   )
+   {
+      RELABSD_S_FATAL("Unable to write to the trace file.");
+
+      return -1;
+   }
+
+   return 0;
+}
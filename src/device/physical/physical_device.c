@@ -1,7 +1,9 @@
 /**** POSIX *******************************************************************/
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 /**** LIBEVDEV ****************************************************************/
@@ -14,11 +16,481 @@
 
 #include <relabsd/server.h>
 
+#include <relabsd/device/input_backend.h>
 #include <relabsd/device/physical_device.h>
 
+#include <relabsd/util/probe.h>
+
 /******************************************************************************/
 /**** LOCAL FUNCTIONS *********************************************************/
 /******************************************************************************/
+/*
+ * Returns -1 on (fatal) error,
+ *         0 if there is nothing to read,
+ *         1 if something was read (and there may be more to read).
+ */
+static int read_with_libevdev
+(
+   struct relabsd_physical_device device [const restrict static 1],
+   const unsigned int flags,
+   unsigned int input_type [const restrict static 1],
+   unsigned int input_code [const restrict static 1],
+   int input_value [const restrict static 1]
+)
+{
+   int returned_code;
+   struct input_event event;
+
+   returned_code = libevdev_next_event(device->libevdev, flags, &event);
+
+   switch (returned_code)
+   {
+      /* Read an actual input. */
+      case LIBEVDEV_READ_STATUS_SUCCESS:
+         RELABSD_DEBUG
+         (
+            RELABSD_DEBUG_REAL_EVENTS,
+            "SUCCESS Valid event received: {type = %s; code = %s; value = %d}.",
+             libevdev_event_type_get_name(event.type),
+             libevdev_event_code_get_name(event.type, event.code),
+             event.value
+         );
+
+         *input_type = event.type;
+         *input_code = event.code;
+         *input_value = event.value;
+         device->last_event_time = event.time;
+
+         device->is_late = 0;
+
+         return 1;
+
+      /* Code indicating that we are late. */
+      case LIBEVDEV_READ_STATUS_SYNC:
+         if (!device->is_late)
+         {
+            device->late_episodes_count += 1;
+         }
+
+         /* There are old input events waiting to be read. */
+         device->is_late = 1;
+         /*
+          * From the documentation, the event we just read was an EV_SYN one,
+          * so we don't actually have any input event in hand.
+          */
+
+         *input_type = event.type;
+         *input_code = event.code;
+         *input_value = event.value;
+         device->last_event_time = event.time;
+
+         RELABSD_DEBUG
+         (
+            RELABSD_DEBUG_REAL_EVENTS,
+            "SYNC Valid event received: {type = %s; code = %s; value = %d}.",
+             libevdev_event_type_get_name(event.type),
+             libevdev_event_code_get_name(event.type, event.code),
+             event.value
+         );
+
+         return 1;
+
+      /* No event to read. */
+      case -EAGAIN:
+         device->is_late = 0;
+
+         return 0;
+
+      default:
+         RELABSD_FATAL
+         (
+            "Unable to access the physical device: %s.",
+            strerror(-returned_code)
+         );
+
+         relabsd_server_interrupt();
+
+         return -1;
+   }
+}
+
+/*
+ * Appends as many events as possible to the buffer.
+ *
+ * Returns -1 on (fatal) error,
+ *         0 if there was nothing to read,
+ *         1 if something was read.
+ */
+static int read_events
+(
+   struct relabsd_physical_device device [const restrict static 1]
+)
+{
+   int returned_code;
+
+   returned_code = device->input_backend->read_events(device);
+
+   /*
+    * Just as when an evdev device is unplugged. Inputs that reached their end
+    * are left to the server, as other devices may still be converted.
+    */
+   if ((returned_code < 0) && !device->has_reached_end)
+   {
+      relabsd_server_interrupt();
+   }
+
+   return returned_code;
+}
+
+/*
+ * Returns the number of buffered events that are part of complete frames, or
+ * 0 if the kernel reported dropping events, as the buffered events then need
+ * to go through the resynchronization.
+ */
+static size_t get_complete_frames_length
+(
+   const struct relabsd_physical_device device [const restrict static 1]
+)
+{
+   size_t i, result;
+
+   result = 0;
+
+   for (i = 0; i < device->buffer_length; ++i)
+   {
+      if (device->buffer[i].type == EV_SYN)
+      {
+         if (device->buffer[i].code == SYN_DROPPED)
+         {
+            return 0;
+         }
+         else if (device->buffer[i].code == SYN_REPORT)
+         {
+            result = (i + 1);
+         }
+      }
+   }
+
+   return result;
+}
+
+/*
+ * Merges the first 'length' buffered events, which end with an
+ * EV_SYN/SYN_REPORT, into a single frame. Relative values are summed, unless
+ * 'device->sums_relative_values' says otherwise. Only the latest value is kept
+ * for anything else.
+ * Without 'keeps_deltas', EV_REL and EV_MSC events are dropped instead, but the
+ * others are still kept, as they carry the device's state (e.g. a key's
+ * release).
+ *
+ * Returns the length of the resulting frame, 0 if it would have been empty.
+ */
+static size_t collapse_frames
+(
+   struct relabsd_physical_device device [const restrict static 1],
+   const size_t length,
+   const int keeps_deltas
+)
+{
+   struct input_event * const events = device->buffer;
+   long int sum;
+   size_t i, j, result;
+
+   result = 0;
+
+   for (i = 0; i < (length - 1); ++i)
+   {
+      if
+      (
+         (events[i].type == EV_SYN)
+         ||
+         (
+            !keeps_deltas
+            && ((events[i].type == EV_REL) || (events[i].type == EV_MSC))
+         )
+      )
+      {
+         continue;
+      }
+
+      for (j = 0; j < result; ++j)
+      {
+         if
+         (
+            (events[j].type == events[i].type)
+            && (events[j].code == events[i].code)
+         )
+         {
+            break;
+         }
+      }
+
+      if (j == result)
+      {
+         /* As 'result <= i', this never overwrites an unread event. */
+         events[result] = events[i];
+         result += 1;
+      }
+      else if
+      (
+         (events[i].type == EV_REL)
+         && (events[i].code < REL_CNT)
+         && device->sums_relative_values[events[i].code]
+      )
+      {
+         sum = (((long int) events[j].value) + ((long int) events[i].value));
+
+         if (sum < ((long int) INT_MIN))
+         {
+            sum = ((long int) INT_MIN);
+         }
+         else if (sum > ((long int) INT_MAX))
+         {
+            sum = ((long int) INT_MAX);
+         }
+
+         events[j].value = (int) sum;
+         events[j].time = events[i].time;
+      }
+      else
+      {
+         events[j] = events[i];
+      }
+   }
+
+   if ((result == 0) && !keeps_deltas)
+   {
+      return 0;
+   }
+
+   /* The last EV_SYN/SYN_REPORT. */
+   events[result] = events[length - 1];
+
+   return (result + 1);
+}
+
+/*
+ * Returns -1 on (fatal) error,
+ *         0 if there is nothing to read,
+ *         1 if the buffer was refilled.
+ */
+static int fill_buffer
+(
+   struct relabsd_physical_device device [const restrict static 1],
+   const enum relabsd_physical_device_late_policy late_policy
+)
+{
+   size_t late_length, kept_length;
+   int returned_code;
+
+   device->buffer_index = 0;
+   device->buffer_length = 0;
+
+   for (;;)
+   {
+      returned_code = read_events(device);
+
+      if (returned_code < 0)
+      {
+         /* What was read before the end of the input is still converted. */
+         if (device->has_reached_end && (device->buffer_length > 0))
+         {
+            break;
+         }
+
+         return -1;
+      }
+
+      /*
+       * Unless the buffer got filled, the kernel had no other event waiting:
+       * we are not behind.
+       */
+      if
+      (
+         (returned_code == 0)
+         || (device->buffer_length < RELABSD_PHYSICAL_DEVICE_READ_SIZE)
+         || (late_policy == RELABSD_PHYSICAL_DEVICE_REPLAY_LATE_EVENTS)
+      )
+      {
+         break;
+      }
+
+      late_length = get_complete_frames_length(device);
+
+      if (late_length == 0)
+      {
+         break;
+      }
+
+      kept_length =
+         collapse_frames
+         (
+            device,
+            late_length,
+            (late_policy != RELABSD_PHYSICAL_DEVICE_DROP_LATE_EVENTS)
+         );
+
+      device->discarded_late_events[late_policy] +=
+         (unsigned long int) (late_length - kept_length);
+
+      /* Moves the incomplete frame after what was kept. */
+      (void) memmove
+      (
+         (void *) (device->buffer + kept_length),
+         (const void *) (device->buffer + late_length),
+         ((device->buffer_length - late_length) * sizeof(struct input_event))
+      );
+
+      device->buffer_length -= (late_length - kept_length);
+
+      if (device->buffer_length == RELABSD_PHYSICAL_DEVICE_READ_SIZE)
+      {
+         /* Nothing could be merged, the events have to be read as they are. */
+         break;
+      }
+   }
+
+   return (device->buffer_length > 0);
+}
+
+static int read_from_buffer
+(
+   struct relabsd_physical_device device [const restrict static 1],
+   const enum relabsd_physical_device_late_policy late_policy,
+   unsigned int input_type [const restrict static 1],
+   unsigned int input_code [const restrict static 1],
+   int input_value [const restrict static 1]
+)
+{
+   const struct input_event * event;
+   int returned_code;
+
+   if (device->buffer_index == device->buffer_length)
+   {
+      returned_code = fill_buffer(device, late_policy);
+
+      if (returned_code <= 0)
+      {
+         return returned_code;
+      }
+   }
+
+   event = (device->buffer + device->buffer_index);
+   device->buffer_index += 1;
+
+   switch (event->type)
+   {
+      case EV_SYN:
+         if
+         (
+            (event->code == SYN_DROPPED)
+            && device->input_backend->can_resynchronize
+         )
+         {
+            /*
+             * The kernel's buffer overflowed. What remains of ours is
+             * incomplete, and libevdev has to query the device's actual state.
+             */
+            device->buffer_index = 0;
+            device->buffer_length = 0;
+
+            return
+               read_with_libevdev
+               (
+                  device,
+                  LIBEVDEV_READ_FLAG_FORCE_SYNC,
+                  input_type,
+                  input_code,
+                  input_value
+               );
+         }
+         break;
+
+      /*
+       * libevdev has not seen these events, but its state must stay accurate
+       * for it to be able to resynchronize.
+       */
+      case EV_KEY:
+      case EV_ABS:
+      case EV_SW:
+      case EV_LED:
+         (void) libevdev_set_event_value
+         (
+            device->libevdev,
+            event->type,
+            event->code,
+            event->value
+         );
+         break;
+
+      default:
+         break;
+   }
+
+   RELABSD_DEBUG
+   (
+      RELABSD_DEBUG_REAL_EVENTS,
+      "RAW Valid event received: {type = %s; code = %s; value = %d}.",
+       libevdev_event_type_get_name(event->type),
+       libevdev_event_code_get_name(event->type, event->code),
+       event->value
+   );
+
+   *input_type = event->type;
+   *input_code = event->code;
+   *input_value = event->value;
+   device->last_event_time = event->time;
+
+   return 1;
+}
+
+/*
+ * Reads the events libevdev gives to resynchronize its state, after the kernel
+ * dropped events. They already are the latest state, so the 'drop' policy only
+ * discards the EV_REL and EV_MSC ones: the others (e.g. a key's release) carry
+ * the device's state.
+ *
+ * Returns -1 on (fatal) error,
+ *         0 once the resynchronization is over,
+ *         1 if something was read.
+ */
+static int read_resynchronization
+(
+   struct relabsd_physical_device device [const restrict static 1],
+   const enum relabsd_physical_device_late_policy late_policy,
+   unsigned int input_type [const restrict static 1],
+   unsigned int input_code [const restrict static 1],
+   int input_value [const restrict static 1]
+)
+{
+   int returned_code;
+
+   for (;;)
+   {
+      /* Read in SYNC mode, for libevdev's state to be updated. */
+      returned_code =
+         read_with_libevdev
+         (
+            device,
+            LIBEVDEV_READ_FLAG_SYNC,
+            input_type,
+            input_code,
+            input_value
+         );
+
+      if
+      (
+         (returned_code <= 0)
+         || (late_policy != RELABSD_PHYSICAL_DEVICE_DROP_LATE_EVENTS)
+         || ((*input_type != EV_REL) && (*input_type != EV_MSC))
+      )
+      {
+         return returned_code;
+      }
+
+      device->discarded_late_events[late_policy] += 1;
+   }
+}
 
 /******************************************************************************/
 /**** EXPORTED FUNCTIONS ******************************************************/
@@ -56,175 +528,172 @@ int relabsd_physical_device_compatibility_test
 
 int relabsd_physical_device_open
 (
-   const char filename [const restrict static 1],
+   const struct relabsd_parameters parameters [const restrict static 1],
    struct relabsd_physical_device device [const restrict static 1]
 )
 {
-   int err;
+   const char * argument;
+   int i;
 
    RELABSD_DEBUG
    (
       RELABSD_DEBUG_PROGRAM_FLOW,
       "Opening physical device %s...",
-      filename
+      relabsd_parameters_get_physical_device_file_name(parameters)
    );
 
-   errno = 0;
-   device->file = open(filename, O_RDONLY);
-   device->is_late = 0;
-
-   if (device->file == -1)
-   {
-      RELABSD_FATAL
+   device->input_backend =
+      relabsd_input_backend_find
       (
-         "Could not open physical device '%s' in read only mode: %s.",
-         filename,
-         strerror(errno)
+         relabsd_parameters_get_physical_device_file_name(parameters),
+         &argument
       );
 
-      return -1;
-   }
-
-   err = libevdev_new_from_fd(device->file, &(device->libevdev));
+   device->is_late = 0;
+   device->has_reached_end = 0;
+   device->has_monotonic_timestamps = 0;
+   device->uses_raw_reads = 1;
+   device->buffer_index = 0;
+   device->buffer_length = 0;
+   device->partial_event_length = 0;
+   device->late_episodes_count = 0;
+
+   (void) memset
+   (
+      (void *) device->discarded_late_events,
+      0,
+      sizeof(device->discarded_late_events)
+   );
 
-   if (err != 0)
+   for (i = 0; i < REL_CNT; ++i)
    {
-      RELABSD_FATAL
-      (
-         "libevdev could not open physical device '%s': %s.",
-         filename,
-         strerror(-err)
-      );
-
-      close(device->file);
-
-      return -1;
+      device->sums_relative_values[i] = 1;
    }
 
-   return 0;
+   return device->input_backend->open(argument, parameters, device);
 }
 
 void relabsd_physical_device_close
 (
-   const struct relabsd_physical_device device [const restrict static 1]
+   struct relabsd_physical_device device [const restrict static 1]
 )
 {
    RELABSD_S_DEBUG(RELABSD_DEBUG_PROGRAM_FLOW, "Closing input device...");
 
-   libevdev_free(device->libevdev);
-
-   errno = 0;
+   RELABSD_DEBUG
+   (
+      RELABSD_DEBUG_PROGRAM_FLOW,
+      "Late events discarded: %lu dropped, %lu collapsed.",
+      device->discarded_late_events[RELABSD_PHYSICAL_DEVICE_DROP_LATE_EVENTS],
+      device->discarded_late_events
+      [
+         RELABSD_PHYSICAL_DEVICE_COLLAPSE_LATE_EVENTS
+      ]
+   );
 
-   if (close(device->file) == -1)
-   {
-      RELABSD_ERROR
-      (
-         "Could not properly close the input device: %s.",
-         strerror(errno)
-      );
-   }
+   device->input_backend->close(device);
 }
 
 int relabsd_physical_device_read
 (
    struct relabsd_physical_device device [const restrict static 1],
+   const enum relabsd_physical_device_late_policy late_policy,
    unsigned int input_type [const restrict static 1],
    unsigned int input_code [const restrict static 1],
    int input_value [const restrict static 1]
 )
 {
    int returned_code;
-   struct input_event event;
 
-   if (!libevdev_has_event_pending(device->libevdev))
+   /* The kernel dropped events, so libevdev is resynchronizing. */
+   if (device->is_late)
    {
-      return 0;
-   }
-
-   returned_code =
-      libevdev_next_event
-      (
-         device->libevdev,
+      returned_code =
+         read_resynchronization
          (
-            (
-               /*
-                * If we were already late, reading in NORMAL mode discards all
-                * the outdated input events, whereas reading in SYNC mode goes
-                * through them in order.
-                * TODO: add an option to allow users to drop events when late.
-                */
-               (device->is_late == 1) ?
-               LIBEVDEV_READ_FLAG_SYNC
-               : LIBEVDEV_READ_FLAG_NORMAL
-            )
-            /* "The fd is not in O_NONBLOCK and a read may block." */
-            | LIBEVDEV_READ_FLAG_BLOCKING
-         ),
-         &event
-      );
+            device,
+            late_policy,
+            input_type,
+            input_code,
+            input_value
+         );
+   }
+   else
+   {
+      returned_code = 0;
+   }
 
-   switch (returned_code)
+   /* Once the resynchronization is over, the reading goes on as usual. */
+   if (returned_code != 0)
    {
-      /* Read an actual input. */
-      case LIBEVDEV_READ_STATUS_SUCCESS:
-         RELABSD_DEBUG
+      /* Either an error, or an event of the resynchronization. */
+   }
+   else if (device->uses_raw_reads)
+   {
+      returned_code =
+         read_from_buffer
          (
-            RELABSD_DEBUG_REAL_EVENTS,
-            "SUCCESS Valid event received: {type = %s; code = %s; value = %d}.",
-             libevdev_event_type_get_name(event.type),
-             libevdev_event_code_get_name(event.type, event.code),
-             event.value
+            device,
+            late_policy,
+            input_type,
+            input_code,
+            input_value
          );
-
-         *input_type = event.type;
-         *input_code = event.code;
-         *input_value = event.value;
-
-         device->is_late = 0;
-
-         return 1;
-
-      /* Code indicating that we are late. */
-      case LIBEVDEV_READ_STATUS_SYNC:
-         /* There are old input events waiting to be read. */
-         device->is_late = 1;
-         /*
-          * From the documentation, the event we just read was an EV_SYN one,
-          * so we don't actually have any input event in hand.
-          */
-
-         *input_type = event.type;
-         *input_code = event.code;
-         *input_value = event.value;
-
-         RELABSD_DEBUG
+   }
+   else
+   {
+      returned_code =
+         read_with_libevdev
          (
-            RELABSD_DEBUG_REAL_EVENTS,
-            "SYNC Valid event received: {type = %s; code = %s; value = %d}.",
-             libevdev_event_type_get_name(event.type),
-             libevdev_event_code_get_name(event.type, event.code),
-             event.value
+            device,
+            LIBEVDEV_READ_FLAG_NORMAL,
+            input_type,
+            input_code,
+            input_value
          );
+   }
 
-         return 1;
+   if (returned_code > 0)
+   {
+      RELABSD_PROBE3(physical_read, *input_type, *input_code, *input_value);
+   }
 
-      /* No event to read. */
-      case -EAGAIN:
-         device->is_late = 0;
+   return returned_code;
+}
 
-         return 0;
+void relabsd_physical_device_set_sums_relative_values
+(
+   const unsigned int code,
+   const int sums_relative_values,
+   struct relabsd_physical_device device [const restrict static 1]
+)
+{
+   device->sums_relative_values[code] = sums_relative_values;
+}
 
-      default:
-         RELABSD_FATAL
-         (
-            "Unable to access the physical device: %s.",
-            strerror(-returned_code)
-         );
+unsigned long int relabsd_physical_device_get_late_episodes_count
+(
+   const struct relabsd_physical_device device [const restrict static 1]
+)
+{
+   return device->late_episodes_count;
+}
 
-         relabsd_server_interrupt();
+unsigned long int relabsd_physical_device_get_discarded_late_events_count
+(
+   const struct relabsd_physical_device device [const restrict static 1],
+   const enum relabsd_physical_device_late_policy late_policy
+)
+{
+   return device->discarded_late_events[late_policy];
+}
 
-         return -1;
-   }
+int relabsd_physical_device_has_reached_end
+(
+   const struct relabsd_physical_device device [const restrict static 1]
+)
+{
+   return device->has_reached_end;
 }
 
 int relabsd_physical_device_is_late
@@ -235,6 +704,23 @@ int relabsd_physical_device_is_late
    return device->is_late;
 }
 
+int relabsd_physical_device_get_last_event_time
+(
+   const struct relabsd_physical_device device [const restrict static 1],
+   struct timespec result [const restrict static 1]
+)
+{
+   if (!device->has_monotonic_timestamps)
+   {
+      return -1;
+   }
+
+   result->tv_sec = device->last_event_time.tv_sec;
+   result->tv_nsec = (((long int) device->last_event_time.tv_usec) * 1000L);
+
+   return 0;
+}
+
 int relabsd_physical_device_get_file_descriptor
 (
    const struct relabsd_physical_device device [const restrict static 1]
@@ -0,0 +1,323 @@
+/**** POSIX *******************************************************************/
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+/**** LIBEVDEV ****************************************************************/
+#include <libevdev/libevdev.h>
+#include <libevdev/libevdev-uinput.h>
+
+/**** RELABSD *****************************************************************/
+#include <relabsd/debug.h>
+
+#include <relabsd/device/output_backend.h>
+#include <relabsd/device/virtual_device.h>
+
+/******************************************************************************/
+/**** LOCAL FUNCTIONS *********************************************************/
+/******************************************************************************/
+static int write_to_file
+(
+   struct relabsd_virtual_device device [const static 1],
+   const struct input_event events [const static 1],
+   const size_t events_count
+)
+{
+   const char * data;
+   size_t remaining_bytes;
+   ssize_t written_bytes;
+
+   data = (const char *) events;
+   remaining_bytes = (events_count * sizeof(struct input_event));
+
+   while (remaining_bytes > 0)
+   {
+      errno = 0;
+      written_bytes =
+         write(device->file, (const void *) data, remaining_bytes);
+
+      device->write_syscall_count += 1;
+
+      if (written_bytes < 0)
+      {
+         if (errno == EINTR)
+         {
+            continue;
+         }
+
+         RELABSD_ERROR
+         (
+            "Unable to write a frame of %zu events to the virtual device: %s.",
+            (remaining_bytes / sizeof(struct input_event)),
+            strerror(errno)
+         );
+
+         return -1;
+      }
+
+      data += written_bytes;
+      remaining_bytes -= (size_t) written_bytes;
+   }
+
+   return 0;
+}
+
+/**** UINPUT ******************************************************************/
+static int open_uinput
+(
+   const char * argument,
+   struct relabsd_virtual_device device [const static 1]
+)
+{
+   int err;
+
+   (void) argument;
+
+   err =
+      libevdev_uinput_create_from_device
+      (
+         device->libevdev,
+         LIBEVDEV_UINPUT_OPEN_MANAGED,
+         &(device->uinput_device)
+      );
+
+   if (err != 0)
+   {
+      RELABSD_FATAL("Could not create uinput device: %s.", strerror(-err));
+
+      return -1;
+   }
+
+   device->file = libevdev_uinput_get_fd(device->uinput_device);
+
+   return 0;
+}
+
+static void close_uinput
+(
+   struct relabsd_virtual_device device [const static 1]
+)
+{
+   libevdev_uinput_destroy(device->uinput_device);
+
+   device->uinput_device = (struct libevdev_uinput *) NULL;
+}
+
+static const char * get_uinput_event_node
+(
+   const struct relabsd_virtual_device device [const static 1]
+)
+{
+   return libevdev_uinput_get_devnode(device->uinput_device);
+}
+
+/**** FILE ********************************************************************/
+static int open_file
+(
+   const char * argument,
+   struct relabsd_virtual_device device [const static 1]
+)
+{
+   if ((argument == (const char *) NULL) || (argument[0] == '\0'))
+   {
+      RELABSD_S_FATAL("The \"file\" output needs a path (\"file=<path>\").");
+
+      return -1;
+   }
+
+   errno = 0;
+
+   /*
+    * Appending, so that recreating the virtual device does not lose what was
+    * already written, and so that several devices can share the file.
+    */
+   device->file =
+      open(argument, (O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC), 0644);
+
+   if (device->file == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Could not open output file \"%s\" in write mode: %s.",
+         argument,
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   return 0;
+}
+
+static void close_file
+(
+   struct relabsd_virtual_device device [const static 1]
+)
+{
+   errno = 0;
+
+   if (close(device->file) == -1)
+   {
+      RELABSD_ERROR
+      (
+         "Unable to complete the writing of the output file: %s.",
+         strerror(errno)
+      );
+   }
+
+   device->file = -1;
+}
+
+/**** DESCRIPTOR **************************************************************/
+static int open_descriptor
+(
+   const char * argument,
+   struct relabsd_virtual_device device [const static 1]
+)
+{
+   (void) argument;
+   (void) device;
+
+   /* 'device->file' was given by the caller. */
+   return 0;
+}
+
+static void close_descriptor
+(
+   struct relabsd_virtual_device device [const static 1]
+)
+{
+   (void) device;
+}
+
+/**** NULL ********************************************************************/
+/*
+ * Frames are discarded, once counted by the virtual device like any other, so
+ * that the conversion can be measured without any uinput device or file.
+ */
+static int open_null
+(
+   const char * argument,
+   struct relabsd_virtual_device device [const static 1]
+)
+{
+   (void) argument;
+   (void) device;
+
+   return 0;
+}
+
+static void close_null
+(
+   struct relabsd_virtual_device device [const static 1]
+)
+{
+   (void) device;
+}
+
+static int write_to_null
+(
+   struct relabsd_virtual_device device [const static 1],
+   const struct input_event events [const static 1],
+   const size_t events_count
+)
+{
+   (void) device;
+   (void) events;
+   (void) events_count;
+
+   return 0;
+}
+
+static const char * get_no_event_node
+(
+   const struct relabsd_virtual_device device [const static 1]
+)
+{
+   (void) device;
+
+   return (const char *) NULL;
+}
+
+static const struct relabsd_output_backend RELABSD_OUTPUT_BACKENDS[] =
+{
+   {
+      "uinput",
+      open_uinput,
+      close_uinput,
+      write_to_file,
+      get_uinput_event_node
+   },
+   {
+      "file",
+      open_file,
+      close_file,
+      write_to_file,
+      get_no_event_node
+   },
+   {
+      "null",
+      open_null,
+      close_null,
+      write_to_null,
+      get_no_event_node
+   }
+};
+
+#define RELABSD_OUTPUT_BACKENDS_COUNT \
+   (sizeof(RELABSD_OUTPUT_BACKENDS) / sizeof(RELABSD_OUTPUT_BACKENDS[0]))
+
+static const struct relabsd_output_backend RELABSD_OUTPUT_BACKEND_DESCRIPTOR =
+{
+   "descriptor",
+   open_descriptor,
+   close_descriptor,
+   write_to_file,
+   get_no_event_node
+};
+
+/******************************************************************************/
+/**** EXPORTED FUNCTIONS ******************************************************/
+/******************************************************************************/
+const struct relabsd_output_backend * relabsd_output_backend_find
+(
+   const char option [const restrict static 1],
+   const char * argument [const restrict static 1]
+)
+{
+   const char * separator;
+   size_t name_length, i;
+
+   separator = strchr(option, '=');
+
+   if (separator == (const char *) NULL)
+   {
+      name_length = strlen(option);
+      *argument = (const char *) NULL;
+   }
+   else
+   {
+      name_length = (size_t) (separator - option);
+      *argument = (separator + 1);
+   }
+
+   for (i = 0; i < RELABSD_OUTPUT_BACKENDS_COUNT; ++i)
+   {
+      if
+      (
+         (strlen(RELABSD_OUTPUT_BACKENDS[i].name) == name_length)
+         && (strncmp(RELABSD_OUTPUT_BACKENDS[i].name, option, name_length) == 0)
+      )
+      {
+         return (RELABSD_OUTPUT_BACKENDS + i);
+      }
+   }
+
+   return (const struct relabsd_output_backend *) NULL;
+}
+
+const struct relabsd_output_backend * relabsd_output_backend_for_file (void)
+{
+   return &RELABSD_OUTPUT_BACKEND_DESCRIPTOR;
+}
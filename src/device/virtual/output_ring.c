@@ -0,0 +1,186 @@
+/**** POSIX *******************************************************************/
+#include <errno.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+/**** LIBEVDEV ****************************************************************/
+#include <libevdev/libevdev.h>
+
+/**** RELABSD *****************************************************************/
+#include <relabsd/debug.h>
+
+#include <relabsd/device/output_ring.h>
+
+/******************************************************************************/
+/**** LOCAL FUNCTIONS *********************************************************/
+/******************************************************************************/
+static void wake_readers
+(
+   struct relabsd_output_ring_writer writer [const static 1]
+)
+{
+   const uint64_t increment = 1;
+   struct relabsd_output_ring * const ring = writer->ring;
+   int i, file;
+
+   /*
+    * Readers set 'is_waiting' before checking 'write_index' one last time, so
+    * either they see the new events, or this sees that they are waiting.
+    */
+   atomic_thread_fence(memory_order_seq_cst);
+
+   for (i = 0; i < RELABSD_OUTPUT_RING_READERS_COUNT; ++i)
+   {
+      if
+      (
+         (
+            atomic_load_explicit
+            (
+               &(ring->readers[i].is_waiting),
+               memory_order_relaxed
+            )
+            == 0
+         )
+         || (atomic_exchange(&(ring->readers[i].is_waiting), 0) == 0)
+      )
+      {
+         continue;
+      }
+
+      /* Only the writer modifies it. */
+      (void) atomic_fetch_add(&(writer->wakeup_sequence), 1);
+
+      file = atomic_load(writer->files + i);
+
+      errno = 0;
+
+      if
+      (
+         (file != -1)
+         && (write(file, (const void *) &increment, sizeof(uint64_t)) == -1)
+      )
+      {
+         RELABSD_ERROR
+         (
+            "Unable to wake up reader #%d of an output ring: %s.",
+            i,
+            strerror(errno)
+         );
+      }
+
+      (void) atomic_fetch_add_explicit
+      (
+         &(writer->wakeup_sequence),
+         1,
+         memory_order_release
+      );
+   }
+}
+
+/******************************************************************************/
+/**** EXPORTED FUNCTIONS ******************************************************/
+/******************************************************************************/
+void relabsd_output_ring_write
+(
+   struct relabsd_output_ring_writer writer [const static 1],
+   const struct input_event events [const restrict static 1],
+   const size_t events_count
+)
+{
+   struct relabsd_output_ring * const ring = writer->ring;
+   struct relabsd_output_ring_event * event;
+   uint64_t write_index;
+   size_t i;
+
+   /* Only the writer modifies it. */
+   write_index =
+      atomic_load_explicit(&(ring->write_index), memory_order_relaxed);
+
+   for (i = 0; i < events_count; ++i)
+   {
+      event =
+         (
+            ring->events
+            + (write_index & (RELABSD_OUTPUT_RING_EVENTS_COUNT - 1))
+         );
+
+      /*
+       * Readers that see any part of the new event also see the index that
+       * tells them the previous one was overwritten.
+       */
+      atomic_thread_fence(memory_order_release);
+
+      atomic_store_explicit
+      (
+         &(event->type),
+         (uint16_t) events[i].type,
+         memory_order_relaxed
+      );
+
+      atomic_store_explicit
+      (
+         &(event->code),
+         (uint16_t) events[i].code,
+         memory_order_relaxed
+      );
+
+      atomic_store_explicit
+      (
+         &(event->value),
+         (int32_t) events[i].value,
+         memory_order_relaxed
+      );
+
+      write_index += 1;
+
+      atomic_store_explicit
+      (
+         &(ring->write_index),
+         write_index,
+         memory_order_release
+      );
+   }
+
+   wake_readers(writer);
+}
+
+void relabsd_output_ring_remove_reader_file
+(
+   struct relabsd_output_ring_writer writer [const static 1],
+   const int slot
+)
+{
+   unsigned int sequence;
+   int file;
+
+   file = atomic_exchange((writer->files + slot), -1);
+
+   if (file == -1)
+   {
+      return;
+   }
+
+   /*
+    * The writer loads a file after making the sequence odd, so it either sees
+    * -1, or is done with the file once the sequence changes.
+    */
+   sequence = atomic_load(&(writer->wakeup_sequence));
+
+   if ((sequence & 1) != 0)
+   {
+      /* It only makes a single write. */
+      while
+      (
+         atomic_load_explicit(&(writer->wakeup_sequence), memory_order_acquire)
+         == sequence
+      )
+      {
+         (void) sched_yield();
+      }
+   }
+
+   (void) close(file);
+}
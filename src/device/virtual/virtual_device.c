@@ -1,10 +1,13 @@
 /**** POSIX *******************************************************************/
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 /**** LIBEVDEV ****************************************************************/
@@ -17,11 +20,41 @@
 #include <relabsd/debug.h>
 
 #include <relabsd/device/axis.h>
+#include <relabsd/device/input_backend.h>
+#include <relabsd/device/output_backend.h>
+#include <relabsd/device/output_ring.h>
 #include <relabsd/device/virtual_device.h>
 
+#include <relabsd/util/capture_ring.h>
+#include <relabsd/util/probe.h>
+
 /******************************************************************************/
 /**** LOCAL FUNCTIONS *********************************************************/
 /******************************************************************************/
+static void capture_frame
+(
+   struct relabsd_virtual_device device [const restrict static 1]
+)
+{
+   struct timespec now;
+   size_t i;
+
+   /* The kernel sets the actual timestamps, which are not available here. */
+   (void) clock_gettime(CLOCK_MONOTONIC, &now);
+
+   for (i = 0; i < device->frame_length; ++i)
+   {
+      relabsd_capture_ring_add
+      (
+         device->capture_ring,
+         &now,
+         (((unsigned int) device->frame[i].type) | RELABSD_CAPTURE_RING_OUTPUT),
+         (unsigned int) device->frame[i].code,
+         (int) device->frame[i].value
+      );
+   }
+}
+
 static void replace_rel_axes
 (
    struct relabsd_parameters parameters [const static 1],
@@ -62,6 +95,243 @@ static void replace_rel_axes
 }
 
 
+static void initialize_frame
+(
+   struct relabsd_virtual_device device [const restrict static 1]
+)
+{
+   device->already_timed_out = 0;
+   device->frame_length = 0;
+   device->frame_has_content = 0;
+   device->frame_was_partially_written = 0;
+   device->output_ring = (struct relabsd_output_ring_writer *) NULL;
+   device->capture_ring = (struct relabsd_capture_ring *) NULL;
+   device->uinput_device = (struct libevdev_uinput *) NULL;
+   device->frame_count = 0;
+   device->write_syscall_count = 0;
+   device->suppressed_frame_count = 0;
+   device->merged_event_count = 0;
+}
+
+/*
+ * Changes the absinfo of an axis on the (live) uinput device through its event
+ * device node, the same way the kernel lets any EV_ABS device be recalibrated.
+ * The axis keeps its current value.
+ *
+ * Returns 0 on success,
+ *         -1 on failure.
+ */
+static int set_live_absinfo
+(
+   const unsigned int code,
+   const struct input_absinfo absinfo [const restrict static 1],
+   const struct relabsd_virtual_device device [const restrict static 1]
+)
+{
+   struct input_absinfo current_absinfo;
+   const char * devnode;
+   int file, result;
+
+   devnode = device->output_backend->get_event_node(device);
+
+   if (devnode == (const char *) NULL)
+   {
+      RELABSD_S_WARNING("Could not find the virtual device's event node.");
+
+      return -1;
+   }
+
+   errno = 0;
+
+   file = open(devnode, (O_RDONLY | O_NONBLOCK | O_CLOEXEC));
+
+   if (file == -1)
+   {
+      RELABSD_WARNING
+      (
+         "Could not open the virtual device's event node '%s': %s.",
+         devnode,
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   result = 0;
+   errno = 0;
+
+   if (ioctl(file, EVIOCGABS(code), &current_absinfo) == -1)
+   {
+      result = -1;
+   }
+   else
+   {
+      current_absinfo.minimum = absinfo->minimum;
+      current_absinfo.maximum = absinfo->maximum;
+      current_absinfo.fuzz = absinfo->fuzz;
+      current_absinfo.flat = absinfo->flat;
+      current_absinfo.resolution = absinfo->resolution;
+
+      errno = 0;
+
+      if (ioctl(file, EVIOCSABS(code), &current_absinfo) == -1)
+      {
+         result = -1;
+      }
+   }
+
+   if (result == -1)
+   {
+      RELABSD_WARNING
+      (
+         "Could not update the absinfo of the virtual device's axis %u: %s.",
+         code,
+         strerror(errno)
+      );
+   }
+
+   (void) close(file);
+
+   return result;
+}
+
+/*
+ * Within a frame, only the last value of an absolute axis matters, and
+ * relative values can be summed. Multitouch axes are excluded, as the same
+ * code is used for each contact.
+ *
+ * Returns 1 if the event was merged into one already in the frame,
+ *         0 otherwise.
+ */
+static int merge_into_frame
+(
+   struct relabsd_virtual_device device [const restrict static 1],
+   unsigned int const type,
+   unsigned int const code,
+   int const value
+)
+{
+   struct input_event * event;
+   long int sum;
+   size_t i;
+
+   if (!((type == EV_REL) || ((type == EV_ABS) && (code < ABS_MT_SLOT))))
+   {
+      return 0;
+   }
+
+   for (i = device->frame_length; i > 0; --i)
+   {
+      event = (device->frame + (i - 1));
+
+      if ((event->type != type) || (event->code != code))
+      {
+         continue;
+      }
+
+      if (type == EV_ABS)
+      {
+         event->value = (__s32) value;
+      }
+      else
+      {
+         sum = (((long int) event->value) + ((long int) value));
+
+         if (sum < ((long int) INT_MIN))
+         {
+            sum = ((long int) INT_MIN);
+         }
+         else if (sum > ((long int) INT_MAX))
+         {
+            sum = ((long int) INT_MAX);
+         }
+
+         event->value = (__s32) sum;
+      }
+
+      return 1;
+   }
+
+   return 0;
+}
+
+/*
+ * 'name' is used as is for the device, unless 'parameters' has its own name
+ * for it or 'name' is NULL.
+ */
+static int create
+(
+   struct relabsd_parameters parameters [const restrict static 1],
+   const char * const name,
+   struct relabsd_virtual_device device [const restrict static 1]
+)
+{
+   struct libevdev * physical_device_libevdev;
+   const char * output;
+
+   RELABSD_S_DEBUG(RELABSD_DEBUG_PROGRAM_FLOW, "Creating virtual device...");
+
+   initialize_frame(device);
+
+   output = relabsd_parameters_get_output_name(parameters);
+
+   if (output == (const char *) NULL)
+   {
+      output = "uinput";
+   }
+
+   device->output_backend =
+      relabsd_output_backend_find(output, &(device->output_argument));
+
+   if (device->output_backend == (const struct relabsd_output_backend *) NULL)
+   {
+      RELABSD_FATAL("Unknown output \"%s\".", output);
+
+      return -1;
+   }
+
+   /* The physical device's profile, which is then modified. */
+   if
+   (
+      relabsd_input_backend_describe(parameters, &physical_device_libevdev)
+      < 0
+   )
+   {
+      return -1;
+   }
+
+   device->libevdev = physical_device_libevdev;
+
+   if
+   (
+      (name == (const char *) NULL)
+      || (relabsd_parameters_get_device_name(parameters) != (const char *) NULL)
+   )
+   {
+      /* Not exactly fatal, is it? */
+      (void) relabsd_virtual_device_rename(parameters, device);
+   }
+   else
+   {
+      libevdev_set_name(physical_device_libevdev, name);
+   }
+
+   libevdev_enable_event_type(physical_device_libevdev, EV_ABS);
+
+   replace_rel_axes(parameters, device);
+
+   if (device->output_backend->open(device->output_argument, device) < 0)
+   {
+      libevdev_free(physical_device_libevdev);
+
+      return -1;
+   }
+
+   RELABSD_S_DEBUG(RELABSD_DEBUG_PROGRAM_FLOW, "Created virtual device.");
+
+   return 0;
+}
+
 /******************************************************************************/
 /**** EXPORTED FUNCTIONS ******************************************************/
 /******************************************************************************/
@@ -193,99 +463,122 @@ int relabsd_virtual_device_update_axis_absinfo
    return 0;
 }
 
-int relabsd_virtual_device_create_from
+int relabsd_virtual_device_change_axis_absinfo
 (
-   struct relabsd_parameters parameters [const restrict static 1],
-   struct relabsd_virtual_device device [const restrict static 1]
+   const enum relabsd_axis_name axis_name,
+   const struct relabsd_axis axis [const restrict static 1],
+   const struct relabsd_virtual_device device [const restrict static 1]
 )
 {
-   int err;
-   struct libevdev * physical_device_libevdev;
-   int physical_device_file;
-
-   RELABSD_S_DEBUG(RELABSD_DEBUG_PROGRAM_FLOW, "Creating virtual device...");
-
-   device->already_timed_out = 0;
-
-   errno = 0;
-   physical_device_file =
-      open
-      (
-         relabsd_parameters_get_physical_device_file_name(parameters),
-         O_RDONLY
-      );
+   enum relabsd_axis_name target_axis_name;
+   struct input_absinfo absinfo;
+   unsigned int code;
+   int was_enabled;
 
-   if (physical_device_file == -1)
+   if (relabsd_axis_has_flag(axis, RELABSD_NOT_ABS))
    {
-      RELABSD_FATAL
-      (
-         "Could not open physical device '%s' in read only mode: %s.",
-         relabsd_parameters_get_physical_device_file_name(parameters),
-         strerror(errno)
-      );
-
-      return -1;
+      return 0;
    }
 
-   err = libevdev_new_from_fd(physical_device_file, &physical_device_libevdev);
+   target_axis_name = relabsd_axis_get_convert_to(axis);
 
-   if (err != 0)
+   if (target_axis_name == RELABSD_UNKNOWN)
    {
-      RELABSD_FATAL
-      (
-         "libevdev could not open physical device '%s': %s.",
-         relabsd_parameters_get_physical_device_file_name(parameters),
-         strerror(-err)
-      );
+      target_axis_name = axis_name;
+   }
 
-      (void) close(physical_device_file);
+   code = relabsd_axis_name_to_evdev_abs(target_axis_name);
+   was_enabled = libevdev_has_event_code(device->libevdev, EV_ABS, code);
 
-      return -1;
+   /* Keeps the description used for any later recreation up to date. */
+   (void) relabsd_virtual_device_update_axis_absinfo(axis_name, axis, device);
+
+   if
+   (
+      device->output_backend->get_event_node(device)
+      == (const char *) NULL
+   )
+   {
+      /* There is no live device to update. */
+      return 0;
    }
 
-   device->libevdev = physical_device_libevdev;
+   if (!was_enabled)
+   {
+      /* The live device does not have that axis at all. */
+      return 1;
+   }
 
-   /* Not exactly fatal, is it? */
-   (void) relabsd_virtual_device_rename(parameters, device);
+   relabsd_axis_to_absinfo(axis, &absinfo);
 
-   libevdev_enable_event_type(physical_device_libevdev, EV_ABS);
+   if (set_live_absinfo(code, &absinfo, device) < 0)
+   {
+      return 1;
+   }
 
-   replace_rel_axes(parameters, device);
+   RELABSD_DEBUG
+   (
+      RELABSD_DEBUG_CONFIG,
+      "Updated the virtual device's axis %u in place.",
+      code
+   );
 
-   err =
-      libevdev_uinput_create_from_device
-      (
-         physical_device_libevdev,
-         /* See top of the file. */
-         LIBEVDEV_UINPUT_OPEN_MANAGED,
-         &(device->uinput_device)
-      );
+   return 0;
+}
 
-   if (err !=  0)
-   {
-      RELABSD_FATAL("Could not create uinput device: %s.", strerror(-err));
+int relabsd_virtual_device_create_from
+(
+   struct relabsd_parameters parameters [const restrict static 1],
+   struct relabsd_virtual_device device [const restrict static 1]
+)
+{
+   return create(parameters, (const char *) NULL, device);
+}
 
-      libevdev_free(physical_device_libevdev);
+int relabsd_virtual_device_create_replacement
+(
+   struct relabsd_parameters parameters [const restrict static 1],
+   const struct relabsd_virtual_device device [const restrict static 1],
+   struct relabsd_virtual_device replacement [const restrict static 1]
+)
+{
+   return create(parameters, libevdev_get_name(device->libevdev), replacement);
+}
 
-      (void) close(physical_device_file);
+void relabsd_virtual_device_replace
+(
+   struct relabsd_virtual_device device [const restrict static 1],
+   struct relabsd_virtual_device replacement [const restrict static 1]
+)
+{
+   struct relabsd_virtual_device previous_device;
 
-      return -1;
-   }
+   replacement->already_timed_out = device->already_timed_out;
+   replacement->output_ring = device->output_ring;
+   replacement->capture_ring = device->capture_ring;
+   replacement->frame_count = device->frame_count;
+   replacement->write_syscall_count = device->write_syscall_count;
+   replacement->suppressed_frame_count = device->suppressed_frame_count;
+   replacement->merged_event_count = device->merged_event_count;
 
-   /*
-    * We only need the physical device's (now modified) profile, not to actually
-    * read from it.
-    */
-   errno = 0;
+   previous_device = *device;
+   *device = *replacement;
 
-   if (close(physical_device_file) == -1)
-   {
-      RELABSD_ERROR("Could not close physical device: %s", strerror(errno));
-   }
+   relabsd_virtual_device_destroy(&previous_device);
+}
 
-   RELABSD_S_DEBUG(RELABSD_DEBUG_PROGRAM_FLOW, "Created virtual device.");
+void relabsd_virtual_device_create_for_file
+(
+   const int file,
+   struct relabsd_virtual_device device [const restrict static 1]
+)
+{
+   initialize_frame(device);
 
-   return 0;
+   device->libevdev = (struct libevdev *) NULL;
+   device->output_backend = relabsd_output_backend_for_file();
+   device->output_argument = (const char *) NULL;
+   device->file = file;
 }
 
 int relabsd_virtual_device_recreate
@@ -293,24 +586,13 @@ int relabsd_virtual_device_recreate
    struct relabsd_virtual_device device [const restrict static 1]
 )
 {
-   int err;
-
    RELABSD_S_DEBUG(RELABSD_DEBUG_PROGRAM_FLOW, "Recreating virtual device...");
 
-   libevdev_uinput_destroy(device->uinput_device);
-
-   err =
-      libevdev_uinput_create_from_device
-      (
-         (device->libevdev),
-         /* See top of the file. */
-         LIBEVDEV_UINPUT_OPEN_MANAGED,
-         &(device->uinput_device)
-      );
+   device->output_backend->close(device);
 
-   if (err !=  0)
+   if (device->output_backend->open(device->output_argument, device) < 0)
    {
-      RELABSD_FATAL("Could not recreate uinput device: %s.", strerror(-err));
+      RELABSD_S_FATAL("Could not recreate the virtual device.");
 
       return -1;
    }
@@ -322,12 +604,23 @@ int relabsd_virtual_device_recreate
 
 void relabsd_virtual_device_destroy
 (
-   const struct relabsd_virtual_device device [const restrict static 1]
+   struct relabsd_virtual_device device [const restrict static 1]
 )
 {
    RELABSD_S_DEBUG(RELABSD_DEBUG_PROGRAM_FLOW, "Destroying virtual device...");
 
-   libevdev_uinput_destroy(device->uinput_device);
+   RELABSD_DEBUG
+   (
+      RELABSD_DEBUG_PROGRAM_FLOW,
+      "The virtual device received %lu frames in %lu write syscalls. %lu"
+      " empty frames were suppressed, %lu events were merged.",
+      device->frame_count,
+      device->write_syscall_count,
+      device->suppressed_frame_count,
+      device->merged_event_count
+   );
+
+   device->output_backend->close(device);
    libevdev_free(device->libevdev);
 
    RELABSD_S_DEBUG(RELABSD_DEBUG_PROGRAM_FLOW, "Destroyed virtual device.");
@@ -335,13 +628,13 @@ void relabsd_virtual_device_destroy
 
 int relabsd_virtual_device_write_evdev_event
 (
-   const struct relabsd_virtual_device device [const restrict static 1],
+   struct relabsd_virtual_device device [const restrict static 1],
    unsigned int const type,
    unsigned int const code,
    int const value
 )
 {
-   int err;
+   struct input_event * event;
 
    RELABSD_DEBUG
    (
@@ -357,45 +650,122 @@ int relabsd_virtual_device_write_evdev_event
     * with an EV_SYN/SYN_REPORT/0 event. Otherwise, listeners on the device node
     * will not see the events until the next EV_SYN event is posted."
     * We'll simply send the 'EV_SYN' events when we read them from the physical
-    * device.
+    * device. Since nobody will see the events before that, there is no point
+    * in writing them any earlier.
     */
-   err = libevdev_uinput_write_event(device->uinput_device, type, code, value);
+   if ((type == EV_SYN) && (code == SYN_REPORT))
+   {
+      if (!device->frame_has_content)
+      {
+         /* Nobody needs to be woken up for this frame. */
+         device->frame_length = 0;
+         device->suppressed_frame_count += 1;
+
+         return 0;
+      }
 
-   if (err != 0)
+      device->frame_has_content = 0;
+      device->frame_was_partially_written = 0;
+   }
+   else
    {
-      RELABSD_ERROR
-      (
-         "Unable to generate event {type = %s; code = %s; value = %d}: %s.",
-         libevdev_event_type_get_name(type),
-         libevdev_event_code_get_name(type, code),
-         value,
-         strerror(-err)
-      );
+      if (merge_into_frame(device, type, code, value))
+      {
+         device->merged_event_count += 1;
 
-      return -1;
+         return 0;
+      }
+
+      /* Only there to give timing information on other events. */
+      if (!((type == EV_MSC) && (code == MSC_TIMESTAMP)))
+      {
+         device->frame_has_content = 1;
+      }
    }
 
-   /*
-    * TODO: check if this is needed.
-   if (type == EV_KEY)
+   if (device->frame_length == RELABSD_VIRTUAL_DEVICE_FRAME_SIZE)
+   {
+      device->frame_was_partially_written = 1;
+
+      if (relabsd_virtual_device_flush(device) < 0)
+      {
+         return -1;
+      }
+   }
+
+   event = (device->frame + device->frame_length);
+
+   /* The kernel sets the timestamps of events written to uinput. */
+   event->input_event_sec = 0;
+   event->input_event_usec = 0;
+   event->type = (__u16) type;
+   event->code = (__u16) code;
+   event->value = (__s32) value;
+
+   device->frame_length += 1;
+
+   if ((type == EV_SYN) && (code == SYN_REPORT))
    {
-      libevdev_uinput_write_event
+      device->frame_count += 1;
+
+      return relabsd_virtual_device_flush(device);
+   }
+
+   return 0;
+}
+
+int relabsd_virtual_device_flush
+(
+   struct relabsd_virtual_device device [const restrict static 1]
+)
+{
+   size_t frame_length;
+   int result;
+
+   if
+   (
+      (device->output_ring != (struct relabsd_output_ring_writer *) NULL)
+      && (device->frame_length > 0)
+   )
+   {
+      relabsd_output_ring_write
       (
-         dev->uidev,
-         EV_SYN,
-         SYN_REPORT,
-         0
+         device->output_ring,
+         device->frame,
+         device->frame_length
       );
    }
-   */
 
-   return 0;
+   if
+   (
+      (device->capture_ring != (struct relabsd_capture_ring *) NULL)
+      && (device->frame_length > 0)
+   )
+   {
+      capture_frame(device);
+   }
+
+   frame_length = device->frame_length;
+
+   /* The frame is considered handled, even if writing it fails. */
+   device->frame_length = 0;
+
+   if (frame_length == 0)
+   {
+      return 0;
+   }
+
+   result = device->output_backend->write(device, device->frame, frame_length);
+
+   RELABSD_PROBE2(virtual_write, frame_length, result);
+
+   return result;
 }
 
 void relabsd_virtual_device_set_axes_to_zero
 (
    struct relabsd_parameters parameters [const static 1],
-   const struct relabsd_virtual_device device [const restrict static 1]
+   struct relabsd_virtual_device device [const restrict static 1]
 )
 {
    int i;
@@ -435,6 +805,74 @@ void relabsd_virtual_device_set_axes_to_zero
    );
 }
 
+void relabsd_virtual_device_restore_axes
+(
+   struct relabsd_parameters parameters [const static 1],
+   struct relabsd_virtual_device device [const restrict static 1]
+)
+{
+   enum relabsd_axis_name target_axis_name;
+   int i;
+
+   for (i = 0; i < RELABSD_AXIS_VALID_AXES_COUNT; ++i)
+   {
+      struct relabsd_axis * axis;
+
+      axis =
+         relabsd_parameters_get_axis((enum relabsd_axis_name) i, parameters);
+
+      if
+      (
+         !relabsd_axis_is_enabled(axis)
+         || relabsd_axis_has_flag(axis, RELABSD_NOT_ABS)
+      )
+      {
+         continue;
+      }
+
+      target_axis_name = relabsd_axis_get_convert_to(axis);
+
+      if (target_axis_name == RELABSD_UNKNOWN)
+      {
+         target_axis_name = (enum relabsd_axis_name) i;
+      }
+
+      (void) relabsd_virtual_device_write_evdev_event
+      (
+         device,
+         EV_ABS,
+         relabsd_axis_name_to_evdev_abs(target_axis_name),
+         axis->previous_value
+      );
+   }
+
+   (void) relabsd_virtual_device_write_evdev_event
+   (
+      device,
+      EV_SYN,
+      SYN_REPORT,
+      0
+   );
+}
+
+void relabsd_virtual_device_set_output_ring
+(
+   struct relabsd_output_ring_writer output_ring [const],
+   struct relabsd_virtual_device device [const restrict static 1]
+)
+{
+   device->output_ring = output_ring;
+}
+
+void relabsd_virtual_device_set_capture_ring
+(
+   struct relabsd_capture_ring capture_ring [const],
+   struct relabsd_virtual_device device [const restrict static 1]
+)
+{
+   device->capture_ring = capture_ring;
+}
+
 void relabsd_virtual_device_set_has_already_timed_out
 (
    const int val,
@@ -451,3 +889,44 @@ int relabsd_virtual_device_has_already_timed_out
 {
    return device->already_timed_out;
 }
+
+int relabsd_virtual_device_is_at_frame_boundary
+(
+   const struct relabsd_virtual_device device [const restrict static 1]
+)
+{
+   return
+      ((device->frame_length == 0) && !(device->frame_was_partially_written));
+}
+
+unsigned long int relabsd_virtual_device_get_frame_count
+(
+   const struct relabsd_virtual_device device [const restrict static 1]
+)
+{
+   return device->frame_count;
+}
+
+unsigned long int relabsd_virtual_device_get_write_syscall_count
+(
+   const struct relabsd_virtual_device device [const restrict static 1]
+)
+{
+   return device->write_syscall_count;
+}
+
+unsigned long int relabsd_virtual_device_get_suppressed_frame_count
+(
+   const struct relabsd_virtual_device device [const restrict static 1]
+)
+{
+   return device->suppressed_frame_count;
+}
+
+unsigned long int relabsd_virtual_device_get_merged_event_count
+(
+   const struct relabsd_virtual_device device [const restrict static 1]
+)
+{
+   return device->merged_event_count;
+}
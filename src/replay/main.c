@@ -0,0 +1,71 @@
+/**** POSIX *******************************************************************/
+#include <limits.h>
+#include <stdio.h>
+
+/**** RELABSD *****************************************************************/
+#include <relabsd/debug.h>
+#include <relabsd/replay.h>
+
+#include <relabsd/util/string.h>
+
+/******************************************************************************/
+/**** LOCAL FUNCTIONS *********************************************************/
+/******************************************************************************/
+static void print_usage (const char exec [const restrict static 1])
+{
+   printf
+   (
+      "USAGES:\n"
+         "\t%s record <physical_device_file> <trace_file>\n"
+         "\t\tRecords the device's capabilities and events into <trace_file>,"
+            "\n\t\tuntil interrupted.\n\n"
+
+         "\t%s run <config_file> <trace_file> <output_file> [<repetitions>]\n"
+         "\t\tConverts the events of <trace_file> according to <config_file>,"
+            " as fast\n"
+         "\t\tas possible, and writes the resulting events to <output_file>."
+            " The\n"
+         "\t\tthroughput is then reported.\n",
+      exec,
+      exec
+   );
+}
+
+/******************************************************************************/
+/**** EXPORTED FUNCTIONS ******************************************************/
+/******************************************************************************/
+int main (int const argc, const char * const * const argv)
+{
+   int repetitions;
+
+   if ((argc == 4) && RELABSD_STRING_EQUALS("record", argv[1]))
+   {
+      return relabsd_replay_record_main(argv[2], argv[3]);
+   }
+
+   if
+   (
+      ((argc == 5) || (argc == 6))
+      && RELABSD_STRING_EQUALS("run", argv[1])
+   )
+   {
+      repetitions = 1;
+
+      if
+      (
+         (argc == 6)
+         && (relabsd_util_parse_int(argv[5], 1, INT_MAX, &repetitions) < 0)
+      )
+      {
+         RELABSD_FATAL("Invalid <repetitions> value \"%s\".", argv[5]);
+
+         return -1;
+      }
+
+      return relabsd_replay_run_main(argv[2], argv[3], argv[4], repetitions);
+   }
+
+   print_usage(argv[0]);
+
+   return -1;
+}
@@ -0,0 +1,296 @@
+/**** POSIX *******************************************************************/
+#include <linux/input.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/**** LIBEVDEV ****************************************************************/
+#include <libevdev/libevdev.h>
+
+/**** RELABSD *****************************************************************/
+#include <relabsd/config.h>
+#include <relabsd/debug.h>
+#include <relabsd/replay.h>
+
+#include <relabsd/device/input_capabilities.h>
+
+/******************************************************************************/
+/**** LOCAL FUNCTIONS *********************************************************/
+/******************************************************************************/
+static volatile sig_atomic_t RELABSD_REPLAY_RUN = 1;
+
+static void interrupt (int unused_mandatory_parameter)
+{
+   (void) unused_mandatory_parameter;
+
+   RELABSD_REPLAY_RUN = 0;
+}
+
+/*
+ * No SA_RESTART: the interruption has to make the blocking 'read' on the
+ * physical device return.
+ */
+static int set_signal_handlers (void)
+{
+   struct sigaction action;
+
+   memset((void *) &action, 0, sizeof(struct sigaction));
+
+   action.sa_handler = interrupt;
+   (void) sigemptyset(&(action.sa_mask));
+
+   errno = 0;
+
+   if
+   (
+      (sigaction(SIGINT, &action, (struct sigaction *) NULL) == -1)
+      || (sigaction(SIGTERM, &action, (struct sigaction *) NULL) == -1)
+   )
+   {
+      RELABSD_FATAL("Unable to set the signal handlers: %s.", strerror(errno));
+
+      return -1;
+   }
+
+   return 0;
+}
+
+static uint32_t get_delay
+(
+   const struct timeval previous_time [const restrict static 1],
+   const struct timeval current_time [const restrict static 1]
+)
+{
+   long long int delay;
+
+   delay =
+      (
+         (
+            ((long long int) current_time->tv_sec)
+            - ((long long int) previous_time->tv_sec)
+         )
+         * 1000000LL
+         + (
+            ((long long int) current_time->tv_usec)
+            - ((long long int) previous_time->tv_usec)
+         )
+      );
+
+   if (delay < 0)
+   {
+      return 0;
+   }
+
+   if (delay > ((long long int) UINT32_MAX))
+   {
+      return UINT32_MAX;
+   }
+
+   return (uint32_t) delay;
+}
+
+/* So that the trace gets replayed as coming from the same kind of device. */
+static int get_capabilities
+(
+   const int physical_device_file,
+   struct relabsd_replay_capabilities result [const restrict static 1]
+)
+{
+   struct libevdev * libevdev;
+   int err;
+
+   err = libevdev_new_from_fd(physical_device_file, &libevdev);
+
+   if (err != 0)
+   {
+      RELABSD_FATAL
+      (
+         "libevdev could not open the physical device: %s.",
+         strerror(-err)
+      );
+
+      return -1;
+   }
+
+   relabsd_input_capabilities_from_libevdev(libevdev, result);
+
+   /* This does not close 'physical_device_file'. */
+   libevdev_free(libevdev);
+
+   return 0;
+}
+
+static int record
+(
+   const int physical_device_file,
+   FILE trace_file [const restrict static 1]
+)
+{
+   struct input_event input[RELABSD_PHYSICAL_DEVICE_READ_SIZE];
+   struct relabsd_replay_event event;
+   struct timeval previous_time;
+   unsigned long int events_count;
+   ssize_t read_size;
+   size_t i;
+   int is_first_event;
+
+   events_count = 0;
+   is_first_event = 1;
+
+   while (RELABSD_REPLAY_RUN)
+   {
+      errno = 0;
+
+      read_size = read(physical_device_file, (void *) input, sizeof(input));
+
+      if (read_size == -1)
+      {
+         if (errno == EINTR)
+         {
+            continue;
+         }
+
+         RELABSD_FATAL
+         (
+            "Unable to read from the physical device: %s.",
+            strerror(errno)
+         );
+
+         return -1;
+      }
+
+      for
+      (
+         i = 0;
+         i < (((size_t) read_size) / sizeof(struct input_event));
+         ++i
+      )
+      {
+         if (is_first_event)
+         {
+            previous_time = input[i].time;
+            is_first_event = 0;
+         }
+
+         event.delay = get_delay(&previous_time, &(input[i].time));
+         event.type = (uint16_t) input[i].type;
+         event.code = (uint16_t) input[i].code;
+         event.value = (int32_t) input[i].value;
+
+         previous_time = input[i].time;
+
+         if
+         (
+            fwrite
+            (
+               (const void *) &event,
+               sizeof(struct relabsd_replay_event),
+               1,
+               trace_file
+            )
+            != 1
+         )
+         {
+            RELABSD_S_FATAL("Unable to write to the trace file.");
+
+            return -1;
+         }
+
+         ++events_count;
+      }
+   }
+
+   printf("Recorded %lu events.\n", events_count);
+
+   return 0;
+}
+
+/******************************************************************************/
+/**** EXPORTED FUNCTIONS ******************************************************/
+/******************************************************************************/
+int relabsd_replay_record_main
+(
+   const char physical_device_file_name [const restrict static 1],
+   const char trace_file_name [const restrict static 1]
+)
+{
+   struct relabsd_replay_capabilities capabilities;
+   FILE * trace_file;
+   int physical_device_file;
+   int result;
+
+   if (set_signal_handlers() < 0)
+   {
+      return -1;
+   }
+
+   errno = 0;
+
+   physical_device_file = open(physical_device_file_name, O_RDONLY);
+
+   if (physical_device_file == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Could not open physical device \"%s\" in read only mode: %s.",
+         physical_device_file_name,
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   if (get_capabilities(physical_device_file, &capabilities) < 0)
+   {
+      (void) close(physical_device_file);
+
+      return -1;
+   }
+
+   errno = 0;
+
+   trace_file = fopen(trace_file_name, "wb");
+
+   if (trace_file == (FILE *) NULL)
+   {
+      RELABSD_FATAL
+      (
+         "Could not open trace file \"%s\" in write mode: %s.",
+         trace_file_name,
+         strerror(errno)
+      );
+
+      (void) close(physical_device_file);
+
+      return -1;
+   }
+
+   if
+   (
+      relabsd_input_capabilities_write_to_trace(&capabilities, trace_file)
+      < 0
+   )
+   {
+      result = -1;
+   }
+   else
+   {
+      result = record(physical_device_file, trace_file);
+   }
+
+   (void) close(physical_device_file);
+
+   if (fclose(trace_file) != 0)
+   {
+      RELABSD_S_FATAL("Unable to complete the writing of the trace file.");
+
+      result = -1;
+   }
+
+   return result;
+}
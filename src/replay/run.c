@@ -0,0 +1,302 @@
+/**** POSIX *******************************************************************/
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**** RELABSD *****************************************************************/
+#include <relabsd/debug.h>
+#include <relabsd/replay.h>
+#include <relabsd/server.h>
+
+#include <relabsd/config/parameters.h>
+
+#include <relabsd/device/input_capabilities.h>
+#include <relabsd/device/virtual_device.h>
+
+/******************************************************************************/
+/**** LOCAL FUNCTIONS *********************************************************/
+/******************************************************************************/
+/* Too large to be put on the stack. */
+static struct relabsd_server_device RELABSD_REPLAY_DEVICE;
+
+static int load_trace
+(
+   const char trace_file_name [const restrict static 1],
+   struct relabsd_replay_event * events [const restrict static 1],
+   size_t events_count [const restrict static 1]
+)
+{
+   struct relabsd_replay_capabilities capabilities;
+   struct relabsd_replay_event * new_events;
+   FILE * trace_file;
+   size_t capacity;
+
+   errno = 0;
+
+   trace_file = fopen(trace_file_name, "rb");
+
+   if (trace_file == (FILE *) NULL)
+   {
+      RELABSD_FATAL
+      (
+         "Could not open trace file \"%s\" in read mode: %s.",
+         trace_file_name,
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   /* The output is a file, which does not need them. */
+   if
+   (
+      relabsd_input_capabilities_read_from_trace
+      (
+         trace_file_name,
+         trace_file,
+         &capabilities
+      )
+      < 0
+   )
+   {
+      (void) fclose(trace_file);
+
+      return -1;
+   }
+
+   *events = (struct relabsd_replay_event *) NULL;
+   *events_count = 0;
+   capacity = 0;
+
+   for (;;)
+   {
+      if (*events_count == capacity)
+      {
+         capacity = ((capacity == 0) ? 4096 : (capacity * 2));
+
+         errno = 0;
+
+         new_events =
+            (struct relabsd_replay_event *) realloc
+            (
+               (void *) *events,
+               (capacity * sizeof(struct relabsd_replay_event))
+            );
+
+         if (new_events == (struct relabsd_replay_event *) NULL)
+         {
+            RELABSD_FATAL
+            (
+               "Could not allocate memory for the trace's events: %s.",
+               strerror(errno)
+            );
+
+            free((void *) *events);
+            (void) fclose(trace_file);
+
+            return -1;
+         }
+
+         *events = new_events;
+      }
+
+      if
+      (
+         fread
+         (
+            (void *) (*events + *events_count),
+            sizeof(struct relabsd_replay_event),
+            1,
+            trace_file
+         )
+         != 1
+      )
+      {
+         break;
+      }
+
+      *events_count += 1;
+   }
+
+   if (ferror(trace_file))
+   {
+      RELABSD_FATAL("Unable to read trace file \"%s\".", trace_file_name);
+
+      free((void *) *events);
+      (void) fclose(trace_file);
+
+      return -1;
+   }
+
+   (void) fclose(trace_file);
+
+   return 0;
+}
+
+static double get_elapsed_seconds
+(
+   const struct timespec start [const restrict static 1],
+   const struct timespec end [const restrict static 1]
+)
+{
+   return
+      (
+         ((double) (end->tv_sec - start->tv_sec))
+         + (((double) (end->tv_nsec - start->tv_nsec)) / 1000000000.0)
+      );
+}
+
+static void print_report
+(
+   const unsigned long int events_count,
+   const double elapsed_seconds,
+   const struct relabsd_virtual_device device [const restrict static 1]
+)
+{
+   printf
+   (
+      "Converted %lu events in %.6f seconds: %.0f events/s, %.1f ns/event.\n"
+      "Wrote %lu frames in %lu write syscalls. %lu empty frames were"
+      " suppressed, %lu events were merged.\n",
+      events_count,
+      elapsed_seconds,
+      (
+         (elapsed_seconds > 0.0) ?
+         (((double) events_count) / elapsed_seconds)
+         : 0.0
+      ),
+      (
+         (events_count > 0) ?
+         ((elapsed_seconds * 1000000000.0) / ((double) events_count))
+         : 0.0
+      ),
+      relabsd_virtual_device_get_frame_count(device),
+      relabsd_virtual_device_get_write_syscall_count(device),
+      relabsd_virtual_device_get_suppressed_frame_count(device),
+      relabsd_virtual_device_get_merged_event_count(device)
+   );
+}
+
+/******************************************************************************/
+/**** EXPORTED FUNCTIONS ******************************************************/
+/******************************************************************************/
+int relabsd_replay_run_main
+(
+   const char configuration_file_name [const restrict static 1],
+   const char trace_file_name [const restrict static 1],
+   const char output_file_name [const restrict static 1],
+   const int repetitions
+)
+{
+   struct relabsd_server_device * const device = &RELABSD_REPLAY_DEVICE;
+   struct relabsd_replay_event * events;
+   struct timespec start, end;
+   size_t events_count, i;
+   int output_file;
+   int r;
+
+   relabsd_parameters_initialize_options(&(device->parameters));
+
+   if
+   (
+      relabsd_parameters_parse_config_file
+      (
+         configuration_file_name,
+         &(device->parameters)
+      )
+      < 0
+   )
+   {
+      return -1;
+   }
+
+   relabsd_server_update_conversion_table(device);
+
+   if (load_trace(trace_file_name, &events, &events_count) < 0)
+   {
+      return -1;
+   }
+
+   errno = 0;
+
+   output_file =
+      open(output_file_name, (O_WRONLY | O_CREAT | O_TRUNC), 0644);
+
+   if (output_file == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Could not open output file \"%s\" in write mode: %s.",
+         output_file_name,
+         strerror(errno)
+      );
+
+      free((void *) events);
+
+      return -1;
+   }
+
+   relabsd_virtual_device_create_for_file
+   (
+      output_file,
+      &(device->virtual_device)
+   );
+
+   /*
+    * The delays between events are ignored: the point is to measure how fast
+    * the conversion itself is.
+    */
+   (void) clock_gettime(CLOCK_MONOTONIC, &start);
+
+   for (r = 0; r < repetitions; ++r)
+   {
+      for (i = 0; i < events_count; ++i)
+      {
+         relabsd_server_convert_event
+         (
+            device,
+            (unsigned int) events[i].type,
+            (unsigned int) events[i].code,
+            (int) events[i].value
+         );
+      }
+   }
+
+   if (!relabsd_virtual_device_is_at_frame_boundary(&(device->virtual_device)))
+   {
+      (void) relabsd_virtual_device_flush(&(device->virtual_device));
+   }
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &end);
+
+   print_report
+   (
+      (((unsigned long int) events_count) * ((unsigned long int) repetitions)),
+      get_elapsed_seconds(&start, &end),
+      &(device->virtual_device)
+   );
+
+   relabsd_virtual_device_destroy(&(device->virtual_device));
+
+   free((void *) events);
+
+   errno = 0;
+
+   if (close(output_file) == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to complete the writing of output file \"%s\": %s.",
+         output_file_name,
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   return 0;
+}
@@ -8,6 +8,7 @@
 #include <unistd.h>
 
 /**** RELABSD *****************************************************************/
+#include <relabsd/config.h>
 #include <relabsd/debug.h>
 #include <relabsd/server.h>
 
@@ -18,7 +19,8 @@ static int create_socket (int result [const restrict static 1])
 {
    errno = 0;
 
-   *result = socket(AF_UNIX, SOCK_STREAM, 0);
+   /* The communication thread never waits on a single client. */
+   *result = socket(AF_UNIX, (SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC), 0);
 
    if (*result == -1)
    {
@@ -120,7 +122,7 @@ static int set_socket_as_listener (const int socket)
 {
    errno = 0;
 
-   if (listen(socket, 0) == -1)
+   if (listen(socket, RELABSD_SERVER_MAX_CLIENTS) == -1)
    {
       RELABSD_FATAL
       (
@@ -1,12 +1,19 @@
 /**** POSIX *******************************************************************/
-#include <sys/select.h>
+/* To get the 'accept4' function. */
+#define _GNU_SOURCE
+
+#include <sys/epoll.h>
 #include <sys/socket.h>
 
 #include <errno.h>
 #include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 /**** RELABSD *****************************************************************/
+#include <relabsd/config.h>
 #include <relabsd/debug.h>
 #include <relabsd/server.h>
 
@@ -15,116 +22,735 @@
 /******************************************************************************/
 /**** LOCAL FUNCTIONS *********************************************************/
 /******************************************************************************/
-static void main_loop (struct relabsd_server server [const static 1])
+/*
+ * The epoll reports on clients through their index. These three come after
+ * them.
+ */
+#define RELABSD_COMMUNICATION_NODE_INDEX RELABSD_SERVER_MAX_CLIENTS
+#define RELABSD_INTERRUPTION_INDEX (RELABSD_SERVER_MAX_CLIENTS + 1)
+#define RELABSD_SUBSCRIPTIONS_INDEX (RELABSD_SERVER_MAX_CLIENTS + 2)
+#define RELABSD_EPOLL_EVENTS_COUNT (RELABSD_SERVER_MAX_CLIENTS + 3)
+
+static int add_to_epoll
+(
+   const int epoll,
+   const int file,
+   const uint32_t events,
+   const uint32_t index
+)
+{
+   struct epoll_event event;
+
+   (void) memset((void *) &event, 0, sizeof(struct epoll_event));
+
+   event.events = events;
+   event.data.u32 = index;
+
+   errno = 0;
+
+   if (epoll_ctl(epoll, EPOLL_CTL_ADD, file, &event) == -1)
+   {
+      RELABSD_ERROR
+      (
+         "Unable to add a file descriptor to the communication epoll: %s.",
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   return 0;
+}
+
+static int create_epoll
+(
+   const int communication_socket,
+   int epoll [const restrict static 1]
+)
 {
-   int communication_socket, current_client_socket;
-   int interrupt_fd, highest_fd;
-   int ready_fds;
-   fd_set ready_to_read;
+   errno = 0;
+
+   *epoll = epoll_create1(EPOLL_CLOEXEC);
+
+   if (*epoll == -1)
+   {
+      RELABSD_ERROR
+      (
+         "Unable to create the communication thread's epoll: %s.",
+         strerror(errno)
+      );
+
+      return -1;
+   }
 
    if
    (
-      relabsd_server_create_communication_node
       (
-         relabsd_parameters_get_communication_node_name(&(server->parameters)),
-         &communication_socket
+         add_to_epoll
+         (
+            *epoll,
+            communication_socket,
+            EPOLLIN,
+            RELABSD_COMMUNICATION_NODE_INDEX
+         )
+         < 0
+      )
+      ||
+      (
+         add_to_epoll
+         (
+            *epoll,
+            relabsd_server_get_interruption_file_descriptor(),
+            EPOLLIN,
+            RELABSD_INTERRUPTION_INDEX
+         )
+         < 0
+      )
+      ||
+      (
+         add_to_epoll
+         (
+            *epoll,
+            relabsd_server_get_subscriptions_file_descriptor(),
+            EPOLLIN,
+            RELABSD_SUBSCRIPTIONS_INDEX
+         )
+         < 0
       )
-      < 0
    )
    {
-      relabsd_server_interrupt();
+      (void) close(*epoll);
 
-      return;
+      return -1;
    }
 
-   interrupt_fd = relabsd_server_get_interruption_file_descriptor();
+   return 0;
+}
 
-   if (interrupt_fd > communication_socket)
+static void close_client
+(
+   struct relabsd_server_client client [const static 1]
+)
+{
+   relabsd_server_unsubscribe(client);
+   relabsd_server_remove_output_ring_reader(client);
+
+   /* This also removes it from the epoll. */
+   (void) close(client->socket);
+
+   client->socket = -1;
+}
+
+/*
+ * Returns -1 if the server can no longer accept clients,
+ *         0 otherwise.
+ */
+static int accept_clients
+(
+   const int epoll,
+   const int communication_socket,
+   struct relabsd_server_client clients [const static 1],
+   struct relabsd_server server [const static 1]
+)
+{
+   int socket;
+   uint32_t i;
+
+   for (;;)
    {
-      highest_fd = (interrupt_fd + 1);
+      errno = 0;
+
+      socket =
+         accept4
+         (
+            communication_socket,
+            (struct sockaddr *) NULL,
+            (socklen_t *) NULL,
+            (SOCK_NONBLOCK | SOCK_CLOEXEC)
+         );
+
+      if (socket == -1)
+      {
+         if
+         (
+            (errno == EAGAIN)
+            || (errno == EWOULDBLOCK)
+            || (errno == EINTR)
+            || (errno == ECONNABORTED)
+         )
+         {
+            return 0;
+         }
+
+         RELABSD_ERROR
+         (
+            "Unable to accept on the server's socket: %s.",
+            strerror(errno)
+         );
+
+         return -1;
+      }
+
+      for (i = 0; i < RELABSD_SERVER_MAX_CLIENTS; ++i)
+      {
+         if (clients[i].socket == -1)
+         {
+            break;
+         }
+      }
+
+      if (i == RELABSD_SERVER_MAX_CLIENTS)
+      {
+         RELABSD_S_WARNING("Too many clients, refusing a new one.");
+
+         (void) close(socket);
+
+         continue;
+      }
+
+      if (add_to_epoll(epoll, socket, EPOLLIN, i) < 0)
+      {
+         (void) close(socket);
+
+         continue;
+      }
+
+      clients[i].socket = socket;
+      clients[i].epoll_events = EPOLLIN;
+      clients[i].has_ended = 0;
+      clients[i].device = server->devices;
+      clients[i].subscription = (struct relabsd_server_device *) NULL;
+      clients[i].has_missed_axes_states = 0;
+      clients[i].output_ring_device = (struct relabsd_server_device *) NULL;
+      clients[i].passed_file = -1;
+      clients[i].input_length = 0;
+      clients[i].output_length = 0;
+      clients[i].output_index = 0;
    }
-   else
+}
+
+static int wait_for
+(
+   const int epoll,
+   const uint32_t events,
+   const uint32_t index,
+   struct relabsd_server_client client [const static 1]
+)
+{
+   struct epoll_event event;
+
+   if (client->epoll_events == events)
    {
-      highest_fd = (communication_socket + 1);
+      return 0;
    }
 
-   for (;;)
+   (void) memset((void *) &event, 0, sizeof(struct epoll_event));
+
+   event.events = events;
+   event.data.u32 = index;
+
+   errno = 0;
+
+   if (epoll_ctl(epoll, EPOLL_CTL_MOD, client->socket, &event) == -1)
    {
-      FD_ZERO(&ready_to_read);
-      FD_SET(communication_socket, &ready_to_read);
-      FD_SET(interrupt_fd, &ready_to_read);
+      RELABSD_ERROR
+      (
+         "Unable to change what the epoll waits for on a client: %s.",
+         strerror(errno)
+      );
 
+      return -1;
+   }
+
+   client->epoll_events = events;
+
+   return 0;
+}
+
+/*
+ * Sends the client's output, along with 'client->passed_file'. The client
+ * gets it as ancillary data of the first bytes sent.
+ */
+static ssize_t send_with_file
+(
+   struct relabsd_server_client client [const static 1]
+)
+{
+   union
+   {
+      struct cmsghdr header;
+      char buffer[CMSG_SPACE(sizeof(int))];
+   } control;
+   struct msghdr message;
+   struct iovec data;
+   struct cmsghdr * control_header;
+   ssize_t result;
+
+   (void) memset((void *) &message, 0, sizeof(struct msghdr));
+   (void) memset((void *) &control, 0, sizeof(control));
+
+   data.iov_base = (void *) (client->output + client->output_index);
+   data.iov_len = (client->output_length - client->output_index);
+
+   message.msg_iov = &data;
+   message.msg_iovlen = 1;
+   message.msg_control = (void *) control.buffer;
+   message.msg_controllen = sizeof(control.buffer);
+
+   control_header = CMSG_FIRSTHDR(&message);
+   control_header->cmsg_level = SOL_SOCKET;
+   control_header->cmsg_type = SCM_RIGHTS;
+   control_header->cmsg_len = CMSG_LEN(sizeof(int));
+
+   (void) memcpy
+   (
+      (void *) CMSG_DATA(control_header),
+      (const void *) &(client->passed_file),
+      sizeof(int)
+   );
+
+   result = sendmsg(client->socket, &message, MSG_NOSIGNAL);
+
+   if (result > 0)
+   {
+      /* The server keeps its own copy. */
+      client->passed_file = -1;
+   }
+
+   return result;
+}
+
+/*
+ * Returns 1 once all the pending replies have been sent,
+ *         0 if the client is not ready to receive the rest of them,
+ *         -1 if the client has to be dropped.
+ */
+static int send_replies (struct relabsd_server_client client [const static 1])
+{
+   ssize_t written;
+
+   while (client->output_index < client->output_length)
+   {
       errno = 0;
 
-      ready_fds =
-         select
+      if (client->passed_file != -1)
+      {
+         written = send_with_file(client);
+      }
+      else
+      {
+         written =
+            send
+            (
+               client->socket,
+               (const void *) (client->output + client->output_index),
+               (client->output_length - client->output_index),
+               MSG_NOSIGNAL
+            );
+      }
+
+      if (written == -1)
+      {
+         if (errno == EINTR)
+         {
+            continue;
+         }
+
+         if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+         {
+            return 0;
+         }
+
+         RELABSD_ERROR
+         (
+            "Unable to send the reply to a client: %s.",
+            strerror(errno)
+         );
+
+         return -1;
+      }
+
+      client->output_index += (size_t) written;
+   }
+
+   client->output_index = 0;
+   client->output_length = 0;
+
+   return 1;
+}
+
+/*
+ * Reads whatever the client sent, as long as there is room for it.
+ *
+ * Returns 0 on success,
+ *         -1 if the client has to be dropped.
+ */
+static int receive_requests
+(
+   struct relabsd_server_client client [const static 1]
+)
+{
+   ssize_t received;
+
+   while (!client->has_ended && (client->input_length < sizeof(client->input)))
+   {
+      errno = 0;
+
+      received =
+         read
          (
-            highest_fd,
-            &ready_to_read,
-            (fd_set *) NULL,
-            (fd_set *) NULL,
-            (struct timeval *) NULL
+            client->socket,
+            (void *) (client->input + client->input_length),
+            (sizeof(client->input) - client->input_length)
          );
 
-      if (ready_fds == -1)
+      if (received == -1)
       {
+         if (errno == EINTR)
+         {
+            continue;
+         }
+
+         if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+         {
+            return 0;
+         }
+
          RELABSD_ERROR
          (
-            "Unable to select on the server's socket: %s.",
+            "Unable to read from a client: %s.",
             strerror(errno)
          );
 
-         relabsd_server_interrupt();
+         return -1;
       }
 
-      /* TODO: select error handling. */
+      if (received == 0)
+      {
+         client->has_ended = 1;
 
-      if (!relabsd_server_keep_running())
+         return 0;
+      }
+
+      client->input_length += (size_t) received;
+   }
+
+   return 0;
+}
+
+/*
+ * Handles the complete requests of the client, one at a time, each reply
+ * being sent before the next request is handled.
+ *
+ * Returns 0 on success,
+ *         -1 if the client has to be dropped.
+ */
+static int handle_requests
+(
+   const int epoll,
+   const uint32_t index,
+   struct relabsd_server_client client [const static 1],
+   struct relabsd_server server [const static 1]
+)
+{
+   struct relabsd_protocol_frame_header header;
+   size_t request_size;
+   int result;
+
+   for (;;)
+   {
+      result = send_replies(client);
+
+      if (result < 0)
       {
-         relabsd_server_destroy_communication_node
+         return -1;
+      }
+
+      if (result == 0)
+      {
+         /* No need to read requests that cannot be handled yet. */
+         return wait_for(epoll, EPOLLOUT, index, client);
+      }
+
+      if (client->has_missed_axes_states)
+      {
+         /* The client caught up, it can now get the latest one. */
+         relabsd_server_send_axes_state(client);
+
+         continue;
+      }
+
+      if (client->input_length < sizeof(header))
+      {
+         break;
+      }
+
+      (void) memcpy
+      (
+         (void *) &header,
+         (const void *) client->input,
+         sizeof(header)
+      );
+
+      if (header.length > (sizeof(client->input) - sizeof(header)))
+      {
+         RELABSD_S_ERROR("A client sent a request that is too large.");
+
+         relabsd_server_reject_request
          (
-            relabsd_parameters_get_communication_node_name
-            (
-               &(server->parameters)
-            ),
-            communication_socket
+            RELABSD_PROTOCOL_REQUEST_TOO_LARGE,
+            client
          );
 
-         return;
+         /* The rest of its input cannot be made sense of. */
+         client->input_length = 0;
+         client->has_ended = 1;
+
+         continue;
+      }
+
+      request_size = (sizeof(header) + ((size_t) header.length));
+
+      if (client->input_length < request_size)
+      {
+         break;
+      }
+
+      relabsd_server_handle_request((size_t) header.length, client, server);
+
+      client->input_length -= request_size;
+
+      (void) memmove
+      (
+         (void *) client->input,
+         (const void *) (client->input + request_size),
+         client->input_length
+      );
+   }
+
+   if (client->has_ended)
+   {
+      /* All the replies have been sent. */
+      return -1;
+   }
+
+   return wait_for(epoll, EPOLLIN, index, client);
+}
+
+static void handle_client_event
+(
+   const int epoll,
+   const uint32_t events,
+   const uint32_t index,
+   struct relabsd_server_client client [const static 1],
+   struct relabsd_server server [const static 1]
+)
+{
+   if (client->socket == -1)
+   {
+      return;
+   }
+
+   if
+   (
+      (events & EPOLLERR)
+      || (receive_requests(client) < 0)
+      || (handle_requests(epoll, index, client, server) < 0)
+   )
+   {
+      close_client(client);
+   }
+}
+
+static void send_axes_states
+(
+   const int epoll,
+   struct relabsd_server_client clients [const static 1],
+   struct relabsd_server server [const static 1]
+)
+{
+   uint32_t i;
+
+   relabsd_server_acknowledge_subscriptions_notification();
+
+   for (i = 0; i < RELABSD_SERVER_MAX_CLIENTS; ++i)
+   {
+      if
+      (
+         (clients[i].socket == -1)
+         || (clients[i].subscription == (struct relabsd_server_device *) NULL)
+      )
+      {
+         continue;
       }
 
+      relabsd_server_send_axes_state(clients + i);
+
+      if (handle_requests(epoll, i, (clients + i), server) < 0)
+      {
+         close_client(clients + i);
+      }
+   }
+}
+
+static void finalize
+(
+   const int epoll,
+   const int communication_socket,
+   struct relabsd_server_client clients [const static 1],
+   struct relabsd_server server [const static 1]
+)
+{
+   int i;
+
+   for (i = 0; i < RELABSD_SERVER_MAX_CLIENTS; ++i)
+   {
+      if (clients[i].socket != -1)
+      {
+         close_client(clients + i);
+      }
+   }
+
+   (void) close(epoll);
+
+   relabsd_server_destroy_communication_node
+   (
+      relabsd_parameters_get_communication_node_name(&(server->parameters)),
+      communication_socket
+   );
+}
+
+static void main_loop (struct relabsd_server server [const static 1])
+{
+   struct epoll_event events[RELABSD_EPOLL_EVENTS_COUNT];
+   struct relabsd_server_client * clients;
+   int communication_socket;
+   int epoll;
+   int i, ready_fds;
+
+   if
+   (
+      relabsd_server_create_communication_node
+      (
+         relabsd_parameters_get_communication_node_name(&(server->parameters)),
+         &communication_socket
+      )
+      < 0
+   )
+   {
+      relabsd_server_interrupt();
+
+      return;
+   }
+
+   if (create_epoll(communication_socket, &epoll) < 0)
+   {
+      relabsd_server_interrupt();
+      relabsd_server_destroy_communication_node
+      (
+         relabsd_parameters_get_communication_node_name(&(server->parameters)),
+         communication_socket
+      );
+
+      return;
+   }
+
+   errno = 0;
+
+   clients =
+      (struct relabsd_server_client *) calloc
+      (
+         RELABSD_SERVER_MAX_CLIENTS,
+         sizeof(struct relabsd_server_client)
+      );
+
+   if (clients == (struct relabsd_server_client *) NULL)
+   {
+      RELABSD_ERROR
+      (
+         "Could not allocate memory for the server's clients: %s.",
+         strerror(errno)
+      );
+
+      relabsd_server_interrupt();
+      (void) close(epoll);
+      relabsd_server_destroy_communication_node
+      (
+         relabsd_parameters_get_communication_node_name(&(server->parameters)),
+         communication_socket
+      );
+
+      return;
+   }
+
+   for (i = 0; i < RELABSD_SERVER_MAX_CLIENTS; ++i)
+   {
+      clients[i].socket = -1;
+   }
+
+   for (;;)
+   {
       errno = 0;
 
-      current_client_socket =
-         accept
-         (
-            communication_socket,
-            (struct sockaddr *) NULL,
-            (socklen_t *) NULL
-         );
+      ready_fds =
+         epoll_wait(epoll, events, RELABSD_EPOLL_EVENTS_COUNT, -1);
 
-      if (current_client_socket == -1)
+      if ((ready_fds == -1) && (errno != EINTR))
       {
          RELABSD_ERROR
          (
-            "Unable to accept on the server's socket: %s.",
+            "Unable to wait on the server's socket: %s.",
             strerror(errno)
          );
 
          relabsd_server_interrupt();
-         relabsd_server_destroy_communication_node
-         (
-            relabsd_parameters_get_communication_node_name
-            (
-               &(server->parameters)
-            ),
-            communication_socket
-         );
+      }
+
+      if (!relabsd_server_keep_running())
+      {
+         finalize(epoll, communication_socket, clients, server);
+         free((void *) clients);
 
          return;
       }
 
-      (void) relabsd_server_handle_client(current_client_socket, server);
+      for (i = 0; i < ready_fds; ++i)
+      {
+         if (events[i].data.u32 == RELABSD_INTERRUPTION_INDEX)
+         {
+            continue;
+         }
+
+         if (events[i].data.u32 == RELABSD_SUBSCRIPTIONS_INDEX)
+         {
+            send_axes_states(epoll, clients, server);
+
+            continue;
+         }
+
+         if (events[i].data.u32 == RELABSD_COMMUNICATION_NODE_INDEX)
+         {
+            if
+            (
+               accept_clients(epoll, communication_socket, clients, server)
+               < 0
+            )
+            {
+               relabsd_server_interrupt();
+            }
+
+            continue;
+         }
+
+         handle_client_event
+         (
+            epoll,
+            events[i].events,
+            events[i].data.u32,
+            (clients + events[i].data.u32),
+            server
+         );
+      }
    }
 }
 
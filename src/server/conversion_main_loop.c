@@ -1,8 +1,15 @@
 /**** POSIX *******************************************************************/
-#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 
 #include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 /**** RELABSD *****************************************************************/
 #include <relabsd/debug.h>
@@ -14,10 +21,135 @@
 #include <relabsd/device/physical_device.h>
 #include <relabsd/device/virtual_device.h>
 
+#include <relabsd/util/capture_ring.h>
+#include <relabsd/util/counter.h>
+#include <relabsd/util/latency_histogram.h>
+#include <relabsd/util/probe.h>
+
+/* Maximum number of ready file descriptors handled per wakeup. */
+#define RELABSD_SERVER_CONVERSION_EPOLL_EVENTS 8
+
 /******************************************************************************/
 /**** LOCAL FUNCTIONS *********************************************************/
 /******************************************************************************/
 
+static void measure_latency
+(
+   struct relabsd_server_device device [const restrict static 1]
+)
+{
+   struct timespec event_time, current_time;
+   long int microseconds;
+
+   if
+   (
+      relabsd_physical_device_get_last_event_time
+      (
+         &(device->physical_device),
+         &event_time
+      )
+      < 0
+   )
+   {
+      return;
+   }
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &current_time);
+
+   microseconds =
+      (
+         ((long int) (current_time.tv_sec - event_time.tv_sec)) * 1000000L
+         + ((current_time.tv_nsec - event_time.tv_nsec) / 1000L)
+      );
+
+   /* Guards against unreliable timestamps. */
+   if (microseconds < 0)
+   {
+      microseconds = 0;
+   }
+
+   relabsd_latency_histogram_add
+   (
+      &(device->latency_histogram),
+      (unsigned long int) microseconds
+   );
+}
+
+static void capture_input
+(
+   struct relabsd_server_device device [const restrict static 1],
+   const unsigned int input_type,
+   const unsigned int input_code,
+   const int value
+)
+{
+   struct timespec event_time;
+
+   if
+   (
+      relabsd_physical_device_get_last_event_time
+      (
+         &(device->physical_device),
+         &event_time
+      )
+      < 0
+   )
+   {
+      (void) clock_gettime(CLOCK_MONOTONIC, &event_time);
+   }
+
+   relabsd_capture_ring_add
+   (
+      device->capture_ring,
+      &event_time,
+      input_type,
+      input_code,
+      value
+   );
+}
+
+/*
+ * The physical device counts these itself, they only need to be made
+ * available to the other threads.
+ */
+static void update_late_statistics
+(
+   struct relabsd_server_device device [const restrict static 1]
+)
+{
+   atomic_ulong * const counters = device->statistics.counters;
+   const struct relabsd_physical_device * const physical_device =
+      &(device->physical_device);
+   int i;
+   unsigned long int discarded_count;
+
+   discarded_count = 0;
+
+   for (i = 0; i < RELABSD_PHYSICAL_DEVICE_LATE_POLICIES_COUNT; ++i)
+   {
+      discarded_count +=
+         relabsd_physical_device_get_discarded_late_events_count
+         (
+            physical_device,
+            (enum relabsd_physical_device_late_policy) i
+         );
+   }
+
+   atomic_store_explicit
+   (
+      (counters + RELABSD_SERVER_LATE_EPISODES),
+      relabsd_physical_device_get_late_episodes_count(physical_device),
+      memory_order_relaxed
+   );
+
+   atomic_store_explicit
+   (
+      (counters + RELABSD_SERVER_LATE_EVENTS_DISCARDED),
+      discarded_count,
+      memory_order_relaxed
+   );
+}
+
 /*
  * Returned values:
  * -1 -> error.
@@ -26,16 +158,19 @@
  */
 static int convert_input
 (
-   struct relabsd_server server [const restrict static 1]
+   struct relabsd_server_device device [const restrict static 1]
 )
 {
    unsigned int input_type, input_code;
    int value, return_code;
 
+   relabsd_server_enter_conversion_stage(RELABSD_SERVER_READING_STAGE, device);
+
    return_code =
       relabsd_physical_device_read
       (
-         &(server->physical_device),
+         &(device->physical_device),
+         relabsd_parameters_get_late_policy(&(device->parameters)),
          &input_type,
          &input_code,
          &value
@@ -46,88 +181,78 @@ static int convert_input
       return 0;
    }
 
-   if (input_type == EV_REL)
+   RELABSD_COUNTER_ADD
+   (
+      device->statistics.counters + RELABSD_SERVER_EVENTS_READ,
+      1
+   );
+
+   if (device->capture_ring != (struct relabsd_capture_ring *) NULL)
    {
-      struct relabsd_axis * axis;
-      unsigned int abs_type, abs_code;
-      enum relabsd_axis_name axis_name;
+      capture_input(device, input_type, input_code, value);
+   }
 
-      abs_type = EV_ABS;
-      axis_name =
-         relabsd_axis_name_and_evdev_abs_from_evdev_rel(input_code, &abs_code);
+   if ((input_type == EV_SYN) && (input_code == SYN_REPORT))
+   {
+      unsigned long int frame_count;
 
-      if (axis_name == RELABSD_UNKNOWN)
-      {
-         return return_code;
-      }
+      relabsd_server_enter_conversion_stage
+      (
+         RELABSD_SERVER_WRITING_STAGE,
+         device
+      );
 
-      axis = relabsd_parameters_get_axis(axis_name, &(server->parameters));
-      axis_name = relabsd_axis_get_convert_to(axis);
+      frame_count =
+         relabsd_virtual_device_get_frame_count(&(device->virtual_device));
 
-      if (relabsd_axis_has_flag(axis, RELABSD_NOT_ABS))
-      {
-         abs_type = EV_REL;
+      relabsd_server_convert_event(device, input_type, input_code, value);
 
-         if (axis_name == RELABSD_UNKNOWN)
-         {
-            abs_code = input_code;
-         }
-         else
-         {
-            abs_code = relabsd_axis_name_to_evdev_rel(axis_name);
-         }
-      }
-      else
+      /* Empty frames are not written, so they have no latency. */
+      if
+      (
+         frame_count
+         != relabsd_virtual_device_get_frame_count(&(device->virtual_device))
+      )
       {
-         if (axis_name != RELABSD_UNKNOWN)
-         {
-            abs_code = relabsd_axis_name_to_evdev_abs(axis_name);
-         }
+         measure_latency(device);
+
+         RELABSD_COUNTER_ADD
+         (
+            device->statistics.counters + RELABSD_SERVER_FRAMES_WRITTEN,
+            1
+         );
       }
 
-      switch (relabsd_axis_filter_new_value(axis, &value))
-      {
-         case -1:
-            /* Doesn't want the event to be transmitted. */
-            return return_code;
+      RELABSD_COUNTER_ADD
+      (
+         device->statistics.counters + RELABSD_SERVER_FRAMES_READ,
+         1
+      );
 
-         case 1:
-            (void) relabsd_virtual_device_write_evdev_event
-            (
-               &(server->virtual_device),
-               abs_type,
-               abs_code,
-               value
-            );
+      update_late_statistics(device);
 
-            relabsd_virtual_device_set_has_already_timed_out
-            (
-               0,
-               &(server->virtual_device)
-            );
-            return return_code;
+      relabsd_server_enter_conversion_stage
+      (
+         RELABSD_SERVER_PUBLISHING_STAGE,
+         device
+      );
 
-         case 0:
-            (void) relabsd_virtual_device_write_evdev_event
-            (
-               &(server->virtual_device),
-               input_type,
-               input_code,
-               value
-            );
-            return return_code;
+      relabsd_server_publish_axes_state(device);
+
+      if (device->shared_state != (struct relabsd_shared_device_state *) NULL)
+      {
+         relabsd_server_write_shared_state(device);
       }
    }
    else
    {
-      /* Any other event is retransmitted as is. */
-      (void) relabsd_virtual_device_write_evdev_event
+      relabsd_server_enter_conversion_stage
       (
-         &(server->virtual_device),
-         input_type,
-         input_code,
-         value
+         RELABSD_SERVER_CONVERTING_STAGE,
+         device
       );
+
+      relabsd_server_convert_event(device, input_type, input_code, value);
    }
 
    return return_code;
@@ -135,162 +260,796 @@ static int convert_input
 
 static void reset_axes
 (
-   struct relabsd_server server [const restrict static 1]
+   struct relabsd_server_device device [const restrict static 1]
 )
 {
+   int i;
+
+   relabsd_server_enter_conversion_stage
+   (
+      RELABSD_SERVER_RESETTING_STAGE,
+      device
+   );
+
+   RELABSD_PROBE1
+   (
+      reset_axes,
+      relabsd_parameters_get_physical_device_file_name(&(device->parameters))
+   );
+
+   RELABSD_COUNTER_ADD
+   (
+      device->statistics.counters + RELABSD_SERVER_TIMEOUTS,
+      1
+   );
+
    relabsd_virtual_device_set_has_already_timed_out
    (
       1,
-      &(server->virtual_device)
+      &(device->virtual_device)
    );
 
    relabsd_virtual_device_set_axes_to_zero
    (
-      &(server->parameters),
-      &(server->virtual_device)
+      &(device->parameters),
+      &(device->virtual_device)
    );
+
+   /* The axes reset above, which clients would otherwise see unchanged. */
+   for (i = 0; i < RELABSD_AXIS_VALID_AXES_COUNT; ++i)
+   {
+      struct relabsd_axis * axis;
+
+      axis =
+         relabsd_parameters_get_axis
+         (
+            (enum relabsd_axis_name) i,
+            &(device->parameters)
+         );
+
+      if
+      (
+         !relabsd_axis_has_flag(axis, RELABSD_NOT_ABS)
+         && relabsd_axis_is_enabled(axis)
+      )
+      {
+         device->axes_state.values[i] = 0;
+      }
+   }
+
+   relabsd_server_publish_axes_state(device);
+
+   if (device->shared_state != (struct relabsd_shared_device_state *) NULL)
+   {
+      relabsd_server_write_shared_state(device);
+   }
 }
 
-static int wait_for_next_event
+/*
+ * (Re)starts the countdown to the axes' reset, if the current parameters ask
+ * for it. The countdown is restarted following each batch of inputs, so the
+ * axes are reset once the physical device has been idle for the duration of
+ * the timeout.
+ * Restarting the countdown also discards any expiration that has not been read
+ * yet.
+ */
+static void update_timeout_timer
 (
-   fd_set ready_to_read [const restrict static 1],
-   struct relabsd_server server [const static 1]
+   struct relabsd_server_device device [const static 1]
 )
 {
-   int ready_fds, physical_device_fd, interruption_fd, highest_fd;
+   struct itimerspec timer_value;
 
-   FD_ZERO(ready_to_read);
+   (void) memset((void *) &timer_value, 0, sizeof(struct itimerspec));
 
-   physical_device_fd =
-      relabsd_physical_device_get_file_descriptor(&(server->physical_device));
+   if
+   (
+      relabsd_parameters_use_timeout(&(device->parameters))
+      &&
+      !relabsd_virtual_device_has_already_timed_out(&(device->virtual_device))
+   )
+   {
+      timer_value.it_value =
+         relabsd_parameters_get_timeout(&(device->parameters));
+   }
+   else if (!device->timer_is_armed)
+   {
+      /* Nothing to disarm. */
+      return;
+   }
+
+   relabsd_server_enter_conversion_stage(RELABSD_SERVER_TIMER_STAGE, device);
 
-   FD_SET(physical_device_fd, ready_to_read);
+   errno = 0;
 
-   if (relabsd_physical_device_is_late(&(server->physical_device)))
+   if
+   (
+      timerfd_settime
+      (
+         device->timer,
+         0,
+         &timer_value,
+         (struct itimerspec *) NULL
+      )
+      == -1
+   )
    {
-      return 1;
+      RELABSD_ERROR
+      (
+         "Unable to set the timer for the axes' reset: %s.",
+         strerror(errno)
+      );
+
+      return;
    }
 
-   interruption_fd = relabsd_server_get_interruption_file_descriptor();
+   device->timer_is_armed =
+      (
+         (timer_value.it_value.tv_sec != 0)
+         || (timer_value.it_value.tv_nsec != 0)
+      );
+}
+
+/*
+ * Applies the parameters published by clients, if any, as long as it is done
+ * at a frame boundary.
+ */
+static void update_parameters
+(
+   struct relabsd_server_device device [const static 1]
+)
+{
+   if
+   (
+      !relabsd_virtual_device_is_at_frame_boundary(&(device->virtual_device))
+   )
+   {
+      return;
+   }
 
-   FD_SET(interruption_fd, ready_to_read);
+   relabsd_server_enter_conversion_stage
+   (
+      RELABSD_SERVER_PARAMETERS_STAGE,
+      device
+   );
 
-   if (interruption_fd > physical_device_fd)
+   if (relabsd_server_update_device_parameters(device))
    {
-      highest_fd = interruption_fd;
+      update_timeout_timer(device);
    }
-   else
+}
+
+static int register_source
+(
+   const int epoll,
+   const int operation,
+   const uint32_t events,
+   struct relabsd_server_event_source source [const static 1]
+)
+{
+   struct epoll_event event;
+
+   (void) memset((void *) &event, 0, sizeof(struct epoll_event));
+
+   event.events = events;
+   event.data.ptr = (void *) source;
+
+   errno = 0;
+
+   if (epoll_ctl(epoll, operation, source->file, &event) == -1)
    {
-      highest_fd = physical_device_fd;
+      RELABSD_ERROR
+      (
+         "Unable to register a file descriptor to a conversion epoll: %s.",
+         strerror(errno)
+      );
+
+      return -1;
    }
 
+   return 0;
+}
+
+static void initialize_source
+(
+   const enum relabsd_server_event_source_type type,
+   const int file,
+   struct relabsd_server_device device [const],
+   struct relabsd_server_event_source source [const restrict static 1]
+)
+{
+   source->type = type;
+   source->file = file;
+   source->device = device;
+}
+
+/*
+ * Only stops reading the device, which can still be queried and configured by
+ * clients. The server stops once no device has any input left.
+ */
+static void stop_reading_ended_input
+(
+   struct relabsd_server_device device [const static 1],
+   struct relabsd_server server [const static 1]
+)
+{
    errno = 0;
 
    if
    (
-      relabsd_parameters_use_timeout(&(server->parameters))
-      &&
-      !relabsd_virtual_device_has_already_timed_out(&(server->virtual_device))
+      epoll_ctl
+      (
+         ((device->epoll == -1) ? server->conversion_epoll : device->epoll),
+         EPOLL_CTL_DEL,
+         device->input_source.file,
+         (struct epoll_event *) NULL
+      )
+      == -1
    )
    {
-      struct timeval curr_timeout;
+      RELABSD_ERROR
+      (
+         "Unable to unregister an input from a conversion epoll: %s.",
+         strerror(errno)
+      );
+   }
 
-      pthread_mutex_lock(&(server->mutex));
-      /* call to select may alter timeout */
-      curr_timeout = relabsd_parameters_get_timeout(&(server->parameters));
-      pthread_mutex_unlock(&(server->mutex));
+   RELABSD_WARNING
+   (
+      "Input \"%s\" has reached its end, it is no longer converted.",
+      relabsd_parameters_get_physical_device_file_name(&(device->parameters))
+   );
 
-      ready_fds =
-         select
-         (
-            (highest_fd + 1),
-            ready_to_read,
-            (fd_set *) NULL,
-            (fd_set *) NULL,
-            (struct timeval *) &curr_timeout
-         );
+   if
+   (
+      (atomic_fetch_add(&(server->ended_devices_count), 1) + 1)
+      == server->devices_count
+   )
+   {
+      RELABSD_S_WARNING("No device has any input left, stopping the server.");
+
+      relabsd_server_interrupt();
    }
-   else
+}
+
+static void handle_physical_device_input
+(
+   struct relabsd_server_device device [const static 1],
+   struct relabsd_server server [const static 1]
+)
+{
+   int has_more_to_read;
+
+   relabsd_server_start_stall_monitoring
+   (
+      RELABSD_SERVER_PARAMETERS_STAGE,
+      device
+   );
+
+   do
    {
-      ready_fds =
-         select
-         (
-            (highest_fd + 1),
-            ready_to_read,
-            (fd_set *) NULL,
-            (fd_set *) NULL,
-            (struct timeval *) NULL
-         );
+      update_parameters(device);
+
+      /* convert all events in the libevdev buffer. */
+      has_more_to_read = (convert_input(device) > 0);
+   }
+   while (has_more_to_read && relabsd_server_keep_running());
+
+   update_parameters(device);
+   update_timeout_timer(device);
+
+   if (relabsd_physical_device_has_reached_end(&(device->physical_device)))
+   {
+      stop_reading_ended_input(device, server);
+   }
+
+   relabsd_server_stop_stall_monitoring(device);
+}
+
+static void handle_timeout
+(
+   struct relabsd_server_device device [const static 1]
+)
+{
+   uint64_t expirations;
+
+   relabsd_server_start_stall_monitoring(RELABSD_SERVER_TIMER_STAGE, device);
+
+   /*
+    * Fails with EAGAIN if the countdown was restarted since the timer was
+    * reported as expired, in which case the timeout is obsolete.
+    */
+   if
+   (
+      read(device->timer, (void *) &expirations, sizeof(uint64_t))
+      != ((ssize_t) sizeof(uint64_t))
+   )
+   {
+      relabsd_server_stop_stall_monitoring(device);
+
+      return;
+   }
+
+   device->timer_is_armed = 0;
+
+   update_parameters(device);
+
+   if (relabsd_parameters_use_timeout(&(device->parameters)))
+   {
+      reset_axes(device);
+   }
+
+   relabsd_server_stop_stall_monitoring(device);
+}
+
+/* Clients published parameters, which the device may have no input to apply. */
+static void handle_parameters
+(
+   struct relabsd_server_device device [const static 1]
+)
+{
+   uint64_t wakeups;
+
+   relabsd_server_start_stall_monitoring
+   (
+      RELABSD_SERVER_PARAMETERS_STAGE,
+      device
+   );
+
+   /* Only resets the counter, the parameters tell what needs to be done. */
+   (void) read(device->wakeup, (void *) &wakeups, sizeof(uint64_t));
+
+   update_parameters(device);
+
+   relabsd_server_stop_stall_monitoring(device);
+}
+
+static void handle_sources
+(
+   const int ready_fds,
+   const struct epoll_event events [const static ready_fds],
+   struct relabsd_server server [const static 1]
+)
+{
+   struct relabsd_server_event_source * source;
+   int i;
+
+   /*
+    * Inputs are handled before timeouts, as they make timeouts of the same
+    * device obsolete.
+    */
+   for (i = 0; i < ready_fds; ++i)
+   {
+      source = (struct relabsd_server_event_source *) events[i].data.ptr;
+
+      switch (source->type)
+      {
+         case RELABSD_SERVER_PHYSICAL_DEVICE_SOURCE:
+            handle_physical_device_input(source->device, server);
+            break;
+
+         case RELABSD_SERVER_PARAMETERS_SOURCE:
+            handle_parameters(source->device);
+            break;
+
+         case RELABSD_SERVER_SIGNAL_SOURCE:
+            relabsd_server_handle_signals();
+            break;
+
+         default:
+            break;
+      }
    }
 
-   if (ready_fds == -1)
+   for (i = 0; i < ready_fds; ++i)
+   {
+      source = (struct relabsd_server_event_source *) events[i].data.ptr;
+
+      if (source->type == RELABSD_SERVER_TIMEOUT_SOURCE)
+      {
+         handle_timeout(source->device);
+      }
+   }
+}
+
+/*
+ * With multiple conversion threads, each device gets its own epoll, which is
+ * registered as a one-shot source of the shared one. Thus, a device is only
+ * ever handled by a single thread at a time, without needing any lock.
+ */
+static void handle_device
+(
+   struct relabsd_server_device device [const static 1],
+   struct relabsd_server server [const static 1]
+)
+{
+   struct epoll_event events[3];
+   int ready_fds;
+
+   errno = 0;
+
+   ready_fds = epoll_wait(device->epoll, events, 3, 0);
+
+   if (ready_fds > 0)
+   {
+      handle_sources(ready_fds, events, server);
+   }
+   else if ((ready_fds == -1) && (errno != EINTR))
    {
       RELABSD_ERROR
       (
-         "Error while waiting for new input from the physical device: %s.",
+         "Error while checking the device's pending inputs: %s.",
+         strerror(errno)
+      );
+   }
+
+   (void) register_source
+   (
+      server->conversion_epoll,
+      EPOLL_CTL_MOD,
+      (EPOLLIN | EPOLLONESHOT),
+      &(device->device_source)
+   );
+}
+
+static int initialize_device
+(
+   struct relabsd_server_device device [const static 1],
+   struct relabsd_server server [const static 1]
+)
+{
+   int sources_epoll;
+
+   errno = 0;
+
+   device->timer =
+      timerfd_create(CLOCK_MONOTONIC, (TFD_CLOEXEC | TFD_NONBLOCK));
+
+   device->timer_is_armed = 0;
+   device->epoll = -1;
+   device->wakeup = -1;
+
+   relabsd_server_initialize_stall_monitor
+   (
+      (long int) relabsd_parameters_get_stall_budget(&(server->parameters)),
+      device
+   );
+
+   if (device->timer == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to create the timer for the axes' reset: %s.",
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   errno = 0;
+
+   device->wakeup = eventfd(0, (EFD_CLOEXEC | EFD_NONBLOCK));
+
+   if (device->wakeup == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to create the eventfd for the device's parameters: %s.",
          strerror(errno)
       );
 
-      FD_ZERO(ready_to_read);
+      (void) close(device->timer);
 
-      return 1;
+      return -1;
    }
 
-   /* ready_fds == 0 on timeout */
-   return ready_fds;
+   initialize_source
+   (
+      RELABSD_SERVER_PHYSICAL_DEVICE_SOURCE,
+      relabsd_physical_device_get_file_descriptor(&(device->physical_device)),
+      device,
+      &(device->input_source)
+   );
+
+   initialize_source
+   (
+      RELABSD_SERVER_TIMEOUT_SOURCE,
+      device->timer,
+      device,
+      &(device->timeout_source)
+   );
+
+   initialize_source
+   (
+      RELABSD_SERVER_PARAMETERS_SOURCE,
+      device->wakeup,
+      device,
+      &(device->parameters_source)
+   );
+
+   if (server->conversion_thread_count > 1)
+   {
+      errno = 0;
+
+      device->epoll = epoll_create1(EPOLL_CLOEXEC);
+
+      if (device->epoll == -1)
+      {
+         RELABSD_FATAL
+         (
+            "Unable to create the device's epoll: %s.",
+            strerror(errno)
+         );
+
+         (void) close(device->wakeup);
+         (void) close(device->timer);
+
+         return -1;
+      }
+
+      initialize_source
+      (
+         RELABSD_SERVER_DEVICE_SOURCE,
+         device->epoll,
+         device,
+         &(device->device_source)
+      );
+
+      if
+      (
+         register_source
+         (
+            server->conversion_epoll,
+            EPOLL_CTL_ADD,
+            (EPOLLIN | EPOLLONESHOT),
+            &(device->device_source)
+         )
+         < 0
+      )
+      {
+         (void) close(device->epoll);
+         (void) close(device->wakeup);
+         (void) close(device->timer);
+
+         return -1;
+      }
+
+      sources_epoll = device->epoll;
+   }
+   else
+   {
+      sources_epoll = server->conversion_epoll;
+   }
+
+   if
+   (
+      (
+         register_source
+         (
+            sources_epoll,
+            EPOLL_CTL_ADD,
+            EPOLLIN,
+            &(device->input_source)
+         )
+         < 0
+      )
+      ||
+      (
+         register_source
+         (
+            sources_epoll,
+            EPOLL_CTL_ADD,
+            EPOLLIN,
+            &(device->timeout_source)
+         )
+         < 0
+      )
+      ||
+      (
+         register_source
+         (
+            sources_epoll,
+            EPOLL_CTL_ADD,
+            EPOLLIN,
+            &(device->parameters_source)
+         )
+         < 0
+      )
+   )
+   {
+      if (device->epoll != -1)
+      {
+         (void) close(device->epoll);
+      }
+
+      (void) close(device->wakeup);
+      (void) close(device->timer);
+
+      return -1;
+   }
+
+   update_timeout_timer(device);
+
+   return 0;
+}
+
+static void finalize_device
+(
+   struct relabsd_server_device device [const static 1]
+)
+{
+   if (device->epoll != -1)
+   {
+      (void) close(device->epoll);
+   }
+
+   (void) close(device->wakeup);
+   (void) close(device->timer);
 }
 
 /******************************************************************************/
 /**** EXPORTED FUNCTIONS ******************************************************/
 /******************************************************************************/
+int relabsd_server_initialize_conversion
+(
+   struct relabsd_server server [const static 1]
+)
+{
+   int i;
+
+   errno = 0;
+
+   server->conversion_epoll = epoll_create1(EPOLL_CLOEXEC);
+
+   if (server->conversion_epoll == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to create the conversion loop's epoll: %s.",
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   atomic_init(&(server->ended_devices_count), 0);
+
+   initialize_source
+   (
+      RELABSD_SERVER_SIGNAL_SOURCE,
+      relabsd_server_get_signal_file_descriptor(),
+      (struct relabsd_server_device *) NULL,
+      &(server->signal_source)
+   );
+
+   initialize_source
+   (
+      RELABSD_SERVER_INTERRUPTION_SOURCE,
+      relabsd_server_get_interruption_file_descriptor(),
+      (struct relabsd_server_device *) NULL,
+      &(server->interruption_source)
+   );
+
+   if
+   (
+      (
+         register_source
+         (
+            server->conversion_epoll,
+            EPOLL_CTL_ADD,
+            EPOLLIN,
+            &(server->signal_source)
+         )
+         < 0
+      )
+      ||
+      (
+         register_source
+         (
+            server->conversion_epoll,
+            EPOLL_CTL_ADD,
+            EPOLLIN,
+            &(server->interruption_source)
+         )
+         < 0
+      )
+   )
+   {
+      (void) close(server->conversion_epoll);
+
+      return -1;
+   }
+
+   for (i = 0; i < server->devices_count; ++i)
+   {
+      if (initialize_device((server->devices + i), server) < 0)
+      {
+         for (--i; i >= 0; --i)
+         {
+            finalize_device(server->devices + i);
+         }
+
+         (void) close(server->conversion_epoll);
+
+         return -1;
+      }
+   }
+
+   return 0;
+}
+
+void relabsd_server_finalize_conversion
+(
+   struct relabsd_server server [const static 1]
+)
+{
+   int i;
+
+   for (i = 0; i < server->devices_count; ++i)
+   {
+      finalize_device(server->devices + i);
+   }
+
+   (void) close(server->conversion_epoll);
+}
+
 int relabsd_server_conversion_loop
 (
    struct relabsd_server server [const static 1]
 )
 {
-   int has_more_to_read;
-   fd_set ready_to_read;
+   struct epoll_event events[RELABSD_SERVER_CONVERSION_EPOLL_EVENTS];
+   struct relabsd_server_event_source * source;
+   int ready_fds, i;
 
    for (;;)
    {
-      switch (wait_for_next_event(&ready_to_read, server))
-      {
-         case 1:
-         case 2:
-            if (!relabsd_server_keep_running())
-            {
-               return 0;
-            }
+      errno = 0;
 
-            if
+      ready_fds =
+         epoll_wait
+         (
+            server->conversion_epoll,
+            events,
+            RELABSD_SERVER_CONVERSION_EPOLL_EVENTS,
+            -1
+         );
+
+      if (ready_fds == -1)
+      {
+         if (errno != EINTR)
+         {
+            RELABSD_ERROR
             (
-               FD_ISSET
-               (
-                  relabsd_physical_device_get_file_descriptor
-                  (
-                     &(server->physical_device)
-                  ),
-                  &ready_to_read
-               )
-            )
+               "Error while waiting for new input from the physical devices:"
+               " %s.",
+               strerror(errno)
+            );
+
+            /* Such errors would just keep happening. */
+            relabsd_server_interrupt();
+
+            return -1;
+         }
+      }
+      else
+      {
+         for (i = 0; i < ready_fds; ++i)
+         {
+            source = (struct relabsd_server_event_source *) events[i].data.ptr;
+
+            if (source->type == RELABSD_SERVER_DEVICE_SOURCE)
             {
-               do
-               {
-                  pthread_mutex_lock(&(server->mutex));
-                  /* convert all events in the libevdev buffer. */
-                  has_more_to_read = (convert_input(server) > 0);
-                  pthread_mutex_unlock(&(server->mutex));
-               }
-               while (has_more_to_read && relabsd_server_keep_running());
+               handle_device(source->device, server);
             }
+         }
 
-            break;
+         handle_sources(ready_fds, events, server);
+      }
 
-         case 0:
-            pthread_mutex_lock(&(server->mutex));
-            reset_axes(server);
-            pthread_mutex_unlock(&(server->mutex));
-            break;
+      if (!relabsd_server_keep_running())
+      {
+         return 0;
       }
    }
 }
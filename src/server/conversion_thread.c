@@ -0,0 +1,117 @@
+/**** POSIX *******************************************************************/
+#include <pthread.h>
+#include <string.h>
+
+/**** RELABSD *****************************************************************/
+#include <relabsd/debug.h>
+#include <relabsd/server.h>
+
+/******************************************************************************/
+/**** LOCAL FUNCTIONS *********************************************************/
+/******************************************************************************/
+static void * posix_main_loop (void * params)
+{
+   (void) relabsd_server_conversion_loop((struct relabsd_server *) params);
+
+   return NULL;
+}
+
+/******************************************************************************/
+/**** EXPORTED FUNCTIONS ******************************************************/
+/******************************************************************************/
+/*
+ * The thread running 'relabsd_server_main' is the first conversion thread, so
+ * only (conversion_thread_count - 1) threads are created here. It is given
+ * the conversion threads' scheduling here too, so the threads it created
+ * before (e.g. the communication thread) keep the default one.
+ */
+int relabsd_server_create_conversion_threads
+(
+   struct relabsd_server server [const static 1]
+)
+{
+   int i, err;
+
+   if
+   (
+      relabsd_server_set_conversion_thread_scheduling(server, pthread_self())
+      < 0
+   )
+   {
+      server->conversion_thread_count = 1;
+
+      return -1;
+   }
+
+   for (i = 1; i < server->conversion_thread_count; ++i)
+   {
+      err =
+         pthread_create
+         (
+            (server->conversion_threads + i),
+            (const pthread_attr_t *) NULL,
+            posix_main_loop,
+            (void *) server
+         );
+
+      if (err != 0)
+      {
+         RELABSD_FATAL
+         (
+            "Unable to create conversion thread #%d: %s",
+            i,
+            strerror(err)
+         );
+
+         server->conversion_thread_count = i;
+
+         return -1;
+      }
+
+      if
+      (
+         relabsd_server_set_conversion_thread_scheduling
+         (
+            server,
+            server->conversion_threads[i]
+         )
+         < 0
+      )
+      {
+         server->conversion_thread_count = (i + 1);
+
+         return -1;
+      }
+   }
+
+   return 0;
+}
+
+int relabsd_server_join_conversion_threads
+(
+   struct relabsd_server server [const static 1]
+)
+{
+   int i, err, result;
+
+   result = 0;
+
+   for (i = 1; i < server->conversion_thread_count; ++i)
+   {
+      err = pthread_join(server->conversion_threads[i], (void **) NULL);
+
+      if (err != 0)
+      {
+         RELABSD_FATAL
+         (
+            "Unable to join with conversion thread #%d: %s",
+            i,
+            strerror(err)
+         );
+
+         result = -1;
+      }
+   }
+
+   return result;
+}
@@ -0,0 +1,141 @@
+/**** POSIX *******************************************************************/
+#include <stdatomic.h>
+
+/**** LIBEVDEV ****************************************************************/
+#include <libevdev/libevdev.h>
+
+/**** RELABSD *****************************************************************/
+#include <relabsd/server.h>
+
+#include <relabsd/device/axis.h>
+#include <relabsd/device/virtual_device.h>
+
+#include <relabsd/util/counter.h>
+#include <relabsd/util/probe.h>
+
+/******************************************************************************/
+/**** LOCAL FUNCTIONS *********************************************************/
+/******************************************************************************/
+static void send_event
+(
+   struct relabsd_server_device device [const restrict static 1],
+   const unsigned int type,
+   const unsigned int code,
+   const int value
+)
+{
+   atomic_ulong * const counters = device->statistics.counters;
+
+   RELABSD_COUNTER_ADD(counters + RELABSD_SERVER_EVENTS_SENT, 1);
+
+   /* Only fails when writing a frame (normally upon EV_SYN/SYN_REPORT). */
+   if
+   (
+      relabsd_virtual_device_write_evdev_event
+      (
+         &(device->virtual_device),
+         type,
+         code,
+         value
+      )
+      < 0
+   )
+   {
+      RELABSD_COUNTER_ADD(counters + RELABSD_SERVER_WRITE_ERRORS, 1);
+   }
+}
+
+/******************************************************************************/
+/**** EXPORTED FUNCTIONS ******************************************************/
+/******************************************************************************/
+void relabsd_server_convert_event
+(
+   struct relabsd_server_device device [const restrict static 1],
+   const unsigned int input_type,
+   const unsigned int input_code,
+   int value
+)
+{
+   const struct relabsd_axis_conversion * conversion;
+   struct relabsd_server_axes_state * axes_state;
+   atomic_ulong * axis_statistics;
+   int filter_result;
+   int axis_index;
+
+   if (input_type != EV_REL)
+   {
+      /* Any other event is retransmitted as is. */
+      send_event(device, input_type, input_code, value);
+
+      return;
+   }
+
+   if (input_code >= REL_CNT)
+   {
+      return;
+   }
+
+   conversion = (device->conversions + input_code);
+
+   if (conversion->axis == ((struct relabsd_axis *) NULL))
+   {
+      return;
+   }
+
+   /* For subscribed clients. The conversion table uses 'device->parameters'. */
+   axis_index = (int) (conversion->axis - device->parameters.axes);
+   axes_state = &(device->axes_state);
+   axis_statistics = device->statistics.axes[axis_index];
+
+   RELABSD_COUNTER_ADD(axis_statistics + RELABSD_AXIS_RECEIVED, 1);
+
+   axes_state->inputs[axis_index] = value;
+
+   if (conversion->filter == NULL)
+   {
+      filter_result = 1;
+   }
+   else
+   {
+      filter_result =
+         conversion->filter(conversion->axis, &value, axis_statistics);
+   }
+
+   RELABSD_PROBE4
+   (
+      axis_filter,
+      input_code,
+      axes_state->inputs[axis_index],
+      value,
+      filter_result
+   );
+
+   switch (filter_result)
+   {
+      case -1:
+         /* Doesn't want the event to be transmitted. */
+         return;
+
+      case 1:
+         axes_state->values[axis_index] = value;
+
+         RELABSD_COUNTER_ADD(axis_statistics + RELABSD_AXIS_SENT, 1);
+
+         send_event(device, conversion->type, conversion->code, value);
+
+         relabsd_virtual_device_set_has_already_timed_out
+         (
+            0,
+            &(device->virtual_device)
+         );
+         return;
+
+      case 0:
+         axes_state->values[axis_index] = value;
+
+         RELABSD_COUNTER_ADD(axis_statistics + RELABSD_AXIS_SENT, 1);
+
+         send_event(device, input_type, input_code, value);
+         return;
+   }
+}
@@ -0,0 +1,457 @@
+/**** POSIX *******************************************************************/
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+/**** RELABSD *****************************************************************/
+#include <relabsd/debug.h>
+#include <relabsd/server.h>
+
+#include <relabsd/config/parameters.h>
+
+#include <relabsd/device/axis.h>
+#include <relabsd/device/physical_device.h>
+#include <relabsd/device/virtual_device.h>
+
+#include <relabsd/util/counter.h>
+#include <relabsd/util/probe.h>
+
+/******************************************************************************/
+/**** LOCAL FUNCTIONS *********************************************************/
+/******************************************************************************/
+static void propagate_changes
+(
+   struct relabsd_server_device device [const static 1]
+)
+{
+   struct relabsd_axis * axis;
+   int i;
+   int virtual_device_is_dirty;
+
+   virtual_device_is_dirty = 0;
+
+   for (i = 0; i < RELABSD_AXIS_VALID_AXES_COUNT; ++i)
+   {
+      axis =
+         relabsd_parameters_get_axis
+         (
+            (enum relabsd_axis_name) i,
+            &(device->parameters)
+         );
+
+      if (relabsd_axis_attributes_are_dirty(axis))
+      {
+         /* Consumers would lose the device if it were recreated. */
+         if
+         (
+            relabsd_virtual_device_change_axis_absinfo
+            (
+               (enum relabsd_axis_name) i,
+               axis,
+               &(device->virtual_device)
+            )
+            != 0
+         )
+         {
+            virtual_device_is_dirty = 1;
+         }
+
+         relabsd_axis_set_attributes_are_dirty(0, axis);
+         relabsd_axis_set_attributes_are_dirty
+         (
+            0,
+            relabsd_parameters_get_axis
+            (
+               (enum relabsd_axis_name) i,
+               &(device->pending_parameters)
+            )
+         );
+      }
+   }
+
+   if (relabsd_parameters_device_name_is_dirty(&(device->parameters)))
+   {
+      (void) relabsd_virtual_device_rename
+      (
+         &(device->parameters),
+         &(device->virtual_device)
+      );
+
+      /* Both copies share the name, which is freed here. */
+      relabsd_parameters_clean_device_name(&(device->pending_parameters));
+
+      device->parameters.device_name = device->pending_parameters.device_name;
+      device->parameters.device_name_was_modified = 0;
+
+      virtual_device_is_dirty = 1;
+   }
+
+   if (virtual_device_is_dirty)
+   {
+      (void) relabsd_virtual_device_recreate(&(device->virtual_device));
+
+      RELABSD_COUNTER_ADD
+      (
+         device->statistics.counters
+         + RELABSD_SERVER_VIRTUAL_DEVICE_RECREATIONS,
+         1
+      );
+   }
+}
+
+static long int get_elapsed_microseconds
+(
+   const struct timespec start [const restrict static 1]
+)
+{
+   struct timespec now;
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &now);
+
+   return
+      (
+         ((long int) (now.tv_sec - start->tv_sec)) * 1000000L
+         + ((long int) (now.tv_nsec - start->tv_nsec)) / 1000L
+      );
+}
+
+/*
+ * Switches to the virtual device prepared by the client. The current one is
+ * only destroyed once the new one is in use, so that its consumers always have
+ * a device to read from.
+ */
+static void replace_virtual_device
+(
+   struct relabsd_server_device device [const static 1]
+)
+{
+   struct timespec start;
+   int i;
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &start);
+
+   /* The replacement was created from all of these changes. */
+   for (i = 0; i < RELABSD_AXIS_VALID_AXES_COUNT; ++i)
+   {
+      relabsd_axis_set_attributes_are_dirty
+      (
+         0,
+         relabsd_parameters_get_axis
+         (
+            (enum relabsd_axis_name) i,
+            &(device->parameters)
+         )
+      );
+      relabsd_axis_set_attributes_are_dirty
+      (
+         0,
+         relabsd_parameters_get_axis
+         (
+            (enum relabsd_axis_name) i,
+            &(device->pending_parameters)
+         )
+      );
+   }
+
+   relabsd_parameters_clean_axes_capabilities(&(device->parameters));
+   relabsd_parameters_clean_axes_capabilities(&(device->pending_parameters));
+
+   /* Both copies share the name, which is freed here. */
+   relabsd_parameters_clean_device_name(&(device->pending_parameters));
+
+   device->parameters.device_name = device->pending_parameters.device_name;
+   device->parameters.device_name_was_modified = 0;
+
+   relabsd_virtual_device_restore_axes
+   (
+      &(device->parameters),
+      &(device->replacement_virtual_device)
+   );
+
+   relabsd_virtual_device_replace
+   (
+      &(device->virtual_device),
+      &(device->replacement_virtual_device)
+   );
+
+   device->has_replacement_virtual_device = 0;
+
+   RELABSD_COUNTER_ADD
+   (
+      device->statistics.counters + RELABSD_SERVER_VIRTUAL_DEVICE_RECREATIONS,
+      1
+   );
+
+   RELABSD_INFO
+   (
+      "Replaced the virtual device of \"%s\": created in %ld microseconds,"
+      " switched to in %ld microseconds.",
+      relabsd_parameters_get_physical_device_file_name(&(device->parameters)),
+      device->replacement_virtual_device_creation_time,
+      get_elapsed_microseconds(&start)
+   );
+}
+
+/*
+ * Copies the pending parameters into the ones used for the conversion. Axes
+ * whose configuration did not change keep their state.
+ */
+static void copy_pending_parameters
+(
+   struct relabsd_server_device device [const static 1]
+)
+{
+   struct relabsd_parameters previous_parameters;
+   struct relabsd_axis * axis;
+   const struct relabsd_axis * previous_axis;
+   int i;
+
+   previous_parameters = device->parameters;
+   device->parameters = device->pending_parameters;
+
+   for (i = 0; i < RELABSD_AXIS_VALID_AXES_COUNT; ++i)
+   {
+      axis =
+         relabsd_parameters_get_axis
+         (
+            (enum relabsd_axis_name) i,
+            &(device->parameters)
+         );
+
+      previous_axis =
+         relabsd_parameters_get_axis
+         (
+            (enum relabsd_axis_name) i,
+            &previous_parameters
+         );
+
+      if (relabsd_axis_has_same_configuration(axis, previous_axis))
+      {
+         axis->previous_value = previous_axis->previous_value;
+      }
+      else
+      {
+         axis->previous_value = 0;
+      }
+   }
+}
+
+/******************************************************************************/
+/**** EXPORTED FUNCTIONS ******************************************************/
+/******************************************************************************/
+void relabsd_server_publish_device_parameters
+(
+   struct relabsd_server_device device [const static 1]
+)
+{
+   unsigned int generation;
+
+   /* Only one thread can hold 'mutex', so this does not need to be atomic. */
+   generation =
+      (
+         atomic_load_explicit
+         (
+            &(device->parameters_generation),
+            memory_order_relaxed
+         )
+         + 1
+      );
+
+   atomic_store_explicit
+   (
+      &(device->parameters_generation),
+      generation,
+      memory_order_release
+   );
+
+   /* The device may not have any input to wake its conversion thread up. */
+   atomic_store_explicit(&(device->wakeup_is_needed), 1, memory_order_relaxed);
+
+   RELABSD_PROBE2
+   (
+      parameters_commit,
+      relabsd_parameters_get_physical_device_file_name
+      (
+         &(device->pending_parameters)
+      ),
+      generation
+   );
+}
+
+void relabsd_server_wake_up_device
+(
+   struct relabsd_server_device device [const static 1]
+)
+{
+   const uint64_t increment = 1;
+
+   if (!atomic_exchange(&(device->wakeup_is_needed), 0))
+   {
+      return;
+   }
+
+   /* Can only fail if the counter overflows, which still wakes it up. */
+   (void) write(device->wakeup, (const void *) &increment, sizeof(uint64_t));
+}
+
+int relabsd_server_update_device_parameters
+(
+   struct relabsd_server_device device [const static 1]
+)
+{
+   struct timespec lock_time;
+   unsigned int generation;
+
+   generation =
+      atomic_load_explicit
+      (
+         &(device->parameters_generation),
+         memory_order_acquire
+      );
+
+   if (generation == device->applied_parameters_generation)
+   {
+      return 0;
+   }
+
+   /*
+    * Set beforehand, so that a client holding the mutex sees it once it has
+    * released it. Only cleared while holding the mutex.
+    */
+   atomic_store(&(device->wakeup_is_needed), 1);
+
+   /*
+    * A client is still working on the parameters. The conversion carries on
+    * with the current ones and tries again at the next frame boundary, or once
+    * woken up by the client.
+    */
+   if (pthread_mutex_trylock(&(device->mutex)) != 0)
+   {
+      return 0;
+   }
+
+   atomic_store_explicit(&(device->wakeup_is_needed), 0, memory_order_relaxed);
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &lock_time);
+
+   generation =
+      atomic_load_explicit
+      (
+         &(device->parameters_generation),
+         memory_order_relaxed
+      );
+
+   copy_pending_parameters(device);
+
+   if (device->has_replacement_virtual_device)
+   {
+      replace_virtual_device(device);
+   }
+   else
+   {
+      propagate_changes(device);
+   }
+
+   relabsd_server_update_conversion_table(device);
+
+   device->applied_parameters_generation = generation;
+
+   relabsd_server_record_mutex_hold(device, &lock_time);
+
+   pthread_mutex_unlock(&(device->mutex));
+
+   RELABSD_S_DEBUG(RELABSD_DEBUG_CONFIG, "Applied new device parameters.");
+
+   return 1;
+}
+
+void relabsd_server_prepare_virtual_device_replacement
+(
+   struct relabsd_server_device device [const static 1]
+)
+{
+   struct timespec start;
+
+   if
+   (
+      !relabsd_parameters_device_name_is_dirty(&(device->pending_parameters))
+      && !relabsd_parameters_axes_capabilities_are_dirty
+      (
+         &(device->pending_parameters)
+      )
+   )
+   {
+      return;
+   }
+
+   /* Made obsolete by the latest changes. */
+   if (device->has_replacement_virtual_device)
+   {
+      relabsd_virtual_device_destroy(&(device->replacement_virtual_device));
+
+      device->has_replacement_virtual_device = 0;
+   }
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &start);
+
+   if
+   (
+      relabsd_virtual_device_create_replacement
+      (
+         &(device->pending_parameters),
+         &(device->virtual_device),
+         &(device->replacement_virtual_device)
+      )
+      < 0
+   )
+   {
+      RELABSD_S_ERROR
+      (
+         "Could not create a new virtual device, the current one is kept."
+      );
+
+      return;
+   }
+
+   device->replacement_virtual_device_creation_time =
+      get_elapsed_microseconds(&start);
+   device->has_replacement_virtual_device = 1;
+}
+
+void relabsd_server_update_conversion_table
+(
+   struct relabsd_server_device device [const static 1]
+)
+{
+   enum relabsd_axis_name axis_name;
+   struct relabsd_axis * axis;
+   unsigned int i;
+
+   for (i = 0; i < REL_CNT; ++i)
+   {
+      axis_name = relabsd_axis_name_from_evdev_rel(i);
+
+      axis =
+         (
+            (axis_name == RELABSD_UNKNOWN) ?
+            (struct relabsd_axis *) NULL
+            : relabsd_parameters_get_axis(axis_name, &(device->parameters))
+         );
+
+      relabsd_axis_initialize_conversion(i, axis, (device->conversions + i));
+
+      /* The values of 'direct' axes are positions, not movements. */
+      relabsd_physical_device_set_sums_relative_values
+      (
+         i,
+         (
+            (device->conversions[i].type != EV_ABS)
+            || !axis->flags[RELABSD_DIRECT]
+         ),
+         &(device->physical_device)
+      );
+   }
+}
@@ -1,120 +1,957 @@
 /**** POSIX *******************************************************************/
-/*
- * To get the POSIX 'getline' function.
- * We don't know what POSIX version is set by default.
- */
-#define _POSIX_C_SOURCE 200809L
-
-#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <unistd.h>
+#include <time.h>
 
 /**** RELABSD *****************************************************************/
 #include <relabsd/debug.h>
+#include <relabsd/protocol_types.h>
 #include <relabsd/server.h>
 
-#include <relabsd/device/virtual_device.h>
+#include <relabsd/config/parameters.h>
+
 #include <relabsd/device/axis.h>
 
-#include <relabsd/config/parameters.h>
+#include <relabsd/util/capture_ring.h>
+#include <relabsd/util/latency_histogram.h>
+#include <relabsd/util/string.h>
 
 /******************************************************************************/
 /**** LOCAL FUNCTIONS *********************************************************/
 /******************************************************************************/
 
-static void propagate_changes
+/*
+ * Devices are identified by their physical device file name or by their index
+ * (in the order they were given to the server).
+ */
+static struct relabsd_server_device * find_device
 (
+   const char name [const restrict static 1],
    struct relabsd_server server [const static 1]
 )
 {
-   struct relabsd_axis * axis;
    int i;
-   int virtual_device_is_dirty;
 
-   virtual_device_is_dirty = 0;
+   for (i = 0; i < server->devices_count; ++i)
+   {
+      if
+      (
+         RELABSD_STRING_EQUALS
+         (
+            name,
+            relabsd_parameters_get_physical_device_file_name
+            (
+               &(server->devices[i].pending_parameters)
+            )
+         )
+      )
+      {
+         return (server->devices + i);
+      }
+   }
+
+   if (relabsd_util_parse_int(name, 0, (server->devices_count - 1), &i) == 0)
+   {
+      return (server->devices + i);
+   }
+
+   return (struct relabsd_server_device *) NULL;
+}
+
+/*
+ * Adds 'length' bytes to the client's output.
+ *
+ * Returns 0 on success,
+ *         -1 if they do not fit.
+ */
+static int append_to_output
+(
+   struct relabsd_server_client client [const static 1],
+   const void * const data,
+   const size_t length
+)
+{
+   if (length > (sizeof(client->output) - client->output_length))
+   {
+      RELABSD_S_WARNING("The reply to a client was too long and was cut.");
+
+      return -1;
+   }
+
+   (void) memcpy
+   (
+      (void *) (client->output + client->output_length),
+      data,
+      length
+   );
+
+   client->output_length += length;
+
+   return 0;
+}
+
+/*
+ * Adds the reply to a command, whose text can then be added with
+ * 'append_text'.
+ *
+ * Returns the reply's position in the client's output,
+ *         or 0 if it does not fit.
+ */
+static size_t add_command_reply
+(
+   struct relabsd_server_client client [const static 1],
+   const enum relabsd_protocol_status status
+)
+{
+   struct relabsd_protocol_reply_header header;
+   size_t position;
+
+   header.status = (int32_t) status;
+   header.length = 0;
+
+   position = client->output_length;
+
+   if (append_to_output(client, (const void *) &header, sizeof(header)) < 0)
+   {
+      return 0;
+   }
+
+   return position;
+}
+
+static void append_text
+(
+   struct relabsd_server_client client [const static 1],
+   const size_t reply_position,
+   const char format [const restrict static 1],
+   ...
+)
+{
+   struct relabsd_protocol_reply_header header;
+   va_list arguments;
+   size_t available_size;
+   int length;
+
+   /* The frame's header always comes first, so 0 is never a reply's. */
+   if (reply_position == 0)
+   {
+      return;
+   }
+
+   available_size = (sizeof(client->output) - client->output_length);
+
+   va_start(arguments, format);
+   length =
+      vsnprintf
+      (
+         (client->output + client->output_length),
+         available_size,
+         format,
+         arguments
+      );
+   va_end(arguments);
+
+   if (length < 0)
+   {
+      return;
+   }
+
+   if (((size_t) length) >= available_size)
+   {
+      RELABSD_S_WARNING("The reply to a client was too long and was cut.");
+
+      /* 'vsnprintf' still filled the buffer, minus the '\0'. */
+      length = (int) (available_size - ((available_size > 0) ? 1 : 0));
+   }
+
+   client->output_length += (size_t) length;
+
+   (void) memcpy
+   (
+      (void *) &header,
+      (const void *) (client->output + reply_position),
+      sizeof(header)
+   );
+
+   header.length += (uint32_t) length;
+
+   (void) memcpy
+   (
+      (void *) (client->output + reply_position),
+      (const void *) &header,
+      sizeof(header)
+   );
+}
+
+/*
+ * Like every function here, only reads the request's copy of the parameters
+ * ('batch_parameters'): 'parameters' belongs to the conversion thread.
+ */
+static void send_latency_report
+(
+   struct relabsd_server_client client [const static 1],
+   const size_t reply_position,
+   const struct relabsd_server_device device [const static 1]
+)
+{
+   const struct relabsd_latency_histogram * const histogram =
+      &(device->latency_histogram);
+
+   append_text
+   (
+      client,
+      reply_position,
+      "%s: %lu frames, latency in microseconds: p50 %lu, p99 %lu,"
+      " p999 %lu, max %lu.\n",
+      relabsd_parameters_get_physical_device_file_name
+      (
+         &(device->batch_parameters)
+      ),
+      relabsd_latency_histogram_get_count(histogram),
+      relabsd_latency_histogram_get_percentile(histogram, 500),
+      relabsd_latency_histogram_get_percentile(histogram, 990),
+      relabsd_latency_histogram_get_percentile(histogram, 999),
+      relabsd_latency_histogram_get_max(histogram)
+   );
+}
+
+/*
+ * One "<key> <value>" per line, so that the state can be parsed easily.
+ * 'device->mutex' must be held.
+ */
+static void send_state
+(
+   struct relabsd_server_client client [const static 1],
+   const size_t reply_position,
+   struct relabsd_server_device device [const static 1]
+)
+{
+   /* In the same order as 'enum relabsd_axis_flag'. */
+   static const char * const flag_names[RELABSD_AXIS_FLAGS_COUNT] =
+      {
+         "direct",
+         "real_fuzz",
+         "framed",
+         "not_abs",
+         "invert"
+      };
+   struct relabsd_parameters * const parameters =
+      &(device->batch_parameters);
+   const struct relabsd_axis * axis;
+   struct timespec timeout;
+   int i, j;
+
+   timeout = relabsd_parameters_get_timeout(parameters);
+
+   append_text
+   (
+      client,
+      reply_position,
+      "device %s\ntimeout %ld\nlate_policy %s\n",
+      relabsd_parameters_get_physical_device_file_name(parameters),
+      (
+         relabsd_parameters_use_timeout(parameters) ?
+         (
+            (((long int) timeout.tv_sec) * 1000L)
+            + (((long int) timeout.tv_nsec) / 1000000L)
+         )
+         : 0L
+      ),
+      relabsd_parameters_get_late_policy_name(parameters)
+   );
 
    for (i = 0; i < RELABSD_AXIS_VALID_AXES_COUNT; ++i)
    {
       axis =
-         relabsd_parameters_get_axis
+         relabsd_parameters_get_axis((enum relabsd_axis_name) i, parameters);
+
+      append_text
+      (
+         client,
+         reply_position,
+         "axis %s enabled %d min %d max %d fuzz %d flat %d resolution %d"
+         " options",
+         relabsd_axis_name_to_string((enum relabsd_axis_name) i),
+         relabsd_axis_is_enabled(axis),
+         axis->min,
+         axis->max,
+         axis->fuzz,
+         axis->flat,
+         axis->resolution
+      );
+
+      for (j = 0; j < RELABSD_AXIS_FLAGS_COUNT; ++j)
+      {
+         if (relabsd_axis_has_flag(axis, (enum relabsd_axis_flag) j))
+         {
+            append_text(client, reply_position, " %s", flag_names[j]);
+         }
+      }
+
+      if (relabsd_axis_get_convert_to(axis) != RELABSD_UNKNOWN)
+      {
+         append_text
          (
-            (enum relabsd_axis_name) i,
-            &(server->parameters)
+            client,
+            reply_position,
+            " convert_to=%s",
+            relabsd_axis_name_to_string(relabsd_axis_get_convert_to(axis))
          );
+      }
 
-      if (relabsd_axis_attributes_are_dirty(axis))
+      append_text(client, reply_position, "\n");
+   }
+}
+
+/*
+ * One "<key> <value>" per line, as for the state. 'device->mutex' must be held.
+ */
+static void send_statistics
+(
+   struct relabsd_server_client client [const static 1],
+   const size_t reply_position,
+   const struct relabsd_server_device device [const static 1]
+)
+{
+   /* In the same order as 'enum relabsd_server_statistic'. */
+   static const char * const names[RELABSD_SERVER_STATISTICS_COUNT] =
+      {
+         "events_read",
+         "events_sent",
+         "frames_read",
+         "frames_written",
+         "write_errors",
+         "timeouts",
+         "late_episodes",
+         "late_events_discarded",
+         "virtual_device_recreations",
+         "mutex_holds",
+         "mutex_hold_microseconds"
+      };
+   /* In the same order as 'enum relabsd_axis_statistic'. */
+   static const char * const axis_names[RELABSD_AXIS_STATISTICS_COUNT] =
       {
-         (void) relabsd_virtual_device_update_axis_absinfo
+         "received",
+         "sent",
+         "fuzz_filtered",
+         "flattened",
+         "unchanged",
+         "clamped"
+      };
+   /* In the same order as 'enum relabsd_server_stall_statistic'. */
+   static const char * const stall_names
+      [RELABSD_SERVER_STALL_STATISTICS_COUNT] =
+      {
+         "stalls",
+         "stall_microseconds"
+      };
+   int i, j;
+
+   append_text
+   (
+      client,
+      reply_position,
+      "device %s\n",
+      relabsd_parameters_get_physical_device_file_name
+      (
+         &(device->batch_parameters)
+      )
+   );
+
+   for (i = 0; i < RELABSD_SERVER_STATISTICS_COUNT; ++i)
+   {
+      append_text
+      (
+         client,
+         reply_position,
+         "%s %lu\n",
+         names[i],
+         relabsd_server_get_statistic
          (
-            (enum relabsd_axis_name) i,
-            axis,
-            &(server->virtual_device)
+            device,
+            (enum relabsd_server_statistic) i
+         )
+      );
+   }
+
+   append_text
+   (
+      client,
+      reply_position,
+      "longest_mutex_hold_microseconds %lu\n",
+      device->statistics.longest_mutex_hold_microseconds
+   );
+
+   for (i = 0; i < RELABSD_AXIS_VALID_AXES_COUNT; ++i)
+   {
+      append_text
+      (
+         client,
+         reply_position,
+         "axis %s",
+         relabsd_axis_name_to_string((enum relabsd_axis_name) i)
+      );
+
+      for (j = 0; j < RELABSD_AXIS_STATISTICS_COUNT; ++j)
+      {
+         append_text
+         (
+            client,
+            reply_position,
+            " %s %lu",
+            axis_names[j],
+            relabsd_server_get_axis_statistic
+            (
+               device,
+               (enum relabsd_axis_name) i,
+               (enum relabsd_axis_statistic) j
+            )
          );
+      }
+
+      append_text(client, reply_position, "\n");
+   }
 
-         relabsd_axis_set_attributes_are_dirty(0, axis);
+   for (i = 0; i < RELABSD_SERVER_CONVERSION_STAGES_COUNT; ++i)
+   {
+      append_text
+      (
+         client,
+         reply_position,
+         "stage %s",
+         relabsd_server_get_conversion_stage_name
+         (
+            (enum relabsd_server_conversion_stage) i
+         )
+      );
 
-         virtual_device_is_dirty = 1;
+      for (j = 0; j < RELABSD_SERVER_STALL_STATISTICS_COUNT; ++j)
+      {
+         append_text
+         (
+            client,
+            reply_position,
+            " %s %lu",
+            stall_names[j],
+            relabsd_server_get_stall_statistic
+            (
+               device,
+               (enum relabsd_server_conversion_stage) i,
+               (enum relabsd_server_stall_statistic) j
+            )
+         );
       }
+
+      append_text(client, reply_position, "\n");
    }
+}
+
+/*
+ * The reply gives the name of the shared memory object, the device's ring in
+ * it, and the client's reader slot. The slot's eventfd is sent along with it.
+ */
+static void send_output_ring_reader
+(
+   struct relabsd_server_client client [const static 1],
+   struct relabsd_server_device device [const static 1],
+   const struct relabsd_server server [const static 1]
+)
+{
+   size_t reply_position;
+   int slot;
+
+   slot = relabsd_server_add_output_ring_reader(device, client);
 
-   if (relabsd_parameters_device_name_is_dirty(&(server->parameters)))
+   if (slot < 0)
    {
-      (void) relabsd_virtual_device_rename
+      (void) add_command_reply(client, RELABSD_PROTOCOL_UNAVAILABLE);
+
+      return;
+   }
+
+   reply_position = add_command_reply(client, RELABSD_PROTOCOL_OK);
+
+   append_text
+   (
+      client,
+      reply_position,
+      "%s %d %d\n",
+      relabsd_parameters_get_output_ring_name(&(server->parameters)),
+      (int) (device - server->devices),
+      slot
+   );
+}
+
+/*
+ * The files are named by the server, so that clients cannot have it write
+ * anywhere else.
+ *
+ * Returns 0 on success,
+ *         -1 if the names are too long.
+ */
+static int get_capture_file_names
+(
+   const struct relabsd_server_device device [const static 1],
+   const struct relabsd_server server [const static 1],
+   char inputs_file_name [const restrict static PATH_MAX],
+   char outputs_file_name [const restrict static PATH_MAX]
+)
+{
+   const char * prefix;
+   int index, length;
+
+   prefix =
+      relabsd_parameters_get_capture_file_prefix
       (
-         &(server->parameters),
-         &(server->virtual_device)
+         &(device->pending_parameters)
       );
+   index = (int) (device - server->devices);
+
+   length =
+      snprintf
+      (
+         outputs_file_name,
+         PATH_MAX,
+         "%s%d.output",
+         prefix,
+         index
+      );
+
+   /* The other name is shorter. */
+   if ((length < 0) || (length >= PATH_MAX))
+   {
+      RELABSD_S_ERROR("The capture file prefix is too long.");
+
+      return -1;
+   }
+
+   (void) snprintf
+   (
+      inputs_file_name,
+      PATH_MAX,
+      "%s%d.input",
+      prefix,
+      index
+   );
+
+   return 0;
+}
+
+/*
+ * The reply gives the names of the files, which are only written once the
+ * request has been handled (see 'dump_capture'), so that the device is not
+ * locked in the meantime. A single dump per device and request.
+ */
+static void request_capture_dump
+(
+   struct relabsd_server_client client [const static 1],
+   struct relabsd_server_device device [const static 1],
+   const struct relabsd_server server [const static 1]
+)
+{
+   char inputs_file_name[PATH_MAX];
+   char outputs_file_name[PATH_MAX];
+   size_t reply_position;
 
-      relabsd_parameters_clean_device_name(&(server->parameters));
-      virtual_device_is_dirty = 1;
+   if
+   (
+      (device->capture_ring == (struct relabsd_capture_ring *) NULL)
+      || (device->capture_dump_reply_position != 0)
+   )
+   {
+      (void) add_command_reply(client, RELABSD_PROTOCOL_UNAVAILABLE);
+
+      return;
    }
 
-   if (virtual_device_is_dirty)
+   if
+   (
+      get_capture_file_names
+      (
+         device,
+         server,
+         inputs_file_name,
+         outputs_file_name
+      )
+      < 0
+   )
    {
-      (void) relabsd_virtual_device_recreate(&(server->virtual_device));
+      (void) add_command_reply(client, RELABSD_PROTOCOL_FAILED);
+
+      return;
    }
+
+   reply_position = add_command_reply(client, RELABSD_PROTOCOL_OK);
+
+   append_text
+   (
+      client,
+      reply_position,
+      "%s %s\n",
+      inputs_file_name,
+      outputs_file_name
+   );
+
+   device->capture_dump_reply_position = reply_position;
+}
+
+/*
+ * Writes the capture files the request asked for, without holding the
+ * device's mutex: the conversion can keep adding events to the ring in the
+ * meantime. The reply's status is changed if it fails.
+ */
+static void dump_capture
+(
+   struct relabsd_server_client client [const static 1],
+   struct relabsd_server_device device [const static 1],
+   const struct relabsd_server server [const static 1]
+)
+{
+   struct relabsd_protocol_reply_header header;
+   char inputs_file_name[PATH_MAX];
+   char outputs_file_name[PATH_MAX];
+
+   if
+   (
+      (
+         get_capture_file_names
+         (
+            device,
+            server,
+            inputs_file_name,
+            outputs_file_name
+         )
+         == 0
+      )
+      &&
+      (
+         relabsd_capture_ring_dump
+         (
+            device->capture_ring,
+            inputs_file_name,
+            outputs_file_name
+         )
+         == 0
+      )
+   )
+   {
+      return;
+   }
+
+   (void) memcpy
+   (
+      (void *) &header,
+      (const void *) (client->output + device->capture_dump_reply_position),
+      sizeof(header)
+   );
+
+   header.status = (int32_t) RELABSD_PROTOCOL_FAILED;
+
+   (void) memcpy
+   (
+      (void *) (client->output + device->capture_dump_reply_position),
+      (const void *) &header,
+      sizeof(header)
+   );
+}
+
+/*
+ * Makes the request's commands apply to the device, which stays locked until
+ * the end of the request. The request is already in memory, so this is short.
+ * The conversion never waits for this mutex anyway: it keeps using its own
+ * copy of the parameters until the new ones are published.
+ */
+static void enter_batch
+(
+   struct relabsd_server_device device [const static 1]
+)
+{
+   if (device->is_in_batch)
+   {
+      return;
+   }
+
+   pthread_mutex_lock(&(device->mutex));
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &(device->batch_lock_time));
+
+   relabsd_parameters_start_batch
+   (
+      &(device->pending_parameters),
+      &(device->batch_parameters)
+   );
+
+   device->is_in_batch = 1;
+   device->batch_has_changes = 0;
+   device->capture_dump_reply_position = 0;
+}
+
+/*
+ * Publishes the changes the request made to the device if all of its commands
+ * were valid, then unlocks the device.
+ */
+static void leave_batch
+(
+   const int is_valid,
+   struct relabsd_server_device device [const static 1]
+)
+{
+   if (is_valid && device->batch_has_changes)
+   {
+      relabsd_parameters_commit_batch
+      (
+         &(device->batch_parameters),
+         &(device->pending_parameters)
+      );
+
+      /* Done here so that the conversion does not have to wait for it. */
+      relabsd_server_prepare_virtual_device_replacement(device);
+      relabsd_server_publish_device_parameters(device);
+   }
+   else
+   {
+      relabsd_parameters_discard_batch(&(device->batch_parameters));
+   }
+
+   device->is_in_batch = 0;
+
+   relabsd_server_record_mutex_hold(device, &(device->batch_lock_time));
+
+   pthread_mutex_unlock(&(device->mutex));
+
+   relabsd_server_wake_up_device(device);
 }
 
 /******************************************************************************/
 /**** EXPORTED FUNCTIONS ******************************************************/
 /******************************************************************************/
-int relabsd_server_handle_client
+void relabsd_server_handle_request
 (
-   const int socket,
+   const size_t request_length,
+   struct relabsd_server_client client [const static 1],
    struct relabsd_server server [const static 1]
 )
 {
-   FILE * socket_as_file;
+   struct relabsd_protocol_frame_header frame_header;
+   struct relabsd_parameters_client_input input;
+   struct relabsd_server_device * device;
+   struct relabsd_server_device * selected;
+   char * selected_device;
+   enum relabsd_parameters_command_result result;
+   size_t frame_position, reply_position;
+   int i, is_valid;
+
+   relabsd_parameters_initialize_client_input
+   (
+      (client->input + sizeof(struct relabsd_protocol_frame_header)),
+      request_length,
+      &input
+   );
+
+   frame_position = client->output_length;
+   frame_header.length = 0;
+
+   if
+   (
+      append_to_output
+      (
+         client,
+         (const void *) &frame_header,
+         sizeof(frame_header)
+      )
+      < 0
+   )
+   {
+      return;
+   }
+
+   device = client->device;
+   is_valid = 1;
+
+   enter_batch(device);
+
+   while (relabsd_parameters_has_remote_commands(&input))
+   {
+      result =
+         relabsd_parameters_handle_remote_command
+         (
+            &input,
+            &(device->batch_parameters),
+            &selected_device
+         );
+
+      if (result == RELABSD_PARAMETERS_UNKNOWN_COMMAND)
+      {
+         (void) add_command_reply(client, RELABSD_PROTOCOL_UNKNOWN_COMMAND);
+
+         is_valid = 0;
+
+         break;
+      }
+
+      switch (result)
+      {
+         case RELABSD_PARAMETERS_INVALID_COMMAND:
+            (void) add_command_reply
+            (
+               client,
+               RELABSD_PROTOCOL_INVALID_ARGUMENTS
+            );
+            is_valid = 0;
+            continue;
+
+         case RELABSD_PARAMETERS_OUTPUT_RING_REQUEST:
+            send_output_ring_reader(client, device, server);
+            continue;
+
+         case RELABSD_PARAMETERS_CAPTURE_DUMP_REQUEST:
+            request_capture_dump(client, device, server);
+            continue;
+
+         case RELABSD_PARAMETERS_LATENCY_REQUEST:
+            reply_position = add_command_reply(client, RELABSD_PROTOCOL_OK);
+            send_latency_report(client, reply_position, device);
+            continue;
+
+         case RELABSD_PARAMETERS_STATE_REQUEST:
+            reply_position = add_command_reply(client, RELABSD_PROTOCOL_OK);
+            send_state(client, reply_position, device);
+            continue;
+
+         case RELABSD_PARAMETERS_WATCH_REQUEST:
+            (void) add_command_reply(client, RELABSD_PROTOCOL_OK);
+            relabsd_server_subscribe(device, client);
+            continue;
+
+         case RELABSD_PARAMETERS_STATISTICS_REQUEST:
+            reply_position = add_command_reply(client, RELABSD_PROTOCOL_OK);
+            send_statistics(client, reply_position, device);
+            continue;
+
+         case RELABSD_PARAMETERS_STATISTICS_RESET_REQUEST:
+            (void) add_command_reply(client, RELABSD_PROTOCOL_OK);
+            relabsd_server_reset_statistics(device);
+            continue;
+
+         case RELABSD_PARAMETERS_COMMAND_APPLIED:
+            (void) add_command_reply(client, RELABSD_PROTOCOL_OK);
+            device->batch_has_changes = 1;
+            continue;
+
+         default:
+            /* The client selected another device. */
+            break;
+      }
 
-   errno = 0;
-   socket_as_file = fdopen(socket, "r");
+      selected = find_device(selected_device, server);
 
-   if (socket_as_file == ((FILE *) NULL))
+      if (selected == (struct relabsd_server_device *) NULL)
+      {
+         RELABSD_ERROR
+         (
+            "Client selected unknown device \"%s\".",
+            selected_device
+         );
+
+         (void) add_command_reply(client, RELABSD_PROTOCOL_UNKNOWN_DEVICE);
+
+         is_valid = 0;
+      }
+      else
+      {
+         (void) add_command_reply(client, RELABSD_PROTOCOL_OK);
+
+         enter_batch(selected);
+
+         device = selected;
+      }
+
+      free((void *) selected_device);
+   }
+
+   if (!is_valid)
    {
-      RELABSD_ERROR
+      RELABSD_S_WARNING
       (
-         "Unable to open client socket as a FILE: %s.",
-         strerror(errno)
+         "A client's request had an invalid command, none of its changes were"
+         " applied."
       );
+   }
 
-      (void) close(socket);
+   for (i = 0; i < server->devices_count; ++i)
+   {
+      if (server->devices[i].is_in_batch)
+      {
+         leave_batch(is_valid, (server->devices + i));
+      }
+   }
 
-      return -1;
+   /* Once no device is locked anymore. */
+   for (i = 0; i < server->devices_count; ++i)
+   {
+      if (server->devices[i].capture_dump_reply_position != 0)
+      {
+         dump_capture(client, (server->devices + i), server);
+
+         server->devices[i].capture_dump_reply_position = 0;
+      }
+   }
+
+   /* The selection of a device is part of the request. */
+   if (is_valid)
+   {
+      client->device = device;
    }
 
-   pthread_mutex_lock(&(server->mutex));
-   (void) relabsd_parameters_handle_remote_client
+   frame_header.length =
+      (uint32_t)
+      (
+         client->output_length
+         - frame_position
+         - sizeof(struct relabsd_protocol_frame_header)
+      );
+
+   (void) memcpy
    (
-      socket_as_file,
-      &(server->parameters)
+      (void *) (client->output + frame_position),
+      (const void *) &frame_header,
+      sizeof(frame_header)
    );
-   propagate_changes(server);
-   pthread_mutex_unlock(&(server->mutex));
+}
+
+void relabsd_server_reject_request
+(
+   const enum relabsd_protocol_status status,
+   struct relabsd_server_client client [const static 1]
+)
+{
+   struct relabsd_protocol_frame_header frame_header;
+   struct relabsd_protocol_reply_header reply_header;
 
-   /* This also closes 'socket' */
-   (void) fclose(socket_as_file);
+   frame_header.length = (uint32_t) sizeof(reply_header);
+   reply_header.status = (int32_t) status;
+   reply_header.length = 0;
 
-   return 0;
+   if
+   (
+      append_to_output
+      (
+         client,
+         (const void *) &frame_header,
+         sizeof(frame_header)
+      )
+      == 0
+   )
+   {
+      (void) append_to_output
+      (
+         client,
+         (const void *) &reply_header,
+         sizeof(reply_header)
+      );
+   }
 }
@@ -1,29 +1,53 @@
 /**** POSIX *******************************************************************/
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+
 #include <errno.h>
+#include <pthread.h>
 #include <signal.h>
+#include <stdint.h>
 #include <string.h>
 #include <unistd.h>
 
 /**** RELABSD *****************************************************************/
 #include <relabsd/debug.h>
+#include <relabsd/server.h>
 
 /******************************************************************************/
 /**** LOCAL FUNCTIONS *********************************************************/
 /******************************************************************************/
-static int RELABSD_INTERRUPTION_PIPES[2];
+/*
+ * The interruption file descriptor is an eventfd that is never read: once it
+ * has been written to, it stays readable, so that every thread waiting on it
+ * gets woken up.
+ */
+static int RELABSD_INTERRUPTION_FILE = -1;
+static int RELABSD_SIGNAL_FILE = -1;
+static sigset_t RELABSD_PREVIOUS_SIGNAL_MASK;
 static int RELABSD_RUN = 1;
 
-static void interrupt (int unused_mandatory_parameter __attribute__((unused)))
+static void interrupt (void)
 {
+   const uint64_t increment = 1;
+
    RELABSD_RUN = 0;
 
    errno = 0;
 
-   if (write(RELABSD_INTERRUPTION_PIPES[1], (void *) "!", (size_t) 1) == -1)
+   if
+   (
+      write
+      (
+         RELABSD_INTERRUPTION_FILE,
+         (const void *) &increment,
+         sizeof(uint64_t)
+      )
+      == -1
+   )
    {
       RELABSD_ERROR
       (
-         "Unable to signal the interruption to the conversion thread."
+         "Unable to signal the interruption to the server's threads."
          " Interruption should still occur following the next input from the"
          " physical device. Error: %s.",
          strerror(errno)
@@ -41,42 +65,71 @@ int relabsd_server_keep_running (void)
 
 void relabsd_server_interrupt (void)
 {
-   interrupt(0);
+   interrupt();
 }
 
 int relabsd_server_initialize_signal_handlers (void)
 {
+   sigset_t signals;
+   int err;
+
    RELABSD_S_DEBUG(RELABSD_DEBUG_PROGRAM_FLOW, "Setting signal handlers.");
 
    errno = 0;
 
-   if (pipe(RELABSD_INTERRUPTION_PIPES) == -1)
+   RELABSD_INTERRUPTION_FILE = eventfd(0, (EFD_CLOEXEC | EFD_NONBLOCK));
+
+   if (RELABSD_INTERRUPTION_FILE == -1)
    {
       RELABSD_FATAL
       (
-         "Unable to create an unnamed pipe for the interruption handling: %s",
+         "Unable to create an eventfd for the interruption handling: %s",
          strerror(errno)
       );
 
       return -1;
    }
 
-   if (signal(SIGINT, interrupt) == SIG_ERR)
+   (void) sigemptyset(&signals);
+   (void) sigaddset(&signals, SIGINT);
+   (void) sigaddset(&signals, SIGTERM);
+
+   /*
+    * Threads inherit the signal mask of their creator, so this has to be done
+    * before any other thread is created. The signals are then only received
+    * through the signalfd.
+    */
+   err =
+      pthread_sigmask(SIG_BLOCK, &signals, &RELABSD_PREVIOUS_SIGNAL_MASK);
+
+   if (err != 0)
    {
-      RELABSD_S_FATAL("Unable to set the SIGINT signal handler.");
+      RELABSD_FATAL("Unable to block SIGINT and SIGTERM: %s.", strerror(err));
 
-      (void) close(RELABSD_INTERRUPTION_PIPES[0]);
-      (void) close(RELABSD_INTERRUPTION_PIPES[1]);
+      (void) close(RELABSD_INTERRUPTION_FILE);
 
       return -1;
    }
 
-   if (signal(SIGTERM, interrupt) == SIG_ERR)
+   errno = 0;
+
+   RELABSD_SIGNAL_FILE = signalfd(-1, &signals, (SFD_CLOEXEC | SFD_NONBLOCK));
+
+   if (RELABSD_SIGNAL_FILE == -1)
    {
-      RELABSD_S_FATAL("Unable to set the SIGTERM signal handler.");
+      RELABSD_FATAL
+      (
+         "Unable to create a signalfd for SIGINT and SIGTERM: %s.",
+         strerror(errno)
+      );
 
-      (void) close(RELABSD_INTERRUPTION_PIPES[0]);
-      (void) close(RELABSD_INTERRUPTION_PIPES[1]);
+      (void) pthread_sigmask
+      (
+         SIG_SETMASK,
+         &RELABSD_PREVIOUS_SIGNAL_MASK,
+         (sigset_t *) NULL
+      );
+      (void) close(RELABSD_INTERRUPTION_FILE);
 
       return -1;
    }
@@ -86,11 +139,64 @@ int relabsd_server_initialize_signal_handlers (void)
 
 void relabsd_server_finalize_signal_handlers (void)
 {
-   (void) close(RELABSD_INTERRUPTION_PIPES[0]);
-   (void) close(RELABSD_INTERRUPTION_PIPES[1]);
+   (void) close(RELABSD_SIGNAL_FILE);
+   (void) pthread_sigmask
+   (
+      SIG_SETMASK,
+      &RELABSD_PREVIOUS_SIGNAL_MASK,
+      (sigset_t *) NULL
+   );
+   (void) close(RELABSD_INTERRUPTION_FILE);
 }
 
 int relabsd_server_get_interruption_file_descriptor (void)
 {
-   return RELABSD_INTERRUPTION_PIPES[0];
+   return RELABSD_INTERRUPTION_FILE;
+}
+
+int relabsd_server_get_signal_file_descriptor (void)
+{
+   return RELABSD_SIGNAL_FILE;
+}
+
+void relabsd_server_handle_signals (void)
+{
+   struct signalfd_siginfo signal_info;
+
+   for (;;)
+   {
+      errno = 0;
+
+      if
+      (
+         read
+         (
+            RELABSD_SIGNAL_FILE,
+            (void *) &signal_info,
+            sizeof(struct signalfd_siginfo)
+         )
+         != ((ssize_t) sizeof(struct signalfd_siginfo))
+      )
+      {
+         if ((errno != EAGAIN) && (errno != 0))
+         {
+            RELABSD_ERROR
+            (
+               "Unable to read from the signalfd: %s.",
+               strerror(errno)
+            );
+         }
+
+         return;
+      }
+
+      RELABSD_DEBUG
+      (
+         RELABSD_DEBUG_PROGRAM_FLOW,
+         "Received signal %u, interrupting.",
+         (unsigned int) signal_info.ssi_signo
+      );
+
+      interrupt();
+   }
 }
@@ -0,0 +1,305 @@
+/**** POSIX *******************************************************************/
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+/**** RELABSD *****************************************************************/
+#include <relabsd/debug.h>
+#include <relabsd/output_ring_types.h>
+#include <relabsd/server.h>
+
+#include <relabsd/config/parameters.h>
+
+#include <relabsd/device/output_ring.h>
+#include <relabsd/device/virtual_device.h>
+
+/******************************************************************************/
+/**** LOCAL FUNCTIONS *********************************************************/
+/******************************************************************************/
+static void initialize_writer
+(
+   struct relabsd_output_ring ring [const static 1],
+   struct relabsd_output_ring_writer writer [const static 1]
+)
+{
+   int i;
+
+   writer->ring = ring;
+
+   for (i = 0; i < RELABSD_OUTPUT_RING_READERS_COUNT; ++i)
+   {
+      atomic_init((writer->files + i), -1);
+      writer->slot_is_used[i] = 0;
+   }
+
+   atomic_init(&(writer->wakeup_sequence), 0);
+}
+
+static void finalize_writer
+(
+   struct relabsd_output_ring_writer writer [const static 1]
+)
+{
+   int i, file;
+
+   for (i = 0; i < RELABSD_OUTPUT_RING_READERS_COUNT; ++i)
+   {
+      file = atomic_load_explicit((writer->files + i), memory_order_relaxed);
+
+      if (file != -1)
+      {
+         (void) close(file);
+      }
+   }
+}
+
+/******************************************************************************/
+/**** EXPORTED FUNCTIONS ******************************************************/
+/******************************************************************************/
+int relabsd_server_create_output_rings
+(
+   struct relabsd_server server [const static 1]
+)
+{
+   const char * name;
+   void * region;
+   size_t size;
+   int file, i;
+
+   name = relabsd_parameters_get_output_ring_name(&(server->parameters));
+
+   server->output_rings = (struct relabsd_output_rings *) NULL;
+
+   if (name == (const char *) NULL)
+   {
+      return 0;
+   }
+
+   size =
+      (
+         sizeof(struct relabsd_output_rings)
+         + (
+            ((size_t) server->devices_count)
+            * sizeof(struct relabsd_output_ring)
+         )
+      );
+
+   errno = 0;
+
+   /* Readers have to write to it to tell when they wait. */
+   file = shm_open(name, (O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC), 0660);
+
+   if (file == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to create the shared memory object \"%s\": %s.",
+         name,
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   errno = 0;
+
+   if (ftruncate(file, (off_t) size) == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to resize the shared memory object \"%s\": %s.",
+         name,
+         strerror(errno)
+      );
+
+      (void) close(file);
+      (void) shm_unlink(name);
+
+      return -1;
+   }
+
+   errno = 0;
+
+   region = mmap(NULL, size, (PROT_READ | PROT_WRITE), MAP_SHARED, file, 0);
+
+   /* The mapping stays valid without it. */
+   (void) close(file);
+
+   if (region == MAP_FAILED)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to map the shared memory object \"%s\": %s.",
+         name,
+         strerror(errno)
+      );
+
+      (void) shm_unlink(name);
+
+      return -1;
+   }
+
+   /* 'ftruncate' zeroed it, which is a valid (empty) state for every ring. */
+   server->output_rings = (struct relabsd_output_rings *) region;
+   server->output_rings_size = size;
+   server->output_rings->devices_count = (uint32_t) server->devices_count;
+   server->output_rings->events_count = RELABSD_OUTPUT_RING_EVENTS_COUNT;
+   server->output_rings->readers_count = RELABSD_OUTPUT_RING_READERS_COUNT;
+
+   for (i = 0; i < server->devices_count; ++i)
+   {
+      initialize_writer
+      (
+         (server->output_rings->rings + i),
+         &(server->devices[i].output_ring)
+      );
+
+      relabsd_virtual_device_set_output_ring
+      (
+         &(server->devices[i].output_ring),
+         &(server->devices[i].virtual_device)
+      );
+   }
+
+   /* Readers check this last. */
+   (void) memcpy
+   (
+      (void *) server->output_rings->magic,
+      (const void *) RELABSD_OUTPUT_RING_MAGIC,
+      RELABSD_OUTPUT_RING_MAGIC_SIZE
+   );
+
+   atomic_thread_fence(memory_order_release);
+
+   return 0;
+}
+
+void relabsd_server_destroy_output_rings
+(
+   struct relabsd_server server [const static 1]
+)
+{
+   int i;
+
+   if (server->output_rings == (struct relabsd_output_rings *) NULL)
+   {
+      return;
+   }
+
+   for (i = 0; i < server->devices_count; ++i)
+   {
+      relabsd_virtual_device_set_output_ring
+      (
+         (struct relabsd_output_ring_writer *) NULL,
+         &(server->devices[i].virtual_device)
+      );
+
+      finalize_writer(&(server->devices[i].output_ring));
+   }
+
+   (void) munmap((void *) server->output_rings, server->output_rings_size);
+   (void) shm_unlink
+   (
+      relabsd_parameters_get_output_ring_name(&(server->parameters))
+   );
+
+   server->output_rings = (struct relabsd_output_rings *) NULL;
+}
+
+int relabsd_server_add_output_ring_reader
+(
+   struct relabsd_server_device device [const static 1],
+   struct relabsd_server_client client [const static 1]
+)
+{
+   struct relabsd_output_ring_writer * const writer = &(device->output_ring);
+   int slot, file;
+
+   if (writer->ring == (struct relabsd_output_ring *) NULL)
+   {
+      return -1;
+   }
+
+   relabsd_server_remove_output_ring_reader(client);
+
+   for (slot = 0; slot < RELABSD_OUTPUT_RING_READERS_COUNT; ++slot)
+   {
+      if (!writer->slot_is_used[slot])
+      {
+         break;
+      }
+   }
+
+   if (slot == RELABSD_OUTPUT_RING_READERS_COUNT)
+   {
+      RELABSD_S_WARNING("All the reader slots of an output ring are used.");
+
+      return -1;
+   }
+
+   errno = 0;
+
+   /* Readers are expected to block on it. */
+   file = eventfd(0, EFD_CLOEXEC);
+
+   if (file == -1)
+   {
+      RELABSD_ERROR
+      (
+         "Unable to create an eventfd for an output ring reader: %s.",
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   atomic_store_explicit
+   (
+      (writer->files + slot),
+      file,
+      memory_order_release
+   );
+
+   atomic_store(&(writer->ring->readers[slot].is_waiting), 0);
+
+   writer->slot_is_used[slot] = 1;
+
+   client->output_ring_device = device;
+   client->output_ring_slot = slot;
+   client->passed_file = file;
+
+   return slot;
+}
+
+void relabsd_server_remove_output_ring_reader
+(
+   struct relabsd_server_client client [const static 1]
+)
+{
+   if (client->output_ring_device == (struct relabsd_server_device *) NULL)
+   {
+      return;
+   }
+
+   /* The client may still have it, but no longer gets this ring's wakeups. */
+   relabsd_output_ring_remove_reader_file
+   (
+      &(client->output_ring_device->output_ring),
+      client->output_ring_slot
+   );
+
+   client->output_ring_device->output_ring.slot_is_used
+   [
+      client->output_ring_slot
+   ] = 0;
+
+   client->output_ring_device = (struct relabsd_server_device *) NULL;
+   client->passed_file = -1;
+}
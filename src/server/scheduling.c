@@ -0,0 +1,234 @@
+/**** POSIX *******************************************************************/
+/* To get 'pthread_setaffinity_np' and the CPU_* macros. */
+#define _GNU_SOURCE
+
+#include <sys/mman.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**** RELABSD *****************************************************************/
+#include <relabsd/debug.h>
+#include <relabsd/server.h>
+
+#include <relabsd/config/parameters.h>
+
+/******************************************************************************/
+/**** LOCAL FUNCTIONS *********************************************************/
+/******************************************************************************/
+/* 'list' is made of comma-separated CPUs or ranges of CPUs (e.g. "0,2-3"). */
+static int parse_cpus
+(
+   const char list [const restrict static 1],
+   cpu_set_t cpus [const restrict static 1]
+)
+{
+   const char * position;
+   char * end;
+   long int first, last;
+
+   CPU_ZERO(cpus);
+
+   position = list;
+
+   for (;;)
+   {
+      errno = 0;
+
+      first = strtol(position, &end, 10);
+
+      if ((errno != 0) || (end == position) || (first < 0))
+      {
+         return -1;
+      }
+
+      last = first;
+
+      if (*end == '-')
+      {
+         position = (end + 1);
+
+         errno = 0;
+
+         last = strtol(position, &end, 10);
+
+         if ((errno != 0) || (end == position) || (last < first))
+         {
+            return -1;
+         }
+      }
+
+      if (last >= CPU_SETSIZE)
+      {
+         return -1;
+      }
+
+      for (; first <= last; ++first)
+      {
+         CPU_SET((int) first, cpus);
+      }
+
+      if (*end == '\0')
+      {
+         return 0;
+      }
+
+      if (*end != ',')
+      {
+         return -1;
+      }
+
+      position = (end + 1);
+   }
+}
+
+/******************************************************************************/
+/**** EXPORTED FUNCTIONS ******************************************************/
+/******************************************************************************/
+int relabsd_server_set_conversion_thread_scheduling
+(
+   const struct relabsd_server server [const static 1],
+   const pthread_t thread
+)
+{
+   struct sched_param parameter;
+   cpu_set_t cpus;
+   const char * cpu_list;
+   int err;
+
+   cpu_list = relabsd_parameters_get_conversion_cpus(&(server->parameters));
+
+   if (cpu_list != (const char *) NULL)
+   {
+      if (parse_cpus(cpu_list, &cpus) < 0)
+      {
+         RELABSD_FATAL("Invalid list of CPUs \"%s\".", cpu_list);
+
+         return -1;
+      }
+
+      err = pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpus);
+
+      if (err != 0)
+      {
+         RELABSD_FATAL
+         (
+            "Unable to pin a conversion thread to the CPUs \"%s\": %s.",
+            cpu_list,
+            strerror(err)
+         );
+
+         return -1;
+      }
+   }
+
+   if
+   (
+      relabsd_parameters_get_conversion_policy(&(server->parameters))
+      == SCHED_OTHER
+   )
+   {
+      return 0;
+   }
+
+   (void) memset((void *) &parameter, 0, sizeof(struct sched_param));
+
+   parameter.sched_priority =
+      relabsd_parameters_get_conversion_priority(&(server->parameters));
+
+   err =
+      pthread_setschedparam
+      (
+         thread,
+         relabsd_parameters_get_conversion_policy(&(server->parameters)),
+         &parameter
+      );
+
+   if (err != 0)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to give a conversion thread a real-time priority: %s.",
+         strerror(err)
+      );
+
+      return -1;
+   }
+
+   return 0;
+}
+
+int relabsd_server_set_stall_watchdog_scheduling
+(
+   const struct relabsd_server server [const static 1],
+   const pthread_t thread
+)
+{
+   struct sched_param parameter;
+   int policy, maximum, err;
+
+   policy = relabsd_parameters_get_conversion_policy(&(server->parameters));
+
+   if (policy == SCHED_OTHER)
+   {
+      return 0;
+   }
+
+   (void) memset((void *) &parameter, 0, sizeof(struct sched_param));
+
+   maximum = sched_get_priority_max(policy);
+
+   parameter.sched_priority =
+      relabsd_parameters_get_conversion_priority(&(server->parameters));
+
+   /* Otherwise, it only runs when they let it. */
+   if (parameter.sched_priority < maximum)
+   {
+      parameter.sched_priority += 1;
+   }
+
+   err = pthread_setschedparam(thread, policy, &parameter);
+
+   if (err != 0)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to give the stall watchdog a real-time priority: %s.",
+         strerror(err)
+      );
+
+      return -1;
+   }
+
+   return 0;
+}
+
+int relabsd_server_lock_memory
+(
+   const struct relabsd_server server [const static 1]
+)
+{
+   if (!relabsd_parameters_get_lock_memory(&(server->parameters)))
+   {
+      return 0;
+   }
+
+   errno = 0;
+
+   /* Also covers the memory allocated afterwards, thread stacks included. */
+   if (mlockall(MCL_CURRENT | MCL_FUTURE) == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to lock the server's memory: %s.",
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   return 0;
+}
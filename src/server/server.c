@@ -1,4 +1,7 @@
 /**** POSIX *******************************************************************/
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdlib.h>
 #include <string.h>
 
 /**** RELABSD *****************************************************************/
@@ -11,27 +14,26 @@
 #include <relabsd/device/physical_device.h>
 #include <relabsd/device/virtual_device.h>
 
+#include <relabsd/util/capture_ring.h>
+#include <relabsd/util/latency_histogram.h>
+#include <relabsd/util/log.h>
+
 /******************************************************************************/
 /**** LOCAL FUNCTIONS *********************************************************/
 /******************************************************************************/
-static int initialize
+static int initialize_device
 (
-   struct relabsd_server server [const restrict static 1]
+   struct relabsd_server_device device [const restrict static 1]
 )
 {
-   int err;
-
-   relabsd_server_initialize_signal_handlers();
+   int i, err;
 
    if
    (
       relabsd_physical_device_open
       (
-         relabsd_parameters_get_physical_device_file_name
-         (
-            &(server->parameters)
-         ),
-         &(server->physical_device)
+         &(device->parameters),
+         &(device->physical_device)
       )
       < 0
    )
@@ -43,27 +45,269 @@ static int initialize
    (
       relabsd_virtual_device_create_from
       (
-         &(server->parameters),
-         &(server->virtual_device)
+         &(device->parameters),
+         &(device->virtual_device)
       )
       < 0
    )
    {
-      relabsd_physical_device_close(&(server->physical_device));
+      relabsd_physical_device_close(&(device->physical_device));
 
       return -2;
    }
 
    err =
-      pthread_mutex_init(&(server->mutex), (const pthread_mutexattr_t *) NULL);
+      pthread_mutex_init(&(device->mutex), (const pthread_mutexattr_t *) NULL);
 
    if (err != 0)
    {
       RELABSD_FATAL
       (
-         "Could not initialize the server's mutex: %s.",
+         "Could not initialize the device's mutex: %s.",
          strerror(err)
       );
+
+      relabsd_virtual_device_destroy(&(device->virtual_device));
+      relabsd_physical_device_close(&(device->physical_device));
+
+      return -3;
+   }
+
+   device->capture_ring = (struct relabsd_capture_ring *) NULL;
+
+   if
+   (
+      relabsd_parameters_get_capture_file_prefix(&(device->parameters))
+      != (const char *) NULL
+   )
+   {
+      device->capture_ring = relabsd_capture_ring_create();
+
+      if (device->capture_ring == (struct relabsd_capture_ring *) NULL)
+      {
+         (void) pthread_mutex_destroy(&(device->mutex));
+         relabsd_virtual_device_destroy(&(device->virtual_device));
+         relabsd_physical_device_close(&(device->physical_device));
+
+         return -4;
+      }
+
+      relabsd_virtual_device_set_capture_ring
+      (
+         device->capture_ring,
+         &(device->virtual_device)
+      );
+   }
+
+   device->pending_parameters = device->parameters;
+   device->is_in_batch = 0;
+   device->capture_dump_reply_position = 0;
+   atomic_init(&(device->parameters_generation), 0);
+   device->applied_parameters_generation = 0;
+   atomic_init(&(device->wakeup_is_needed), 0);
+   device->wakeup = -1;
+   device->has_replacement_virtual_device = 0;
+
+   for (i = 0; i < RELABSD_AXIS_VALID_AXES_COUNT; ++i)
+   {
+      device->axes_state.inputs[i] = 0;
+      device->axes_state.values[i] = 0;
+      atomic_init((device->axes_state.published_inputs + i), 0);
+      atomic_init((device->axes_state.published_values + i), 0);
+   }
+
+   atomic_init(&(device->axes_state.sequence), 0);
+   atomic_init(&(device->axes_state.frame_count), 0);
+   atomic_init(&(device->axes_state.subscribers_count), 0);
+
+   relabsd_server_update_conversion_table(device);
+   relabsd_server_initialize_statistics(device);
+   relabsd_latency_histogram_initialize(&(device->latency_histogram));
+
+   return 0;
+}
+
+static void finalize_device
+(
+   struct relabsd_server_device device [const restrict static 1]
+)
+{
+   if (device->has_replacement_virtual_device)
+   {
+      relabsd_virtual_device_destroy(&(device->replacement_virtual_device));
+   }
+
+   relabsd_virtual_device_destroy(&(device->virtual_device));
+   relabsd_physical_device_close(&(device->physical_device));
+
+   if (device->capture_ring != (struct relabsd_capture_ring *) NULL)
+   {
+      relabsd_capture_ring_destroy(device->capture_ring);
+   }
+
+   (void) pthread_mutex_destroy(&(device->mutex));
+}
+
+static void finalize_devices
+(
+   struct relabsd_server server [const restrict static 1]
+)
+{
+   int i;
+
+   for (i = 0; i < server->devices_count; ++i)
+   {
+      finalize_device(server->devices + i);
+   }
+
+   free((void *) server->devices);
+
+   server->devices = (struct relabsd_server_device *) NULL;
+   server->devices_count = 0;
+}
+
+static int initialize_devices
+(
+   struct relabsd_server server [const restrict static 1]
+)
+{
+   int i, devices_count;
+
+   devices_count =
+      (
+         1
+         + relabsd_parameters_get_additional_devices_count
+         (
+            &(server->parameters)
+         )
+      );
+
+   errno = 0;
+
+   server->devices =
+      (struct relabsd_server_device *) calloc
+      (
+         (size_t) devices_count,
+         sizeof(struct relabsd_server_device)
+      );
+
+   server->devices_count = 0;
+
+   if (server->devices == (struct relabsd_server_device *) NULL)
+   {
+      RELABSD_FATAL
+      (
+         "Could not allocate memory for the server's devices: %s.",
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   for (i = 0; i < devices_count; ++i)
+   {
+      if (i == 0)
+      {
+         server->devices[i].parameters = server->parameters;
+      }
+      else if
+      (
+         relabsd_parameters_initialize_additional_device
+         (
+            &(server->parameters),
+            (i - 1),
+            &(server->devices[i].parameters)
+         )
+         < 0
+      )
+      {
+         finalize_devices(server);
+
+         return -1;
+      }
+
+      if (initialize_device(server->devices + i) < 0)
+      {
+         finalize_devices(server);
+
+         return -1;
+      }
+
+      server->devices_count = (i + 1);
+   }
+
+   return 0;
+}
+
+static int initialize
+(
+   struct relabsd_server server [const restrict static 1]
+)
+{
+   server->conversion_thread_count =
+      relabsd_parameters_get_workers_count(&(server->parameters));
+
+   if (relabsd_server_initialize_signal_handlers() < 0)
+   {
+      return -1;
+   }
+
+   if (relabsd_server_initialize_subscriptions() < 0)
+   {
+      relabsd_server_finalize_signal_handlers();
+
+      return -2;
+   }
+
+   if (initialize_devices(server) < 0)
+   {
+      relabsd_server_finalize_subscriptions();
+      relabsd_server_finalize_signal_handlers();
+
+      return -3;
+   }
+
+   if (relabsd_server_create_shared_state(server) < 0)
+   {
+      finalize_devices(server);
+      relabsd_server_finalize_subscriptions();
+      relabsd_server_finalize_signal_handlers();
+
+      return -4;
+   }
+
+   if (relabsd_server_create_output_rings(server) < 0)
+   {
+      relabsd_server_destroy_shared_state(server);
+      finalize_devices(server);
+      relabsd_server_finalize_subscriptions();
+      relabsd_server_finalize_signal_handlers();
+
+      return -5;
+   }
+
+   if (relabsd_server_initialize_conversion(server) < 0)
+   {
+      relabsd_server_destroy_output_rings(server);
+      relabsd_server_destroy_shared_state(server);
+      finalize_devices(server);
+      relabsd_server_finalize_subscriptions();
+      relabsd_server_finalize_signal_handlers();
+
+      return -6;
+   }
+
+   /* Everything the conversion needs has been allocated by now. */
+   if (relabsd_server_lock_memory(server) < 0)
+   {
+      relabsd_server_finalize_conversion(server);
+      relabsd_server_destroy_output_rings(server);
+      relabsd_server_destroy_shared_state(server);
+      finalize_devices(server);
+      relabsd_server_finalize_subscriptions();
+      relabsd_server_finalize_signal_handlers();
+
+      return -7;
    }
 
    if
@@ -75,10 +319,62 @@ static int initialize
       && (relabsd_server_create_communication_thread(server) < 0)
    )
    {
-      relabsd_virtual_device_destroy(&(server->virtual_device));
-      relabsd_physical_device_close(&(server->physical_device));
+      relabsd_server_finalize_conversion(server);
+      relabsd_server_destroy_output_rings(server);
+      relabsd_server_destroy_shared_state(server);
+      finalize_devices(server);
+      relabsd_server_finalize_subscriptions();
+      relabsd_server_finalize_signal_handlers();
 
-      return -4;
+      return -8;
+   }
+
+   if (relabsd_server_create_stall_watchdog(server) < 0)
+   {
+      relabsd_server_interrupt();
+
+      if
+      (
+         relabsd_parameters_get_communication_node_name(&(server->parameters))
+         != ((char *) NULL)
+      )
+      {
+         relabsd_server_join_communication_thread(server);
+      }
+
+      relabsd_server_finalize_conversion(server);
+      relabsd_server_destroy_output_rings(server);
+      relabsd_server_destroy_shared_state(server);
+      finalize_devices(server);
+      relabsd_server_finalize_subscriptions();
+      relabsd_server_finalize_signal_handlers();
+
+      return -9;
+   }
+
+   if (relabsd_server_create_conversion_threads(server) < 0)
+   {
+      relabsd_server_interrupt();
+      relabsd_server_join_conversion_threads(server);
+      relabsd_server_join_stall_watchdog(server);
+
+      if
+      (
+         relabsd_parameters_get_communication_node_name(&(server->parameters))
+         != ((char *) NULL)
+      )
+      {
+         relabsd_server_join_communication_thread(server);
+      }
+
+      relabsd_server_finalize_conversion(server);
+      relabsd_server_destroy_output_rings(server);
+      relabsd_server_destroy_shared_state(server);
+      finalize_devices(server);
+      relabsd_server_finalize_subscriptions();
+      relabsd_server_finalize_signal_handlers();
+
+      return -10;
    }
 
    return 0;
@@ -95,10 +391,15 @@ static void finalize (struct relabsd_server server [const static 1])
       relabsd_server_join_communication_thread(server);
    }
 
-   relabsd_virtual_device_destroy(&(server->virtual_device));
-   relabsd_physical_device_close(&(server->physical_device));
+   relabsd_server_join_conversion_threads(server);
+   relabsd_server_join_stall_watchdog(server);
 
-   (void) pthread_mutex_destroy(&(server->mutex));
+   relabsd_server_finalize_conversion(server);
+   relabsd_server_destroy_output_rings(server);
+   relabsd_server_destroy_shared_state(server);
+   finalize_devices(server);
+
+   relabsd_server_finalize_subscriptions();
    relabsd_server_finalize_signal_handlers();
 }
 
@@ -132,15 +433,23 @@ int relabsd_server_main
       return -2;
    }
 
+   /* Messages are still written if it fails, only not as efficiently. */
+   (void) relabsd_log_start();
+
    if (initialize(&server) < 0)
    {
+      relabsd_log_stop();
+
       return -1;
    }
 
+   /* The current thread is the first conversion thread. */
    (void) relabsd_server_conversion_loop(&server);
 
    finalize(&server);
 
+   relabsd_log_stop();
+
    RELABSD_S_DEBUG(RELABSD_DEBUG_PROGRAM_FLOW, "Completed server mode.");
 
    return 0;
@@ -0,0 +1,222 @@
+/**** POSIX *******************************************************************/
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+/**** RELABSD *****************************************************************/
+#include <relabsd/debug.h>
+#include <relabsd/server.h>
+#include <relabsd/shared_state_types.h>
+
+#include <relabsd/config/parameters.h>
+
+/******************************************************************************/
+/**** LOCAL FUNCTIONS *********************************************************/
+/******************************************************************************/
+
+/******************************************************************************/
+/**** EXPORTED FUNCTIONS ******************************************************/
+/******************************************************************************/
+int relabsd_server_create_shared_state
+(
+   struct relabsd_server server [const static 1]
+)
+{
+   const char * name;
+   void * region;
+   size_t size;
+   int file, i;
+
+   name = relabsd_parameters_get_shared_memory_name(&(server->parameters));
+
+   server->shared_state = (struct relabsd_shared_state *) NULL;
+
+   for (i = 0; i < server->devices_count; ++i)
+   {
+      server->devices[i].shared_state =
+         (struct relabsd_shared_device_state *) NULL;
+   }
+
+   if (name == (const char *) NULL)
+   {
+      return 0;
+   }
+
+   size =
+      (
+         sizeof(struct relabsd_shared_state)
+         + (
+            ((size_t) server->devices_count)
+            * sizeof(struct relabsd_shared_device_state)
+         )
+      );
+
+   errno = 0;
+
+   file = shm_open(name, (O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC), 0644);
+
+   if (file == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to create the shared memory object \"%s\": %s.",
+         name,
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   errno = 0;
+
+   if (ftruncate(file, (off_t) size) == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to resize the shared memory object \"%s\": %s.",
+         name,
+         strerror(errno)
+      );
+
+      (void) close(file);
+      (void) shm_unlink(name);
+
+      return -1;
+   }
+
+   errno = 0;
+
+   region = mmap(NULL, size, (PROT_READ | PROT_WRITE), MAP_SHARED, file, 0);
+
+   /* The mapping stays valid without it. */
+   (void) close(file);
+
+   if (region == MAP_FAILED)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to map the shared memory object \"%s\": %s.",
+         name,
+         strerror(errno)
+      );
+
+      (void) shm_unlink(name);
+
+      return -1;
+   }
+
+   /* 'ftruncate' zeroed it, which is a valid state for every device. */
+   server->shared_state = (struct relabsd_shared_state *) region;
+   server->shared_state_size = size;
+   server->shared_state->devices_count = (uint32_t) server->devices_count;
+
+   for (i = 0; i < server->devices_count; ++i)
+   {
+      server->devices[i].shared_state = (server->shared_state->devices + i);
+   }
+
+   /* Readers check this last. */
+   (void) memcpy
+   (
+      (void *) server->shared_state->magic,
+      (const void *) RELABSD_SHARED_STATE_MAGIC,
+      RELABSD_SHARED_STATE_MAGIC_SIZE
+   );
+
+   atomic_thread_fence(memory_order_release);
+
+   return 0;
+}
+
+void relabsd_server_destroy_shared_state
+(
+   struct relabsd_server server [const static 1]
+)
+{
+   if (server->shared_state == (struct relabsd_shared_state *) NULL)
+   {
+      return;
+   }
+
+   (void) munmap((void *) server->shared_state, server->shared_state_size);
+   (void) shm_unlink
+   (
+      relabsd_parameters_get_shared_memory_name(&(server->parameters))
+   );
+
+   server->shared_state = (struct relabsd_shared_state *) NULL;
+}
+
+void relabsd_server_write_shared_state
+(
+   struct relabsd_server_device device [const static 1]
+)
+{
+   struct relabsd_shared_device_state * const shared_state =
+      device->shared_state;
+   struct relabsd_server_axes_state * const axes_state = &(device->axes_state);
+   uint32_t sequence;
+   int i;
+
+   /* Only the thread converting the device writes to it. */
+   sequence =
+      atomic_load_explicit(&(shared_state->sequence), memory_order_relaxed);
+
+   atomic_store_explicit
+   (
+      &(shared_state->sequence),
+      (sequence + 1),
+      memory_order_relaxed
+   );
+
+   /* Readers that see any of the following also see the odd sequence. */
+   atomic_thread_fence(memory_order_release);
+
+   atomic_store_explicit
+   (
+      &(shared_state->frame),
+      (uint64_t) atomic_load_explicit
+      (
+         &(axes_state->frame_count),
+         memory_order_relaxed
+      ),
+      memory_order_relaxed
+   );
+
+   for (i = 0; i < RELABSD_AXIS_VALID_AXES_COUNT; ++i)
+   {
+      atomic_store_explicit
+      (
+         (shared_state->inputs + i),
+         (int32_t) axes_state->inputs[i],
+         memory_order_relaxed
+      );
+
+      atomic_store_explicit
+      (
+         (shared_state->values + i),
+         (int32_t) axes_state->values[i],
+         memory_order_relaxed
+      );
+
+      atomic_store_explicit
+      (
+         (shared_state->previous_values + i),
+         (int32_t) device->parameters.axes[i].previous_value,
+         memory_order_relaxed
+      );
+   }
+
+   atomic_store_explicit
+   (
+      &(shared_state->sequence),
+      (sequence + 2),
+      memory_order_release
+   );
+}
@@ -0,0 +1,602 @@
+/**** POSIX *******************************************************************/
+/* To get the 'ppoll' function. */
+#define _GNU_SOURCE
+
+#include <sys/eventfd.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**** RELABSD *****************************************************************/
+#include <relabsd/debug.h>
+#include <relabsd/server.h>
+
+#include <relabsd/config/parameters.h>
+
+#include <relabsd/util/counter.h>
+
+/*
+ * The stall watchdog waits on this eventfd while no device is being handled.
+ * The conversion threads only write to it once the watchdog has said it is
+ * waiting, so that handling a device is not slowed down otherwise.
+ */
+static int RELABSD_STALL_WATCHDOG_FILE = -1;
+static atomic_int RELABSD_STALL_WATCHDOG_IS_WAITING;
+
+/******************************************************************************/
+/**** LOCAL FUNCTIONS *********************************************************/
+/******************************************************************************/
+static long int get_elapsed_nanoseconds
+(
+   const struct timespec start [const restrict static 1],
+   const struct timespec end [const restrict static 1]
+)
+{
+   long int result;
+
+   result =
+      (
+         ((long int) (end->tv_sec - start->tv_sec)) * 1000000000L
+         + (end->tv_nsec - start->tv_nsec)
+      );
+
+   /* Guards against unreliable clocks. */
+   if (result < 0)
+   {
+      return 0;
+   }
+
+   return result;
+}
+
+static void record_stall
+(
+   struct relabsd_server_device device [const static 1],
+   const long int microseconds
+)
+{
+   struct relabsd_server_stall_monitor * const monitor =
+      &(device->stall_monitor);
+   int i, stage;
+
+   stage = 0;
+
+   for (i = 1; i < RELABSD_SERVER_CONVERSION_STAGES_COUNT; ++i)
+   {
+      if (monitor->stage_nanoseconds[i] > monitor->stage_nanoseconds[stage])
+      {
+         stage = i;
+      }
+   }
+
+   RELABSD_COUNTER_ADD
+   (
+      device->statistics.stalls[stage] + RELABSD_SERVER_STALLS,
+      1
+   );
+
+   RELABSD_COUNTER_ADD
+   (
+      device->statistics.stalls[stage] + RELABSD_SERVER_STALL_MICROSECONDS,
+      (unsigned long int) microseconds
+   );
+
+   RELABSD_WARNING
+   (
+      "Stalled for %ldus (budget: %ldus) while converting \"%s\", %ldus of"
+      " which were spent in the \"%s\" stage.",
+      microseconds,
+      monitor->budget,
+      relabsd_parameters_get_physical_device_file_name(&(device->parameters)),
+      (monitor->stage_nanoseconds[stage] / 1000L),
+      relabsd_server_get_conversion_stage_name
+      (
+         (enum relabsd_server_conversion_stage) stage
+      )
+   );
+}
+
+/*
+ * Returns 1 if the device is being handled, or was since the previous check,
+ *         0 otherwise.
+ */
+static int check_ongoing_stall
+(
+   const struct timespec now [const restrict static 1],
+   const int index,
+   struct relabsd_server_device device [const static 1]
+)
+{
+   struct relabsd_server_stall_monitor * const monitor =
+      &(device->stall_monitor);
+   long long int handling_start, microseconds;
+   unsigned long int handlings_count;
+   int is_active;
+
+   handlings_count =
+      atomic_load_explicit(&(monitor->handlings_count), memory_order_relaxed);
+
+   is_active = (handlings_count != monitor->watched_handlings_count);
+
+   monitor->watched_handlings_count = handlings_count;
+
+   handling_start =
+      atomic_load_explicit
+      (
+         &(monitor->ongoing_handling_start),
+         memory_order_acquire
+      );
+
+   if (handling_start == 0)
+   {
+      return is_active;
+   }
+
+   /* Only reported once per handling. */
+   if (handling_start == monitor->reported_handling_start)
+   {
+      return 1;
+   }
+
+   microseconds =
+      (
+         (
+            ((long long int) now->tv_sec) * 1000000000LL
+            + ((long long int) now->tv_nsec)
+            - handling_start
+         )
+         / 1000LL
+      );
+
+   if (microseconds <= monitor->budget)
+   {
+      return 1;
+   }
+
+   monitor->reported_handling_start = handling_start;
+
+   /* By index, as its parameters belong to the conversion thread. */
+   RELABSD_WARNING
+   (
+      "Stalling for %lldus (budget: %ldus) while converting device #%d, which"
+      " is still in the \"%s\" stage.",
+      microseconds,
+      monitor->budget,
+      index,
+      relabsd_server_get_conversion_stage_name
+      (
+         (enum relabsd_server_conversion_stage) atomic_load_explicit
+         (
+            &(monitor->ongoing_stage),
+            memory_order_relaxed
+         )
+      )
+   );
+
+   return 1;
+}
+
+/*
+ * Says the watchdog is about to wait, unless a device is already being
+ * handled.
+ *
+ * Returns 1 if the watchdog can wait,
+ *         0 otherwise.
+ */
+static int prepare_to_wait (struct relabsd_server server [const static 1])
+{
+   int i;
+
+   atomic_store(&RELABSD_STALL_WATCHDOG_IS_WAITING, 1);
+
+   /*
+    * Conversion threads set the start of the handling before checking whether
+    * the watchdog waits, so either they see it, or this sees the handling.
+    */
+   for (i = 0; i < server->devices_count; ++i)
+   {
+      if
+      (
+         atomic_load(&(server->devices[i].stall_monitor.ongoing_handling_start))
+         != 0
+      )
+      {
+         atomic_store(&RELABSD_STALL_WATCHDOG_IS_WAITING, 0);
+
+         return 0;
+      }
+   }
+
+   return 1;
+}
+
+static void watch_stalls (struct relabsd_server server [const static 1])
+{
+   struct pollfd files[2];
+   struct timespec period, now;
+   uint64_t wakeups;
+   long int budget;
+   int i, is_active;
+
+   budget =
+      (long int) relabsd_parameters_get_stall_budget(&(server->parameters));
+
+   period.tv_sec = (budget / 1000000L);
+   period.tv_nsec = ((budget % 1000000L) * 1000L);
+
+   files[0].fd = relabsd_server_get_interruption_file_descriptor();
+   files[0].events = POLLIN;
+   files[1].fd = RELABSD_STALL_WATCHDOG_FILE;
+   files[1].events = POLLIN;
+
+   is_active = 1;
+
+   for (;;)
+   {
+      errno = 0;
+
+      if
+      (
+         (
+            ppoll
+            (
+               files,
+               2,
+               (is_active ? &period : (const struct timespec *) NULL),
+               (const sigset_t *) NULL
+            )
+            == -1
+         )
+         && (errno != EINTR)
+      )
+      {
+         RELABSD_ERROR
+         (
+            "The stall watchdog is unable to wait: %s. Only the stalls that"
+            " ended will be reported.",
+            strerror(errno)
+         );
+
+         return;
+      }
+
+      if (!relabsd_server_keep_running())
+      {
+         return;
+      }
+
+      /* It is nonblocking, and may just not have been written to. */
+      (void) read
+      (
+         RELABSD_STALL_WATCHDOG_FILE,
+         (void *) &wakeups,
+         sizeof(uint64_t)
+      );
+
+      (void) clock_gettime(CLOCK_MONOTONIC, &now);
+
+      is_active = 0;
+
+      for (i = 0; i < server->devices_count; ++i)
+      {
+         if (check_ongoing_stall(&now, i, (server->devices + i)))
+         {
+            is_active = 1;
+         }
+      }
+
+      if (!is_active)
+      {
+         is_active = !prepare_to_wait(server);
+      }
+   }
+}
+
+static void * posix_watch_stalls (void * params)
+{
+   watch_stalls((struct relabsd_server *) params);
+
+   return NULL;
+}
+
+/******************************************************************************/
+/**** EXPORTED FUNCTIONS ******************************************************/
+/******************************************************************************/
+void relabsd_server_initialize_stall_monitor
+(
+   const long int budget,
+   struct relabsd_server_device device [const static 1]
+)
+{
+   device->stall_monitor.budget = budget;
+   device->stall_monitor.reported_handling_start = 0;
+   device->stall_monitor.watched_handlings_count = 0;
+
+   atomic_init(&(device->stall_monitor.ongoing_handling_start), 0);
+   atomic_init(&(device->stall_monitor.ongoing_stage), 0);
+   atomic_init(&(device->stall_monitor.handlings_count), 0);
+
+   /* The device can be given a stage before it is first handled. */
+   relabsd_server_start_stall_monitoring
+   (
+      RELABSD_SERVER_PARAMETERS_STAGE,
+      device
+   );
+
+   /* It is not handled yet, though. */
+   atomic_store_explicit
+   (
+      &(device->stall_monitor.ongoing_handling_start),
+      0,
+      memory_order_relaxed
+   );
+}
+
+void relabsd_server_start_stall_monitoring
+(
+   const enum relabsd_server_conversion_stage stage,
+   struct relabsd_server_device device [const static 1]
+)
+{
+   const uint64_t increment = 1;
+   struct relabsd_server_stall_monitor * const monitor =
+      &(device->stall_monitor);
+   int i;
+
+   if (monitor->budget == 0)
+   {
+      return;
+   }
+
+   for (i = 0; i < RELABSD_SERVER_CONVERSION_STAGES_COUNT; ++i)
+   {
+      monitor->stage_nanoseconds[i] = 0;
+   }
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &(monitor->handling_start));
+
+   monitor->stage = stage;
+   monitor->stage_start = monitor->handling_start;
+
+   atomic_store_explicit
+   (
+      &(monitor->ongoing_stage),
+      (int) stage,
+      memory_order_relaxed
+   );
+
+   /* Only this thread modifies it. */
+   atomic_store_explicit
+   (
+      &(monitor->handlings_count),
+      (
+         atomic_load_explicit(&(monitor->handlings_count), memory_order_relaxed)
+         + 1
+      ),
+      memory_order_relaxed
+   );
+
+   /* The watchdog that sees this also sees the stage. */
+   atomic_store
+   (
+      &(monitor->ongoing_handling_start),
+      (
+         ((long long int) monitor->handling_start.tv_sec) * 1000000000LL
+         + ((long long int) monitor->handling_start.tv_nsec)
+      )
+   );
+
+   if
+   (
+      atomic_load_explicit
+      (
+         &RELABSD_STALL_WATCHDOG_IS_WAITING,
+         memory_order_seq_cst
+      )
+      && atomic_exchange(&RELABSD_STALL_WATCHDOG_IS_WAITING, 0)
+   )
+   {
+      /* Can only fail if the counter overflows, which still wakes it up. */
+      (void) write
+      (
+         RELABSD_STALL_WATCHDOG_FILE,
+         (const void *) &increment,
+         sizeof(uint64_t)
+      );
+   }
+}
+
+void relabsd_server_enter_conversion_stage
+(
+   const enum relabsd_server_conversion_stage stage,
+   struct relabsd_server_device device [const static 1]
+)
+{
+   struct relabsd_server_stall_monitor * const monitor =
+      &(device->stall_monitor);
+   struct timespec now;
+
+   if ((monitor->budget == 0) || (monitor->stage == stage))
+   {
+      return;
+   }
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &now);
+
+   monitor->stage_nanoseconds[monitor->stage] +=
+      get_elapsed_nanoseconds(&(monitor->stage_start), &now);
+
+   monitor->stage = stage;
+   monitor->stage_start = now;
+
+   atomic_store_explicit
+   (
+      &(monitor->ongoing_stage),
+      (int) stage,
+      memory_order_relaxed
+   );
+}
+
+void relabsd_server_stop_stall_monitoring
+(
+   struct relabsd_server_device device [const static 1]
+)
+{
+   struct relabsd_server_stall_monitor * const monitor =
+      &(device->stall_monitor);
+   struct timespec now;
+   long int microseconds;
+
+   if (monitor->budget == 0)
+   {
+      return;
+   }
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &now);
+
+   atomic_store_explicit
+   (
+      &(monitor->ongoing_handling_start),
+      0,
+      memory_order_relaxed
+   );
+
+   monitor->stage_nanoseconds[monitor->stage] +=
+      get_elapsed_nanoseconds(&(monitor->stage_start), &now);
+
+   microseconds =
+      (get_elapsed_nanoseconds(&(monitor->handling_start), &now) / 1000L);
+
+   if (microseconds > monitor->budget)
+   {
+      record_stall(device, microseconds);
+   }
+}
+
+int relabsd_server_create_stall_watchdog
+(
+   struct relabsd_server server [const static 1]
+)
+{
+   int err;
+
+   if (relabsd_parameters_get_stall_budget(&(server->parameters)) == 0)
+   {
+      return 0;
+   }
+
+   errno = 0;
+
+   RELABSD_STALL_WATCHDOG_FILE = eventfd(0, (EFD_CLOEXEC | EFD_NONBLOCK));
+
+   if (RELABSD_STALL_WATCHDOG_FILE == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to create an eventfd for the stall watchdog: %s",
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   err =
+      pthread_create
+      (
+         &(server->stall_watchdog),
+         (const pthread_attr_t *) NULL,
+         posix_watch_stalls,
+         (void *) server
+      );
+
+   if (err != 0)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to create the stall watchdog: %s",
+         strerror(err)
+      );
+
+      (void) close(RELABSD_STALL_WATCHDOG_FILE);
+      RELABSD_STALL_WATCHDOG_FILE = -1;
+
+      return -1;
+   }
+
+   if
+   (
+      relabsd_server_set_stall_watchdog_scheduling
+      (
+         server,
+         server->stall_watchdog
+      )
+      < 0
+   )
+   {
+      /* The watchdog only stops once the server is interrupted. */
+      relabsd_server_interrupt();
+
+      (void) relabsd_server_join_stall_watchdog(server);
+
+      return -1;
+   }
+
+   return 0;
+}
+
+int relabsd_server_join_stall_watchdog
+(
+   struct relabsd_server server [const static 1]
+)
+{
+   int err;
+
+   if (relabsd_parameters_get_stall_budget(&(server->parameters)) == 0)
+   {
+      return 0;
+   }
+
+   err = pthread_join(server->stall_watchdog, (void **) NULL);
+
+   (void) close(RELABSD_STALL_WATCHDOG_FILE);
+   RELABSD_STALL_WATCHDOG_FILE = -1;
+
+   if (err != 0)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to join with the stall watchdog: %s",
+         strerror(err)
+      );
+
+      return -1;
+   }
+
+   return 0;
+}
+
+const char * relabsd_server_get_conversion_stage_name
+(
+   const enum relabsd_server_conversion_stage stage
+)
+{
+   /* In the same order as 'enum relabsd_server_conversion_stage'. */
+   static const char * const names[RELABSD_SERVER_CONVERSION_STAGES_COUNT] =
+      {
+         "parameters",
+         "reading",
+         "converting",
+         "writing",
+         "publishing",
+         "timer",
+         "resetting"
+      };
+
+   return names[stage];
+}
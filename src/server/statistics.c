@@ -0,0 +1,194 @@
+/**** POSIX *******************************************************************/
+#include <stdatomic.h>
+#include <time.h>
+
+/**** RELABSD *****************************************************************/
+#include <relabsd/server.h>
+
+#include <relabsd/util/counter.h>
+
+/******************************************************************************/
+/**** LOCAL FUNCTIONS *********************************************************/
+/******************************************************************************/
+
+/******************************************************************************/
+/**** EXPORTED FUNCTIONS ******************************************************/
+/******************************************************************************/
+void relabsd_server_initialize_statistics
+(
+   struct relabsd_server_device device [const static 1]
+)
+{
+   struct relabsd_server_statistics * const statistics =
+      &(device->statistics);
+   int i, j;
+
+   for (i = 0; i < RELABSD_SERVER_STATISTICS_COUNT; ++i)
+   {
+      atomic_init((statistics->counters + i), 0);
+      statistics->baseline[i] = 0;
+   }
+
+   for (i = 0; i < RELABSD_AXIS_VALID_AXES_COUNT; ++i)
+   {
+      for (j = 0; j < RELABSD_AXIS_STATISTICS_COUNT; ++j)
+      {
+         atomic_init((statistics->axes[i] + j), 0);
+         statistics->axes_baseline[i][j] = 0;
+      }
+   }
+
+   for (i = 0; i < RELABSD_SERVER_CONVERSION_STAGES_COUNT; ++i)
+   {
+      for (j = 0; j < RELABSD_SERVER_STALL_STATISTICS_COUNT; ++j)
+      {
+         atomic_init((statistics->stalls[i] + j), 0);
+         statistics->stalls_baseline[i][j] = 0;
+      }
+   }
+
+   statistics->longest_mutex_hold_microseconds = 0;
+}
+
+void relabsd_server_record_mutex_hold
+(
+   struct relabsd_server_device device [const static 1],
+   const struct timespec start [const restrict static 1]
+)
+{
+   struct relabsd_server_statistics * const statistics =
+      &(device->statistics);
+   struct timespec now;
+   long int microseconds;
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &now);
+
+   microseconds =
+      (
+         ((long int) (now.tv_sec - start->tv_sec)) * 1000000L
+         + ((now.tv_nsec - start->tv_nsec) / 1000L)
+      );
+
+   if (microseconds < 0)
+   {
+      microseconds = 0;
+   }
+
+   RELABSD_COUNTER_ADD(statistics->counters + RELABSD_SERVER_MUTEX_HOLDS, 1);
+   RELABSD_COUNTER_ADD
+   (
+      statistics->counters + RELABSD_SERVER_MUTEX_HOLD_MICROSECONDS,
+      (unsigned long int) microseconds
+   );
+
+   if
+   (
+      ((unsigned long int) microseconds)
+      > statistics->longest_mutex_hold_microseconds
+   )
+   {
+      statistics->longest_mutex_hold_microseconds =
+         (unsigned long int) microseconds;
+   }
+}
+
+unsigned long int relabsd_server_get_statistic
+(
+   const struct relabsd_server_device device [const static 1],
+   const enum relabsd_server_statistic statistic
+)
+{
+   return
+      (
+         atomic_load_explicit
+         (
+            (device->statistics.counters + statistic),
+            memory_order_relaxed
+         )
+         - device->statistics.baseline[statistic]
+      );
+}
+
+unsigned long int relabsd_server_get_axis_statistic
+(
+   const struct relabsd_server_device device [const static 1],
+   const enum relabsd_axis_name axis_name,
+   const enum relabsd_axis_statistic statistic
+)
+{
+   return
+      (
+         atomic_load_explicit
+         (
+            (device->statistics.axes[axis_name] + statistic),
+            memory_order_relaxed
+         )
+         - device->statistics.axes_baseline[axis_name][statistic]
+      );
+}
+
+unsigned long int relabsd_server_get_stall_statistic
+(
+   const struct relabsd_server_device device [const static 1],
+   const enum relabsd_server_conversion_stage stage,
+   const enum relabsd_server_stall_statistic statistic
+)
+{
+   return
+      (
+         atomic_load_explicit
+         (
+            (device->statistics.stalls[stage] + statistic),
+            memory_order_relaxed
+         )
+         - device->statistics.stalls_baseline[stage][statistic]
+      );
+}
+
+void relabsd_server_reset_statistics
+(
+   struct relabsd_server_device device [const static 1]
+)
+{
+   struct relabsd_server_statistics * const statistics =
+      &(device->statistics);
+   int i, j;
+
+   for (i = 0; i < RELABSD_SERVER_STATISTICS_COUNT; ++i)
+   {
+      statistics->baseline[i] =
+         atomic_load_explicit
+         (
+            (statistics->counters + i),
+            memory_order_relaxed
+         );
+   }
+
+   for (i = 0; i < RELABSD_AXIS_VALID_AXES_COUNT; ++i)
+   {
+      for (j = 0; j < RELABSD_AXIS_STATISTICS_COUNT; ++j)
+      {
+         statistics->axes_baseline[i][j] =
+            atomic_load_explicit
+            (
+               (statistics->axes[i] + j),
+               memory_order_relaxed
+            );
+      }
+   }
+
+   for (i = 0; i < RELABSD_SERVER_CONVERSION_STAGES_COUNT; ++i)
+   {
+      for (j = 0; j < RELABSD_SERVER_STALL_STATISTICS_COUNT; ++j)
+      {
+         statistics->stalls_baseline[i][j] =
+            atomic_load_explicit
+            (
+               (statistics->stalls[i] + j),
+               memory_order_relaxed
+            );
+      }
+   }
+
+   statistics->longest_mutex_hold_microseconds = 0;
+}
@@ -0,0 +1,381 @@
+/**** POSIX *******************************************************************/
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+/**** RELABSD *****************************************************************/
+#include <relabsd/config.h>
+#include <relabsd/debug.h>
+#include <relabsd/protocol_types.h>
+#include <relabsd/server.h>
+
+/******************************************************************************/
+/**** LOCAL FUNCTIONS *********************************************************/
+/******************************************************************************/
+#define RELABSD_AXES_STATE_MESSAGE_SIZE \
+   ( \
+      sizeof(struct relabsd_protocol_frame_header) \
+      + sizeof(struct relabsd_protocol_reply_header) \
+      + sizeof(struct relabsd_protocol_axes_state) \
+   )
+
+/*
+ * The conversion threads write to this eventfd when a subscribed device
+ * completes a frame. They only do so if the communication thread has handled
+ * the previous notification, so that a fast device does not wake it up for
+ * every single frame.
+ */
+static int RELABSD_SUBSCRIPTIONS_FILE = -1;
+static atomic_int RELABSD_SUBSCRIPTIONS_ARE_NOTIFIED;
+
+static void notify_subscriptions (void)
+{
+   const uint64_t increment = 1;
+
+   errno = 0;
+
+   if
+   (
+      write
+      (
+         RELABSD_SUBSCRIPTIONS_FILE,
+         (const void *) &increment,
+         sizeof(uint64_t)
+      )
+      == -1
+   )
+   {
+      RELABSD_ERROR
+      (
+         "Unable to notify the communication thread of new axes states: %s.",
+         strerror(errno)
+      );
+   }
+}
+
+/******************************************************************************/
+/**** EXPORTED FUNCTIONS ******************************************************/
+/******************************************************************************/
+int relabsd_server_initialize_subscriptions (void)
+{
+   errno = 0;
+
+   RELABSD_SUBSCRIPTIONS_FILE = eventfd(0, (EFD_CLOEXEC | EFD_NONBLOCK));
+
+   if (RELABSD_SUBSCRIPTIONS_FILE == -1)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to create an eventfd for the subscriptions: %s",
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   atomic_init(&RELABSD_SUBSCRIPTIONS_ARE_NOTIFIED, 0);
+
+   return 0;
+}
+
+void relabsd_server_finalize_subscriptions (void)
+{
+   (void) close(RELABSD_SUBSCRIPTIONS_FILE);
+
+   RELABSD_SUBSCRIPTIONS_FILE = -1;
+}
+
+int relabsd_server_get_subscriptions_file_descriptor (void)
+{
+   return RELABSD_SUBSCRIPTIONS_FILE;
+}
+
+void relabsd_server_publish_axes_state
+(
+   struct relabsd_server_device device [const static 1]
+)
+{
+   struct relabsd_server_axes_state * const axes_state = &(device->axes_state);
+   unsigned int sequence;
+   int i;
+
+   /* Only the thread converting the device modifies it. */
+   sequence =
+      atomic_load_explicit(&(axes_state->sequence), memory_order_relaxed);
+
+   atomic_store_explicit
+   (
+      &(axes_state->sequence),
+      (sequence + 1),
+      memory_order_relaxed
+   );
+
+   /* Readers that see any of the following also see the odd sequence. */
+   atomic_thread_fence(memory_order_release);
+
+   atomic_store_explicit
+   (
+      &(axes_state->frame_count),
+      (
+         atomic_load_explicit(&(axes_state->frame_count), memory_order_relaxed)
+         + 1
+      ),
+      memory_order_relaxed
+   );
+
+   for (i = 0; i < RELABSD_AXIS_VALID_AXES_COUNT; ++i)
+   {
+      atomic_store_explicit
+      (
+         (axes_state->published_inputs + i),
+         axes_state->inputs[i],
+         memory_order_relaxed
+      );
+
+      atomic_store_explicit
+      (
+         (axes_state->published_values + i),
+         axes_state->values[i],
+         memory_order_relaxed
+      );
+   }
+
+   atomic_store_explicit
+   (
+      &(axes_state->sequence),
+      (sequence + 2),
+      memory_order_release
+   );
+
+   if
+   (
+      (
+         atomic_load_explicit
+         (
+            &(axes_state->subscribers_count),
+            memory_order_relaxed
+         )
+         > 0
+      )
+      && !atomic_exchange(&RELABSD_SUBSCRIPTIONS_ARE_NOTIFIED, 1)
+   )
+   {
+      notify_subscriptions();
+   }
+}
+
+void relabsd_server_acknowledge_subscriptions_notification (void)
+{
+   uint64_t counter;
+
+   /* Frames completed after this get notified again. */
+   (void) atomic_exchange(&RELABSD_SUBSCRIPTIONS_ARE_NOTIFIED, 0);
+
+   (void) read
+   (
+      RELABSD_SUBSCRIPTIONS_FILE,
+      (void *) &counter,
+      sizeof(uint64_t)
+   );
+}
+
+void relabsd_server_subscribe
+(
+   struct relabsd_server_device device [const static 1],
+   struct relabsd_server_client client [const static 1]
+)
+{
+   /*
+    * Otherwise, the socket would queue a lot more states than the client's
+    * output does, and slow clients would keep getting outdated ones.
+    */
+   const int send_buffer_size =
+      (int)
+      (
+         RELABSD_SERVER_SUBSCRIPTION_QUEUE_SIZE
+         * RELABSD_AXES_STATE_MESSAGE_SIZE
+      );
+
+   relabsd_server_unsubscribe(client);
+
+   errno = 0;
+
+   if
+   (
+      setsockopt
+      (
+         client->socket,
+         SOL_SOCKET,
+         SO_SNDBUF,
+         (const void *) &send_buffer_size,
+         sizeof(int)
+      )
+      == -1
+   )
+   {
+      RELABSD_WARNING
+      (
+         "Unable to reduce the send buffer of a subscribed client: %s.",
+         strerror(errno)
+      );
+   }
+
+   client->subscription = device;
+   client->last_sent_frame =
+      atomic_load_explicit
+      (
+         &(device->axes_state.frame_count),
+         memory_order_acquire
+      );
+   client->has_missed_axes_states = 0;
+
+   (void) atomic_fetch_add(&(device->axes_state.subscribers_count), 1);
+}
+
+void relabsd_server_unsubscribe
+(
+   struct relabsd_server_client client [const static 1]
+)
+{
+   if (client->subscription == (struct relabsd_server_device *) NULL)
+   {
+      return;
+   }
+
+   (void) atomic_fetch_sub
+   (
+      &(client->subscription->axes_state.subscribers_count),
+      1
+   );
+
+   client->subscription = (struct relabsd_server_device *) NULL;
+}
+
+void relabsd_server_send_axes_state
+(
+   struct relabsd_server_client client [const static 1]
+)
+{
+   struct relabsd_protocol_frame_header frame_header;
+   struct relabsd_protocol_reply_header reply_header;
+   struct relabsd_protocol_axes_state state;
+   struct relabsd_server_axes_state * axes_state;
+   unsigned long int frame;
+   unsigned int before, after;
+   char * position;
+   int i;
+
+   if (client->subscription == (struct relabsd_server_device *) NULL)
+   {
+      return;
+   }
+
+   axes_state = &(client->subscription->axes_state);
+
+   frame =
+      atomic_load_explicit(&(axes_state->frame_count), memory_order_acquire);
+
+   if (frame == client->last_sent_frame)
+   {
+      client->has_missed_axes_states = 0;
+
+      return;
+   }
+
+   if
+   (
+      (
+         (client->output_length - client->output_index)
+         >=
+         (
+            RELABSD_SERVER_SUBSCRIPTION_QUEUE_SIZE
+            * RELABSD_AXES_STATE_MESSAGE_SIZE
+         )
+      )
+      ||
+      (
+         (sizeof(client->output) - client->output_length)
+         < RELABSD_AXES_STATE_MESSAGE_SIZE
+      )
+   )
+   {
+      /* The latest state is sent once the client has caught up. */
+      client->has_missed_axes_states = 1;
+
+      return;
+   }
+
+   /* So that its padding is not sent as is. */
+   (void) memset((void *) &state, 0, sizeof(state));
+
+   /* Only retried while the conversion thread copies a single frame. */
+   do
+   {
+      before =
+         atomic_load_explicit(&(axes_state->sequence), memory_order_acquire);
+
+      frame =
+         atomic_load_explicit(&(axes_state->frame_count), memory_order_relaxed);
+
+      for (i = 0; i < RELABSD_AXIS_VALID_AXES_COUNT; ++i)
+      {
+         state.inputs[i] =
+            (int32_t) atomic_load_explicit
+            (
+               (axes_state->published_inputs + i),
+               memory_order_relaxed
+            );
+
+         state.values[i] =
+            (int32_t) atomic_load_explicit
+            (
+               (axes_state->published_values + i),
+               memory_order_relaxed
+            );
+      }
+
+      atomic_thread_fence(memory_order_acquire);
+
+      after =
+         atomic_load_explicit(&(axes_state->sequence), memory_order_relaxed);
+   }
+   while (((before & 1) != 0) || (before != after));
+
+   state.frame = (uint64_t) frame;
+   state.skipped_frames = (uint32_t) (frame - client->last_sent_frame - 1);
+
+   frame_header.length = (uint32_t) (sizeof(reply_header) + sizeof(state));
+   reply_header.status = (int32_t) RELABSD_PROTOCOL_AXES_STATE;
+   reply_header.length = (uint32_t) sizeof(state);
+
+   position = (client->output + client->output_length);
+
+   (void) memcpy
+   (
+      (void *) position,
+      (const void *) &frame_header,
+      sizeof(frame_header)
+   );
+
+   position += sizeof(frame_header);
+
+   (void) memcpy
+   (
+      (void *) position,
+      (const void *) &reply_header,
+      sizeof(reply_header)
+   );
+
+   position += sizeof(reply_header);
+
+   (void) memcpy((void *) position, (const void *) &state, sizeof(state));
+
+   client->output_length += RELABSD_AXES_STATE_MESSAGE_SIZE;
+   client->last_sent_frame = frame;
+   client->has_missed_axes_states = 0;
+}
@@ -0,0 +1,391 @@
+/**** POSIX *******************************************************************/
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**** RELABSD *****************************************************************/
+#include <relabsd/debug.h>
+#include <relabsd/replay_types.h>
+
+#include <relabsd/util/capture_ring.h>
+
+/******************************************************************************/
+/**** LOCAL FUNCTIONS *********************************************************/
+/******************************************************************************/
+struct relabsd_capture_ring_copy
+{
+   uint64_t time;
+   uint16_t type;
+   uint16_t code;
+   int32_t value;
+};
+
+/*
+ * Copies the events that are still in the ring, oldest first.
+ *
+ * Returns the number of events copied.
+ */
+static size_t copy_events
+(
+   const struct relabsd_capture_ring ring [const static 1],
+   struct relabsd_capture_ring_copy copy [const restrict static 1]
+)
+{
+   const struct relabsd_capture_ring_event * event;
+   uint64_t start, end, first_valid, i;
+
+   end = atomic_load_explicit(&(ring->write_index), memory_order_acquire);
+
+   if (end > RELABSD_CAPTURE_RING_SIZE)
+   {
+      start = (end - RELABSD_CAPTURE_RING_SIZE);
+   }
+   else
+   {
+      start = 0;
+   }
+
+   for (i = start; i < end; ++i)
+   {
+      event = (ring->events + (i & (RELABSD_CAPTURE_RING_SIZE - 1)));
+
+      copy[i - start].time =
+         atomic_load_explicit(&(event->time), memory_order_relaxed);
+      copy[i - start].type =
+         atomic_load_explicit(&(event->type), memory_order_relaxed);
+      copy[i - start].code =
+         atomic_load_explicit(&(event->code), memory_order_relaxed);
+      copy[i - start].value =
+         atomic_load_explicit(&(event->value), memory_order_relaxed);
+   }
+
+   atomic_thread_fence(memory_order_acquire);
+
+   /* The event being written when this is read is not valid either. */
+   first_valid =
+      atomic_load_explicit(&(ring->write_index), memory_order_relaxed);
+
+   if (first_valid >= RELABSD_CAPTURE_RING_SIZE)
+   {
+      first_valid = (first_valid - RELABSD_CAPTURE_RING_SIZE + 1);
+   }
+   else
+   {
+      first_valid = 0;
+   }
+
+   if (first_valid <= start)
+   {
+      return (size_t) (end - start);
+   }
+
+   if (first_valid >= end)
+   {
+      return 0;
+   }
+
+   (void) memmove
+   (
+      (void *) copy,
+      (const void *) (copy + (first_valid - start)),
+      ((size_t) (end - first_valid) * sizeof(struct relabsd_capture_ring_copy))
+   );
+
+   return (size_t) (end - first_valid);
+}
+
+static FILE * open_trace
+(
+   const char file_name [const restrict static 1]
+)
+{
+   FILE * result;
+   int file;
+
+   errno = 0;
+
+   /* The server might have more rights than whoever chose the name. */
+   file =
+      open
+      (
+         file_name,
+         (O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC),
+         0644
+      );
+
+   if (file == -1)
+   {
+      RELABSD_ERROR
+      (
+         "Could not open capture file \"%s\" in write mode: %s.",
+         file_name,
+         strerror(errno)
+      );
+
+      return (FILE *) NULL;
+   }
+
+   result = fdopen(file, "wb");
+
+   if (result == (FILE *) NULL)
+   {
+      RELABSD_ERROR
+      (
+         "Could not open capture file \"%s\" in write mode: %s.",
+         file_name,
+         strerror(errno)
+      );
+
+      (void) close(file);
+
+      return (FILE *) NULL;
+   }
+
+   if
+   (
+      fwrite
+      (
+         (const void *) RELABSD_REPLAY_TRACE_MAGIC,
+         RELABSD_REPLAY_TRACE_MAGIC_SIZE,
+         1,
+         result
+      )
+      != 1
+   )
+   {
+      RELABSD_ERROR("Unable to write to capture file \"%s\".", file_name);
+
+      (void) fclose(result);
+
+      return (FILE *) NULL;
+   }
+
+   return result;
+}
+
+/*
+ * Writes the events that are ('is_output') or are not output events.
+ *
+ * Returns 0 on success,
+ *         -1 on error.
+ */
+static int write_trace
+(
+   const char file_name [const restrict static 1],
+   const int is_output,
+   const size_t events_count,
+   const struct relabsd_capture_ring_copy events [const restrict static 1]
+)
+{
+   struct relabsd_replay_event event;
+   uint64_t previous_time, delay;
+   FILE * file;
+   size_t i;
+   int is_first_event;
+
+   file = open_trace(file_name);
+
+   if (file == (FILE *) NULL)
+   {
+      return -1;
+   }
+
+   is_first_event = 1;
+   previous_time = 0;
+
+   for (i = 0; i < events_count; ++i)
+   {
+      if (((events[i].type & RELABSD_CAPTURE_RING_OUTPUT) != 0) != is_output)
+      {
+         continue;
+      }
+
+      if (is_first_event || (events[i].time < previous_time))
+      {
+         delay = 0;
+         is_first_event = 0;
+      }
+      else
+      {
+         delay = ((events[i].time - previous_time) / 1000);
+      }
+
+      previous_time = events[i].time;
+
+      event.delay = ((delay > UINT32_MAX) ? UINT32_MAX : (uint32_t) delay);
+      event.type = (uint16_t) (events[i].type & ~RELABSD_CAPTURE_RING_OUTPUT);
+      event.code = events[i].code;
+      event.value = events[i].value;
+
+      if
+      (
+         fwrite
+         (
+            (const void *) &event,
+            sizeof(struct relabsd_replay_event),
+            1,
+            file
+         )
+         != 1
+      )
+      {
+         RELABSD_ERROR("Unable to write to capture file \"%s\".", file_name);
+
+         (void) fclose(file);
+
+         return -1;
+      }
+   }
+
+   if (fclose(file) != 0)
+   {
+      RELABSD_ERROR
+      (
+         "Unable to complete the writing of capture file \"%s\".",
+         file_name
+      );
+
+      return -1;
+   }
+
+   return 0;
+}
+
+/******************************************************************************/
+/**** EXPORTED FUNCTIONS ******************************************************/
+/******************************************************************************/
+struct relabsd_capture_ring * relabsd_capture_ring_create (void)
+{
+   struct relabsd_capture_ring * result;
+
+   errno = 0;
+
+   /* An all-zero ring is empty. */
+   result =
+      (struct relabsd_capture_ring *) calloc
+      (
+         1,
+         sizeof(struct relabsd_capture_ring)
+      );
+
+   if (result == (struct relabsd_capture_ring *) NULL)
+   {
+      RELABSD_FATAL
+      (
+         "Unable to allocate memory for a capture ring: %s.",
+         strerror(errno)
+      );
+   }
+
+   return result;
+}
+
+void relabsd_capture_ring_destroy
+(
+   struct relabsd_capture_ring * const ring
+)
+{
+   free((void *) ring);
+}
+
+void relabsd_capture_ring_add
+(
+   struct relabsd_capture_ring ring [const static 1],
+   const struct timespec time [const restrict static 1],
+   const unsigned int type,
+   const unsigned int code,
+   const int value
+)
+{
+   struct relabsd_capture_ring_event * event;
+   uint64_t write_index;
+
+   write_index =
+      atomic_load_explicit(&(ring->write_index), memory_order_relaxed);
+
+   event = (ring->events + (write_index & (RELABSD_CAPTURE_RING_SIZE - 1)));
+
+   /* Readers that see any of the following also see the previous index. */
+   atomic_thread_fence(memory_order_release);
+
+   atomic_store_explicit
+   (
+      &(event->time),
+      (
+         (((uint64_t) time->tv_sec) * UINT64_C(1000000000))
+         + ((uint64_t) time->tv_nsec)
+      ),
+      memory_order_relaxed
+   );
+
+   atomic_store_explicit(&(event->type), (uint16_t) type, memory_order_relaxed);
+   atomic_store_explicit(&(event->code), (uint16_t) code, memory_order_relaxed);
+   atomic_store_explicit
+   (
+      &(event->value),
+      (int32_t) value,
+      memory_order_relaxed
+   );
+
+   atomic_store_explicit
+   (
+      &(ring->write_index),
+      (write_index + 1),
+      memory_order_release
+   );
+}
+
+int relabsd_capture_ring_dump
+(
+   const struct relabsd_capture_ring ring [const static 1],
+   const char inputs_file_name [const restrict static 1],
+   const char outputs_file_name [const restrict static 1]
+)
+{
+   struct relabsd_capture_ring_copy * events;
+   size_t events_count;
+   int result;
+
+   errno = 0;
+
+   events =
+      (struct relabsd_capture_ring_copy *) calloc
+      (
+         RELABSD_CAPTURE_RING_SIZE,
+         sizeof(struct relabsd_capture_ring_copy)
+      );
+
+   if (events == (struct relabsd_capture_ring_copy *) NULL)
+   {
+      RELABSD_ERROR
+      (
+         "Unable to allocate memory to copy a capture ring: %s.",
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   events_count = copy_events(ring, events);
+
+   result = 0;
+
+   if
+   (
+      (write_trace(inputs_file_name, 0, events_count, events) < 0)
+      || (write_trace(outputs_file_name, 1, events_count, events) < 0)
+   )
+   {
+      result = -1;
+   }
+
+   free((void *) events);
+
+   return result;
+}
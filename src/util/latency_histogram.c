@@ -0,0 +1,198 @@
+/**** POSIX *******************************************************************/
+#include <stdatomic.h>
+
+/**** RELABSD *****************************************************************/
+#include <relabsd/util/latency_histogram.h>
+
+#define RELABSD_LATENCY_HISTOGRAM_SUB_BUCKETS_COUNT \
+   (1UL << RELABSD_LATENCY_HISTOGRAM_PRECISION)
+
+/******************************************************************************/
+/**** LOCAL FUNCTIONS *********************************************************/
+/******************************************************************************/
+static unsigned int get_bucket_index (const unsigned long int microseconds)
+{
+   unsigned int shift;
+
+   if (microseconds < RELABSD_LATENCY_HISTOGRAM_SUB_BUCKETS_COUNT)
+   {
+      return (unsigned int) microseconds;
+   }
+
+   if (microseconds >= (1UL << RELABSD_LATENCY_HISTOGRAM_RANGE))
+   {
+      return (RELABSD_LATENCY_HISTOGRAM_BUCKETS_COUNT - 1);
+   }
+
+   /* Position of the most significant bit, minus the precision. */
+   shift =
+      (
+         (unsigned int) ((sizeof(unsigned long int) * 8) - 1)
+         - ((unsigned int) __builtin_clzl(microseconds))
+         - RELABSD_LATENCY_HISTOGRAM_PRECISION
+      );
+
+   return
+      (unsigned int)
+      (
+         ((shift + 1) << RELABSD_LATENCY_HISTOGRAM_PRECISION)
+         +
+         (
+            (microseconds >> shift)
+            - RELABSD_LATENCY_HISTOGRAM_SUB_BUCKETS_COUNT
+         )
+      );
+}
+
+static unsigned long int get_bucket_upper_limit (const unsigned int index)
+{
+   unsigned int shift;
+   unsigned long int sub_bucket;
+
+   if (index < RELABSD_LATENCY_HISTOGRAM_SUB_BUCKETS_COUNT)
+   {
+      return (unsigned long int) index;
+   }
+
+   shift = ((index >> RELABSD_LATENCY_HISTOGRAM_PRECISION) - 1);
+   sub_bucket =
+      (
+         ((unsigned long int) index)
+         & (RELABSD_LATENCY_HISTOGRAM_SUB_BUCKETS_COUNT - 1)
+      );
+
+   return
+      (
+         (
+            (RELABSD_LATENCY_HISTOGRAM_SUB_BUCKETS_COUNT + sub_bucket + 1)
+            << shift
+         )
+         - 1
+      );
+}
+
+/******************************************************************************/
+/**** EXPORTED FUNCTIONS ******************************************************/
+/******************************************************************************/
+void relabsd_latency_histogram_initialize
+(
+   struct relabsd_latency_histogram histogram [const restrict static 1]
+)
+{
+   int i;
+
+   for (i = 0; i < RELABSD_LATENCY_HISTOGRAM_BUCKETS_COUNT; ++i)
+   {
+      atomic_init(histogram->buckets + i, 0);
+   }
+
+   atomic_init(&(histogram->count), 0);
+   atomic_init(&(histogram->max), 0);
+}
+
+void relabsd_latency_histogram_add
+(
+   struct relabsd_latency_histogram histogram [const restrict static 1],
+   const unsigned long int microseconds
+)
+{
+   atomic_ulong * bucket;
+
+   bucket = (histogram->buckets + get_bucket_index(microseconds));
+
+   atomic_store_explicit
+   (
+      bucket,
+      (atomic_load_explicit(bucket, memory_order_relaxed) + 1),
+      memory_order_relaxed
+   );
+
+   atomic_store_explicit
+   (
+      &(histogram->count),
+      (atomic_load_explicit(&(histogram->count), memory_order_relaxed) + 1),
+      memory_order_relaxed
+   );
+
+   if
+   (
+      microseconds
+      > atomic_load_explicit(&(histogram->max), memory_order_relaxed)
+   )
+   {
+      atomic_store_explicit
+      (
+         &(histogram->max),
+         microseconds,
+         memory_order_relaxed
+      );
+   }
+}
+
+unsigned long int relabsd_latency_histogram_get_count
+(
+   const struct relabsd_latency_histogram histogram [const restrict static 1]
+)
+{
+   return atomic_load_explicit(&(histogram->count), memory_order_relaxed);
+}
+
+unsigned long int relabsd_latency_histogram_get_max
+(
+   const struct relabsd_latency_histogram histogram [const restrict static 1]
+)
+{
+   return atomic_load_explicit(&(histogram->max), memory_order_relaxed);
+}
+
+unsigned long int relabsd_latency_histogram_get_percentile
+(
+   const struct relabsd_latency_histogram histogram [const restrict static 1],
+   const unsigned int permille
+)
+{
+   unsigned long int count, threshold, sum, max;
+   unsigned int i;
+
+   count = relabsd_latency_histogram_get_count(histogram);
+
+   if (count == 0)
+   {
+      return 0;
+   }
+
+   /* Rounded up, so that the 1000th permille is the max's bucket. */
+   threshold = (((count * permille) + 999) / 1000);
+
+   if (threshold == 0)
+   {
+      threshold = 1;
+   }
+
+   sum = 0;
+
+   for (i = 0; i < RELABSD_LATENCY_HISTOGRAM_BUCKETS_COUNT; ++i)
+   {
+      sum +=
+         atomic_load_explicit(histogram->buckets + i, memory_order_relaxed);
+
+      if (sum >= threshold)
+      {
+         break;
+      }
+   }
+
+   max = relabsd_latency_histogram_get_max(histogram);
+
+   /* Also covers the buckets being updated while they were read. */
+   if
+   (
+      (i == RELABSD_LATENCY_HISTOGRAM_BUCKETS_COUNT)
+      || (max < get_bucket_upper_limit(i))
+   )
+   {
+      return max;
+   }
+
+   return get_bucket_upper_limit(i);
+}
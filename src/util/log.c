@@ -0,0 +1,536 @@
+/**** POSIX *******************************************************************/
+#include <sys/eventfd.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**** RELABSD *****************************************************************/
+#include <relabsd/config.h>
+
+#include <relabsd/util/log.h>
+
+/******************************************************************************/
+/**** LOCAL FUNCTIONS *********************************************************/
+/******************************************************************************/
+/*
+ * How long repetitions of a message, or lost messages, can go unreported, in
+ * milliseconds.
+ */
+#define RELABSD_LOG_REPORT_DELAY 1000
+
+/*
+ * Bounded multi-producer queue: message 'i' is at
+ * 'RELABSD_LOG_MESSAGES[i % RELABSD_LOG_RING_SIZE]', whose 'sequence' is 'i'
+ * when it can be written to, and (i + 1) once it has been.
+ */
+struct relabsd_log_message
+{
+   atomic_ulong sequence;
+   char text[RELABSD_LOG_MESSAGE_SIZE];
+};
+
+/*
+ * Call sites are identified by their format string. Those sharing an entry
+ * take it from each other, so the limit is only approximate.
+ */
+struct relabsd_log_call_site
+{
+   atomic_uintptr_t format;
+   atomic_long second;
+   atomic_uint count;
+};
+
+static struct relabsd_log_message RELABSD_LOG_MESSAGES[RELABSD_LOG_RING_SIZE];
+static struct relabsd_log_call_site
+   RELABSD_LOG_CALL_SITES[RELABSD_LOG_CALL_SITES_COUNT];
+
+static atomic_ulong RELABSD_LOG_WRITE_INDEX;
+/* Only used by the writer thread. */
+static unsigned long int RELABSD_LOG_READ_INDEX;
+
+static atomic_int RELABSD_LOG_IS_RUNNING;
+static atomic_int RELABSD_LOG_IS_NOTIFIED;
+static atomic_ulong RELABSD_LOG_DROPPED_COUNT;
+static atomic_ulong RELABSD_LOG_SUPPRESSED_COUNT;
+
+static int RELABSD_LOG_FILE = -1;
+static pthread_t RELABSD_LOG_THREAD;
+
+/* Only used by the writer thread. */
+static char RELABSD_LOG_LAST_TEXT[RELABSD_LOG_MESSAGE_SIZE];
+static unsigned long int RELABSD_LOG_REPETITIONS_COUNT;
+static long int RELABSD_LOG_LAST_LOSSES_REPORT;
+
+static int is_allowed
+(
+   const char format [const static 1]
+)
+{
+   struct relabsd_log_call_site * call_site;
+   struct timespec now;
+
+   call_site =
+      (
+         RELABSD_LOG_CALL_SITES
+         + (
+            (((uintptr_t) format) >> 4)
+            & (RELABSD_LOG_CALL_SITES_COUNT - 1)
+         )
+      );
+
+   /* Cheap enough, and a second does not need to be precise. */
+   (void) clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+
+   if
+   (
+      atomic_load_explicit(&(call_site->format), memory_order_relaxed)
+      != ((uintptr_t) format)
+   )
+   {
+      atomic_store_explicit
+      (
+         &(call_site->format),
+         (uintptr_t) format,
+         memory_order_relaxed
+      );
+
+      atomic_store_explicit(&(call_site->count), 0, memory_order_relaxed);
+   }
+
+   if
+   (
+      atomic_load_explicit(&(call_site->second), memory_order_relaxed)
+      != ((long int) now.tv_sec)
+   )
+   {
+      atomic_store_explicit
+      (
+         &(call_site->second),
+         (long int) now.tv_sec,
+         memory_order_relaxed
+      );
+
+      atomic_store_explicit(&(call_site->count), 0, memory_order_relaxed);
+   }
+
+   return
+      (
+         atomic_fetch_add_explicit(&(call_site->count), 1, memory_order_relaxed)
+         < RELABSD_LOG_RATE_LIMIT
+      );
+}
+
+/* Returns NULL if the queue is full. */
+static struct relabsd_log_message * reserve_message (void)
+{
+   struct relabsd_log_message * message;
+   unsigned long int index, sequence;
+
+   index = atomic_load_explicit(&RELABSD_LOG_WRITE_INDEX, memory_order_relaxed);
+
+   for (;;)
+   {
+      message = (RELABSD_LOG_MESSAGES + (index & (RELABSD_LOG_RING_SIZE - 1)));
+      sequence =
+         atomic_load_explicit(&(message->sequence), memory_order_acquire);
+
+      if (sequence == index)
+      {
+         /* Updates 'index' on failure. */
+         if
+         (
+            atomic_compare_exchange_weak_explicit
+            (
+               &RELABSD_LOG_WRITE_INDEX,
+               &index,
+               (index + 1),
+               memory_order_relaxed,
+               memory_order_relaxed
+            )
+         )
+         {
+            return message;
+         }
+      }
+      else if (((long int) (sequence - index)) < 0)
+      {
+         /* The message there from the previous lap was not written yet. */
+         return (struct relabsd_log_message *) NULL;
+      }
+      else
+      {
+         index =
+            atomic_load_explicit
+            (
+               &RELABSD_LOG_WRITE_INDEX,
+               memory_order_relaxed
+            );
+      }
+   }
+}
+
+static void notify_writer (void)
+{
+   const uint64_t increment = 1;
+
+   /* Only if it has handled the previous notification. */
+   if (!atomic_exchange(&RELABSD_LOG_IS_NOTIFIED, 1))
+   {
+      /* Nothing can be logged about it failing. */
+      (void) write
+      (
+         RELABSD_LOG_FILE,
+         (const void *) &increment,
+         sizeof(uint64_t)
+      );
+   }
+}
+
+static void write_repetitions (void)
+{
+   if (RELABSD_LOG_REPETITIONS_COUNT == 0)
+   {
+      return;
+   }
+
+   (void) fprintf
+   (
+      stderr,
+      "[I] The previous message was repeated %lu more time(s).\n",
+      RELABSD_LOG_REPETITIONS_COUNT
+   );
+
+   RELABSD_LOG_REPETITIONS_COUNT = 0;
+}
+
+static int has_losses (void)
+{
+   return
+      (
+         (atomic_load(&RELABSD_LOG_DROPPED_COUNT) > 0)
+         || (atomic_load(&RELABSD_LOG_SUPPRESSED_COUNT) > 0)
+      );
+}
+
+/* Unless 'is_forced', losses are reported at most once per second. */
+static void write_losses (const int is_forced)
+{
+   unsigned long int dropped_count, suppressed_count;
+   struct timespec now;
+
+   (void) clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+
+   if
+   (
+      !is_forced
+      && (((long int) now.tv_sec) == RELABSD_LOG_LAST_LOSSES_REPORT)
+   )
+   {
+      return;
+   }
+
+   dropped_count = atomic_exchange(&RELABSD_LOG_DROPPED_COUNT, 0);
+   suppressed_count = atomic_exchange(&RELABSD_LOG_SUPPRESSED_COUNT, 0);
+
+   if ((dropped_count == 0) && (suppressed_count == 0))
+   {
+      return;
+   }
+
+   RELABSD_LOG_LAST_LOSSES_REPORT = (long int) now.tv_sec;
+
+   write_repetitions();
+
+   (void) fprintf
+   (
+      stderr,
+      "[W] %lu log message(s) were dropped (full queue), %lu were"
+      " suppressed (rate limit).\n",
+      dropped_count,
+      suppressed_count
+   );
+
+   /* The next message is not a repetition of this one. */
+   RELABSD_LOG_LAST_TEXT[0] = '\0';
+}
+
+static void write_messages (void)
+{
+   struct relabsd_log_message * message;
+
+   for (;;)
+   {
+      message =
+         (
+            RELABSD_LOG_MESSAGES
+            + (RELABSD_LOG_READ_INDEX & (RELABSD_LOG_RING_SIZE - 1))
+         );
+
+      if
+      (
+         atomic_load_explicit(&(message->sequence), memory_order_acquire)
+         != (RELABSD_LOG_READ_INDEX + 1)
+      )
+      {
+         break;
+      }
+
+      if (strcmp(message->text, RELABSD_LOG_LAST_TEXT) == 0)
+      {
+         RELABSD_LOG_REPETITIONS_COUNT += 1;
+      }
+      else
+      {
+         write_repetitions();
+
+         (void) fputs(message->text, stderr);
+         (void) memcpy
+         (
+            (void *) RELABSD_LOG_LAST_TEXT,
+            (const void *) message->text,
+            RELABSD_LOG_MESSAGE_SIZE
+         );
+      }
+
+      /* Frees the message for the next lap. */
+      atomic_store_explicit
+      (
+         &(message->sequence),
+         (RELABSD_LOG_READ_INDEX + RELABSD_LOG_RING_SIZE),
+         memory_order_release
+      );
+
+      RELABSD_LOG_READ_INDEX += 1;
+   }
+
+   write_losses(0);
+}
+
+static void * writer_main_loop (void * unused)
+{
+   struct pollfd file;
+   uint64_t counter;
+
+   (void) unused;
+
+   file.fd = RELABSD_LOG_FILE;
+   file.events = POLLIN;
+
+   while (atomic_load(&RELABSD_LOG_IS_RUNNING))
+   {
+      if
+      (
+         poll
+         (
+            &file,
+            1,
+            (
+               ((RELABSD_LOG_REPETITIONS_COUNT > 0) || has_losses()) ?
+               RELABSD_LOG_REPORT_DELAY
+               : -1
+            )
+         )
+         == 0
+      )
+      {
+         write_repetitions();
+         write_losses(1);
+
+         continue;
+      }
+
+      (void) read(RELABSD_LOG_FILE, (void *) &counter, sizeof(uint64_t));
+
+      /* Messages queued after this get notified again. */
+      (void) atomic_exchange(&RELABSD_LOG_IS_NOTIFIED, 0);
+
+      write_messages();
+   }
+
+   return NULL;
+}
+
+/******************************************************************************/
+/**** EXPORTED FUNCTIONS ******************************************************/
+/******************************************************************************/
+void relabsd_log_print
+(
+   const int is_rate_limited,
+   const char format [const restrict static 1],
+   ...
+)
+{
+   struct relabsd_log_message * message;
+   va_list arguments;
+   int length;
+
+   va_start(arguments, format);
+
+   if (!atomic_load_explicit(&RELABSD_LOG_IS_RUNNING, memory_order_acquire))
+   {
+      (void) vfprintf(stderr, format, arguments);
+
+      va_end(arguments);
+
+      return;
+   }
+
+   if (is_rate_limited && !is_allowed(format))
+   {
+      (void) atomic_fetch_add(&RELABSD_LOG_SUPPRESSED_COUNT, 1);
+
+      va_end(arguments);
+
+      return;
+   }
+
+   message = reserve_message();
+
+   if (message == (struct relabsd_log_message *) NULL)
+   {
+      (void) atomic_fetch_add(&RELABSD_LOG_DROPPED_COUNT, 1);
+
+      va_end(arguments);
+
+      return;
+   }
+
+   length =
+      vsnprintf(message->text, RELABSD_LOG_MESSAGE_SIZE, format, arguments);
+
+   va_end(arguments);
+
+   if (length < 0)
+   {
+      message->text[0] = '\0';
+   }
+   else if (length >= RELABSD_LOG_MESSAGE_SIZE)
+   {
+      /* Cut messages still end the line. */
+      message->text[RELABSD_LOG_MESSAGE_SIZE - 2] = '\n';
+   }
+
+   atomic_store_explicit
+   (
+      &(message->sequence),
+      (
+         atomic_load_explicit(&(message->sequence), memory_order_relaxed)
+         + 1
+      ),
+      memory_order_release
+   );
+
+   notify_writer();
+}
+
+int relabsd_log_start (void)
+{
+   sigset_t all_signals, previous_signals;
+   unsigned long int i;
+   int err;
+
+   errno = 0;
+
+   RELABSD_LOG_FILE = eventfd(0, EFD_CLOEXEC);
+
+   if (RELABSD_LOG_FILE == -1)
+   {
+      (void) fprintf
+      (
+         stderr,
+         "[E] Unable to create an eventfd for the log: %s.\n",
+         strerror(errno)
+      );
+
+      return -1;
+   }
+
+   for (i = 0; i < RELABSD_LOG_RING_SIZE; ++i)
+   {
+      atomic_init(&(RELABSD_LOG_MESSAGES[i].sequence), i);
+   }
+
+   atomic_init(&RELABSD_LOG_WRITE_INDEX, 0);
+   RELABSD_LOG_READ_INDEX = 0;
+   RELABSD_LOG_LAST_TEXT[0] = '\0';
+   RELABSD_LOG_REPETITIONS_COUNT = 0;
+   RELABSD_LOG_LAST_LOSSES_REPORT = -1;
+
+   atomic_init(&RELABSD_LOG_IS_NOTIFIED, 0);
+   atomic_init(&RELABSD_LOG_DROPPED_COUNT, 0);
+   atomic_init(&RELABSD_LOG_SUPPRESSED_COUNT, 0);
+   atomic_store(&RELABSD_LOG_IS_RUNNING, 1);
+
+   /* The writer thread inherits it: signals are handled by the others. */
+   (void) sigfillset(&all_signals);
+   (void) pthread_sigmask(SIG_SETMASK, &all_signals, &previous_signals);
+
+   err =
+      pthread_create
+      (
+         &RELABSD_LOG_THREAD,
+         (const pthread_attr_t *) NULL,
+         writer_main_loop,
+         NULL
+      );
+
+   (void) pthread_sigmask
+   (
+      SIG_SETMASK,
+      &previous_signals,
+      (sigset_t *) NULL
+   );
+
+   if (err != 0)
+   {
+      atomic_store(&RELABSD_LOG_IS_RUNNING, 0);
+
+      (void) close(RELABSD_LOG_FILE);
+
+      RELABSD_LOG_FILE = -1;
+
+      (void) fprintf
+      (
+         stderr,
+         "[E] Unable to create the log's writer thread: %s.\n",
+         strerror(err)
+      );
+
+      return -1;
+   }
+
+   return 0;
+}
+
+void relabsd_log_stop (void)
+{
+   const uint64_t increment = 1;
+
+   if (RELABSD_LOG_FILE == -1)
+   {
+      return;
+   }
+
+   atomic_store(&RELABSD_LOG_IS_RUNNING, 0);
+
+   (void) write(RELABSD_LOG_FILE, (const void *) &increment, sizeof(uint64_t));
+   (void) pthread_join(RELABSD_LOG_THREAD, (void **) NULL);
+
+   /* Including what was queued while the writer thread was stopping. */
+   write_messages();
+   write_repetitions();
+   write_losses(1);
+
+   (void) close(RELABSD_LOG_FILE);
+
+   RELABSD_LOG_FILE = -1;
+}